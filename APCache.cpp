@@ -0,0 +1,109 @@
+#include "APCache.h"
+#include <Preferences.h>
+#include <LoggingBase.h>
+
+namespace {
+
+constexpr uint32_t APCACHE_MAGIC = 0x41504332; // "APC2"
+constexpr const char* NVS_NAMESPACE = "wifiwrapper";
+constexpr const char* NVS_KEY = "lastap";
+
+struct StoredAP {
+    uint32_t magic;
+    uint32_t ssidHash;
+    PersistedAP ap;
+    uint32_t checksum;
+};
+
+RTC_DATA_ATTR StoredAP rtcEntry;
+
+// FNV-1a, good enough to tell SSIDs apart and to catch garbage in RTC memory
+uint32_t fnv1a(const void* data, size_t len, uint32_t hash = 2166136261u) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= p[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint32_t checksumOf(const StoredAP& e) {
+    return fnv1a(&e, offsetof(StoredAP, checksum));
+}
+
+bool isValid(const StoredAP& e, uint32_t ssidHash) {
+    return e.magic == APCACHE_MAGIC && e.ssidHash == ssidHash && e.checksum == checksumOf(e);
+}
+
+bool sameTarget(const PersistedAP& a, const PersistedAP& b) {
+    return memcmp(a.bssid, b.bssid, 6) == 0 && a.channel == b.channel &&
+           a.ip == b.ip && a.gateway == b.gateway && a.subnet == b.subnet && a.dns == b.dns;
+}
+
+bool loadNVS(StoredAP& e) {
+    Preferences prefs;
+    if (!prefs.begin(NVS_NAMESPACE, true)) {
+        return false;
+    }
+    bool ok = prefs.getBytes(NVS_KEY, &e, sizeof(e)) == sizeof(e);
+    prefs.end();
+    return ok;
+}
+
+} // namespace
+
+bool APCache::load(const char* ssid, PersistedAP& out) {
+    uint32_t ssidHash = fnv1a(ssid, strlen(ssid));
+
+    if (isValid(rtcEntry, ssidHash)) {
+        out = rtcEntry.ap;
+        return true;
+    }
+
+    StoredAP e;
+    if (loadNVS(e) && isValid(e, ssidHash)) {
+        e.ap.leaseUses = leaseAgeUnknown;
+        e.checksum = checksumOf(e);
+        rtcEntry = e;
+        out = e.ap;
+        return true;
+    }
+    return false;
+}
+
+void APCache::store(const char* ssid, const PersistedAP& ap) {
+    StoredAP e;
+    memset(&e, 0, sizeof(e)); // deterministic padding for the checksum
+    e.magic = APCACHE_MAGIC;
+    e.ssidHash = fnv1a(ssid, strlen(ssid));
+    e.ap = ap;
+    e.checksum = checksumOf(e);
+
+    bool rtcWasSame = isValid(rtcEntry, e.ssidHash) && sameTarget(rtcEntry.ap, ap);
+    rtcEntry = e;
+    if (rtcWasSame) {
+        return; // RTC mirrors what was last loaded from or written to NVS
+    }
+
+    StoredAP old;
+    if (loadNVS(old) && isValid(old, e.ssidHash) && sameTarget(old.ap, ap)) {
+        return;
+    }
+
+    Preferences prefs;
+    if (!prefs.begin(NVS_NAMESPACE, false)) {
+        gLogger->println("[APCache] Could not open NVS.");
+        return;
+    }
+    prefs.putBytes(NVS_KEY, &e, sizeof(e));
+    prefs.end();
+}
+
+void APCache::clear() {
+    memset(&rtcEntry, 0, sizeof(rtcEntry));
+    Preferences prefs;
+    if (prefs.begin(NVS_NAMESPACE, false)) {
+        prefs.remove(NVS_KEY);
+        prefs.end();
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef AP_CACHE_H
+#define AP_CACHE_H
+
+#include <Arduino.h>
+
+// Last AP we successfully connected to, kept across deep sleep (RTC memory)
+// and across reboots (NVS), so the next connect can skip the scan.
+// Plain data on purpose: a non-trivial constructor would re-run on every
+// wake-up and wipe the RTC copy. Zero-initialize with PersistedAP ap = {};
+struct PersistedAP {
+    uint8_t bssid[6];
+    uint8_t channel;
+    int8_t rssi;
+    // last DHCP lease, 0 = unknown; only used if lease reuse is enabled.
+    // Only ever written from a connection that got its address from DHCP.
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+    // connects that reused the lease since DHCP handed it out;
+    // APCache::leaseAgeUnknown when read back from NVS
+    uint8_t leaseUses;
+};
+
+class APCache {
+public:
+    // the use count is not written to flash, so after a reboot the age of the
+    // lease is unknown and the next connect asks DHCP again
+    static constexpr uint8_t leaseAgeUnknown = 0xFF;
+
+    // RTC copy first (survives deep sleep), then NVS (survives reboot);
+    // entries stored for a different SSID are ignored
+    static bool load(const char* ssid, PersistedAP& out);
+    // always refreshes the RTC copy, writes NVS only if BSSID/channel/lease changed to spare the flash
+    // (not for leaseUses alone)
+    static void store(const char* ssid, const PersistedAP& ap);
+    static void clear();
+};
+
+#endif // AP_CACHE_H
@@ -0,0 +1,173 @@
+#include "APScanner.h"
+#include "DeferredLog.h"
+
+APScanner::APScanner(const char* ssid) : ssid_(ssid) {
+}
+
+bool APScanner::start(bool restrictToKnownChannels) {
+    if (scanning_) {
+        return true; // results of the running scan are just as good
+    }
+    pendingChannels_ = restrictToKnownChannels ? knownChannelMask() : 0;
+    fullScan_ = pendingChannels_ == 0;
+    scanStartedAt_ = millis();
+
+    uint8_t first = 0;
+    if (pendingChannels_) {
+        while (!(pendingChannels_ & (1u << first))) first++;
+        pendingChannels_ &= ~(1u << first);
+    }
+    scanning_ = startChannel(first);
+    return scanning_;
+}
+
+bool APScanner::startChannel(uint8_t channel) {
+    currentChannel_ = channel;
+    // async, include hidden, active, short dwell, only our SSID
+    int16_t res = WiFi.scanNetworks(true, true, false, scanMsPerChannel, channel, ssid_);
+    if (res == WIFI_SCAN_FAILED) {
+        deferredLog().log("[APScanner] Scan could not be started.");
+        return false;
+    }
+    return true;
+}
+
+bool APScanner::poll(uint32_t now) {
+    if (!scanning_) {
+        return false;
+    }
+    int n = WiFi.scanComplete();
+    if (n == WIFI_SCAN_RUNNING) {
+        return false;
+    }
+    if (n >= 0) {
+        ingest(n, currentChannel_, now);
+    }
+    WiFi.scanDelete();
+
+    if (pendingChannels_) {
+        uint8_t next = 0;
+        while (!(pendingChannels_ & (1u << next))) next++;
+        pendingChannels_ &= ~(1u << next);
+        if (startChannel(next)) {
+            return false;
+        }
+    }
+
+    scanning_ = false;
+    pendingChannels_ = 0;
+    lastScanFinishedAt_ = now;
+    lastScanDuration_ = now - scanStartedAt_;
+    if (fullScan_) {
+        lastFullScanFinishedAt_ = now;
+    }
+    return true;
+}
+
+void APScanner::abort() {
+    if (scanning_) {
+        WiFi.scanDelete();
+    }
+    scanning_ = false;
+    pendingChannels_ = 0;
+}
+
+void APScanner::ingest(int n, uint8_t channel, uint32_t now) {
+    // whatever was on the scanned channel(s) and is not reported again is gone
+    for (uint8_t i = 0; i < count_;) {
+        if (channel == 0 || candidates_[i].channel == channel) {
+            bool seen = false;
+            for (int k = 0; k < n && !seen; ++k) {
+                const uint8_t* b = WiFi.BSSID(k);
+                seen = b && memcmp(b, candidates_[i].bssid, 6) == 0;
+            }
+            if (!seen) {
+                remove(i);
+                continue;
+            }
+        }
+        ++i;
+    }
+
+    String targetSSID(ssid_);
+    for (int k = 0; k < n; ++k) {
+        if (WiFi.SSID(k) != targetSSID) {
+            continue;
+        }
+        const uint8_t* bssidPtr = WiFi.BSSID(k);
+        if (!bssidPtr) {
+            continue;
+        }
+
+        int32_t rssi = WiFi.RSSI(k);
+        int32_t ch = WiFi.channel(k);
+
+        deferredLog().log("[APScanner] Candidate %02X:%02X:%02X:%02X:%02X:%02X ch=%d RSSI=%d",
+                          bssidPtr[0], bssidPtr[1], bssidPtr[2], bssidPtr[3], bssidPtr[4], bssidPtr[5], ch, rssi);
+
+        uint8_t slot = count_;
+        for (uint8_t i = 0; i < count_; ++i) {
+            if (memcmp(candidates_[i].bssid, bssidPtr, 6) == 0) {
+                slot = i;
+                break;
+            }
+        }
+        if (slot == maxCandidates) {
+            // table full: replace the weakest entry if this one is stronger
+            slot = 0;
+            for (uint8_t i = 1; i < count_; ++i) {
+                if (candidates_[i].rssi < candidates_[slot].rssi) slot = i;
+            }
+            if (candidates_[slot].rssi >= rssi) {
+                continue;
+            }
+        } else if (slot == count_) {
+            count_++;
+        }
+
+        APCandidate& c = candidates_[slot];
+        memcpy(c.bssid, bssidPtr, 6);
+        c.channel = ch;
+        c.rssi = rssi;
+        c.lastSeen = now;
+    }
+}
+
+void APScanner::remove(uint8_t i) {
+    candidates_[i] = candidates_[count_ - 1];
+    count_--;
+}
+
+bool APScanner::best(APCandidate& out, uint32_t now, uint32_t maxAgeMs) const {
+    bool found = false;
+    for (uint8_t i = 0; i < count_; ++i) {
+        const APCandidate& c = candidates_[i];
+        if (now - c.lastSeen > maxAgeMs) {
+            continue;
+        }
+        if (!found || c.rssi > out.rssi) {
+            out = c;
+            found = true;
+        }
+    }
+    return found;
+}
+
+void APScanner::forget(const uint8_t* bssid) {
+    for (uint8_t i = 0; i < count_; ++i) {
+        if (memcmp(candidates_[i].bssid, bssid, 6) == 0) {
+            remove(i);
+            return;
+        }
+    }
+}
+
+uint32_t APScanner::knownChannelMask() const {
+    uint32_t mask = 0;
+    for (uint8_t i = 0; i < count_; ++i) {
+        if (candidates_[i].channel > 0 && candidates_[i].channel <= maxChannel) {
+            mask |= 1u << candidates_[i].channel;
+        }
+    }
+    return mask;
+}
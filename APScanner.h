@@ -0,0 +1,68 @@
+#ifndef AP_SCANNER_H
+#define AP_SCANNER_H
+
+#include <WiFi.h>
+
+// One BSSID broadcasting our SSID, as seen by the last scan of its channel
+struct APCandidate {
+    uint8_t bssid[6] = {0, 0, 0, 0, 0, 0};
+    int32_t channel = 0;
+    int32_t rssi = -127;
+    uint32_t lastSeen = 0; // millis()
+};
+
+// Non-blocking AP scanner for a single SSID.
+// Uses the async mode of WiFi.scanNetworks() and is advanced with poll();
+// results are merged into a small candidate table, so connect and roaming
+// decisions can be made from the cache without scanning again.
+// Not thread safe, WiFiWrapper calls it with stateMutex held.
+class APScanner {
+public:
+    static constexpr uint8_t maxCandidates = 8;
+    static constexpr uint8_t maxChannel = 13;
+    static constexpr uint32_t scanMsPerChannel = 120; // active dwell, Arduino default is 300
+
+    explicit APScanner(const char* ssid);
+
+    // starts a background scan. With restrictToKnownChannels only the channels
+    // where the SSID was seen before are scanned (one channel per scan call),
+    // otherwise (or if nothing is known yet) all channels in one go.
+    bool start(bool restrictToKnownChannels);
+    // consumes finished scan results and starts the next channel;
+    // returns true exactly once, when the whole scan has completed
+    bool poll(uint32_t now);
+    void abort();
+    bool isScanning() const { return scanning_; }
+
+    // strongest candidate seen within maxAgeMs
+    bool best(APCandidate& out, uint32_t now, uint32_t maxAgeMs) const;
+    // drop a BSSID, e.g. after a pinned connect to it failed
+    void forget(const uint8_t* bssid);
+
+    uint8_t candidateCount() const { return count_; }
+    const APCandidate& candidate(uint8_t i) const { return candidates_[i]; }
+    uint32_t knownChannelMask() const; // bit n set = SSID seen on channel n
+    uint32_t lastScanFinishedAt() const { return lastScanFinishedAt_; }
+    uint32_t lastScanDuration() const { return lastScanDuration_; }
+    uint32_t lastFullScanFinishedAt() const { return lastFullScanFinishedAt_; }
+
+private:
+    bool startChannel(uint8_t channel);
+    void ingest(int n, uint8_t channel, uint32_t now);
+    void remove(uint8_t i);
+
+    const char* ssid_;
+    APCandidate candidates_[maxCandidates];
+    uint8_t count_ = 0;
+
+    bool scanning_ = false;
+    uint32_t pendingChannels_ = 0; // channels still to scan in restricted mode
+    uint8_t currentChannel_ = 0;   // 0 = all channels in one scan
+    bool fullScan_ = false;
+    uint32_t scanStartedAt_ = 0;
+    uint32_t lastScanFinishedAt_ = 0;
+    uint32_t lastScanDuration_ = 0;
+    uint32_t lastFullScanFinishedAt_ = 0;
+};
+
+#endif // AP_SCANNER_H
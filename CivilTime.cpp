@@ -0,0 +1,114 @@
+#include "CivilTime.h"
+#include "SeqLock.h"
+
+#include <atomic>
+#include <string.h>
+
+static_assert(CivilTime::daysFromCivil(1970, 1, 1) == 0, "epoch");
+static_assert(CivilTime::daysFromCivil(2000, 3, 1) == 11017, "leap century");
+static_assert(CivilTime::civilFromDays(49710).year == 2106, "end of uint32 seconds");
+static_assert(CivilTime::weekday(0) == 4, "1970-01-01 was a Thursday");
+
+namespace {
+
+// the rendered date of the last day formatted, shared by all tasks; whoever
+// renders a new day publishes it unless another task is doing so right then
+struct DayText {
+    int64_t day = INT64_MIN;
+    char dmy[10]; // DD-MM-YYYY
+    char ymd[10]; // YYYY-MM-DD
+};
+SeqLock<DayText> gDayText;
+std::atomic_flag gDayTextWriter = ATOMIC_FLAG_INIT;
+
+inline void put2(char* p, uint32_t v) {
+    p[0] = (char)('0' + v / 10);
+    p[1] = (char)('0' + v % 10);
+}
+
+inline void put4(char* p, uint32_t v) {
+    put2(p, v / 100);
+    put2(p + 2, v % 100);
+}
+
+void dayText(int64_t day, DayText& out) {
+    out = gDayText.load();
+    if (out.day == day) {
+        return;
+    }
+    CivilDate d = CivilTime::civilFromDays(day);
+    out.day = day;
+    put2(out.dmy, d.day);
+    out.dmy[2] = '-';
+    put2(out.dmy + 3, d.month);
+    out.dmy[5] = '-';
+    put4(out.dmy + 6, (uint32_t)d.year);
+    put4(out.ymd, (uint32_t)d.year);
+    out.ymd[4] = '-';
+    put2(out.ymd + 5, d.month);
+    out.ymd[7] = '-';
+    put2(out.ymd + 8, d.day);
+    if (!gDayTextWriter.test_and_set(std::memory_order_acquire)) {
+        gDayText.store(out);
+        gDayTextWriter.clear(std::memory_order_release);
+    }
+}
+
+// HH:MM:SS
+void putTime(char* p, uint32_t secondsOfDay) {
+    put2(p, secondsOfDay / 3600);
+    p[2] = ':';
+    put2(p + 3, secondsOfDay / 60 % 60);
+    p[5] = ':';
+    put2(p + 6, secondsOfDay % 60);
+}
+
+// copies what fits, snprintf style
+size_t emit(const char* text, size_t n, char* buf, size_t len) {
+    if (len == 0) return 0;
+    if (n > len - 1) n = len - 1;
+    memcpy(buf, text, n);
+    buf[n] = 0;
+    return n;
+}
+
+} // namespace
+
+size_t CivilTime::formatDateTime(uint32_t t, char* buf, size_t len) {
+    char text[dateTimeSize];
+    DayText day;
+    dayText(t / 86400, day);
+    memcpy(text, day.dmy, 10);
+    text[10] = ' ';
+    putTime(text + 11, t % 86400);
+    return emit(text, dateTimeSize - 1, buf, len);
+}
+
+size_t CivilTime::formatTime(uint32_t t, char* buf, size_t len) {
+    char text[timeSize];
+    putTime(text, t % 86400);
+    return emit(text, timeSize - 1, buf, len);
+}
+
+size_t CivilTime::formatIso8601(uint32_t t, int32_t offsetSeconds, char* buf, size_t len) {
+    char text[isoSize];
+    int64_t local = (int64_t)t + offsetSeconds;
+    int64_t days = local >= 0 ? local / 86400 : (local - 86399) / 86400;
+    DayText day;
+    dayText(days, day);
+    memcpy(text, day.ymd, 10);
+    text[10] = 'T';
+    putTime(text + 11, (uint32_t)(local - days * 86400));
+    size_t n = 19;
+    if (offsetSeconds == 0) {
+        text[n++] = 'Z';
+    } else {
+        uint32_t off = (uint32_t)(offsetSeconds < 0 ? -offsetSeconds : offsetSeconds) / 60;
+        text[n++] = offsetSeconds < 0 ? '-' : '+';
+        put2(text + n, off / 60);
+        text[n + 2] = ':';
+        put2(text + n + 3, off % 60);
+        n += 5;
+    }
+    return emit(text, n, buf, len);
+}
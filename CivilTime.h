@@ -0,0 +1,66 @@
+#ifndef CIVIL_TIME_H
+#define CIVIL_TIME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct CivilDate {
+    int32_t year;
+    uint8_t month; // 1-12
+    uint8_t day;   // 1-31
+};
+
+// Proleptic Gregorian calendar arithmetic and fixed-width timestamp formatting
+// without gmtime_r, mktime or snprintf. The conversions are H. Hinnant's
+// days_from_civil / civil_from_days: a handful of multiplies and shifts, no
+// loops, no tables, and constexpr. The formatters write digits straight into
+// the buffer and reuse the rendered date while the day stays the same.
+class CivilTime {
+public:
+    static constexpr bool isLeap(int32_t y) {
+        return (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+    }
+    static constexpr uint8_t daysInMonth(int32_t y, uint32_t m) {
+        return m == 2 ? (isLeap(y) ? 29 : 28) : (uint8_t)(30 + ((m + (m >> 3)) & 1));
+    }
+
+    // days since 1970-01-01
+    static constexpr int64_t daysFromCivil(int32_t y, uint32_t m, uint32_t d) {
+        y -= m <= 2;
+        int32_t era = (y >= 0 ? y : y - 399) / 400;
+        uint32_t yoe = (uint32_t)(y - era * 400);                       // [0, 399]
+        uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1; // [0, 365], from March 1
+        uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;           // [0, 146096]
+        return (int64_t)era * 146097 + (int64_t)doe - 719468;
+    }
+    static constexpr CivilDate civilFromDays(int64_t days) {
+        days += 719468;
+        int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+        uint32_t doe = (uint32_t)(days - era * 146097);
+        uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        uint32_t mp = (5 * doy + 2) / 153;
+        uint32_t d = doy - (153 * mp + 2) / 5 + 1;
+        uint32_t m = mp < 10 ? mp + 3 : mp - 9;
+        return CivilDate{(int32_t)(yoe + era * 400) + (m <= 2), (uint8_t)m, (uint8_t)d};
+    }
+    // 0 = Sunday
+    static constexpr uint8_t weekday(int64_t days) {
+        return (uint8_t)(days >= -4 ? (days + 4) % 7 : (days + 5) % 7 + 6);
+    }
+
+    // buffer sizes including the terminating zero
+    static constexpr size_t dateTimeSize = 20; // DD-MM-YYYY HH:MM:SS
+    static constexpr size_t timeSize = 9;      // HH:MM:SS
+    static constexpr size_t isoSize = 26;      // YYYY-MM-DDTHH:MM:SS+hh:mm, or ...Z
+
+    // All formatters take Unix seconds, zero-terminate, truncate to fit len and
+    // return the number of characters written without the zero, like snprintf
+    // into a big enough buffer would.
+    static size_t formatDateTime(uint32_t t, char* buf, size_t len);
+    static size_t formatTime(uint32_t t, char* buf, size_t len);
+    // t is UTC; the local time t + offsetSeconds is written with its offset, "Z" for 0
+    static size_t formatIso8601(uint32_t t, int32_t offsetSeconds, char* buf, size_t len);
+};
+
+#endif // CIVIL_TIME_H
@@ -0,0 +1,131 @@
+#include "ClockDiscipline.h"
+
+#include <math.h>
+
+static int64_t absUs(int64_t v) { return v < 0 ? -v : v; }
+
+void ClockDiscipline::reset() {
+    model_ = ClockModel();
+    count_ = 0;
+    next_ = 0;
+    pollExp_ = minPollExp;
+    goodInARow_ = 0;
+    misses_ = 0;
+    residualUs_ = 0;
+}
+
+uint32_t ClockDiscipline::nextPollS() const {
+    if (misses_ == 0) {
+        return pollIntervalS();
+    }
+    uint8_t exp = minPollExp + misses_ - 1;
+    return exp < pollExp_ ? 1u << exp : pollIntervalS();
+}
+
+void ClockDiscipline::add(int64_t localUs, int64_t offsetUs) {
+    samples_[next_] = {localUs, offsetUs};
+    next_ = (next_ + 1) % maxSamples;
+    if (count_ < maxSamples) count_++;
+}
+
+// least squares slope of offset over local time, and how far off it may be
+bool ClockDiscipline::fit(int32_t& freqPpb, int32_t& wanderPpb, int64_t distanceUs) const {
+    if (count_ < 2) {
+        return false;
+    }
+    uint8_t first = count_ < maxSamples ? 0 : next_;
+    int64_t x0 = samples_[first].localUs;
+    int64_t y0 = samples_[first].offsetUs;
+    double sx = 0, sy = 0;
+    for (uint8_t i = 0; i < count_; ++i) {
+        sx += (samples_[i].localUs - x0) / 1e6; // seconds
+        sy += (double)(samples_[i].offsetUs - y0);
+    }
+    double mx = sx / count_, my = sy / count_;
+    double sxx = 0, sxy = 0, span = 0;
+    for (uint8_t i = 0; i < count_; ++i) {
+        double dx = (samples_[i].localUs - x0) / 1e6 - mx;
+        double dy = (samples_[i].offsetUs - y0) - my;
+        sxx += dx * dx;
+        sxy += dx * dy;
+        if (fabs(dx) > span) span = fabs(dx);
+    }
+    if (sxx < 1.0) {
+        return false; // all within a second, no slope to speak of
+    }
+    double slope = sxy / sxx; // us per s = ppm
+
+    // two samples fit exactly, so bound by their measurement error instead;
+    // with more, three standard errors of the slope
+    double wander = 2.0 * distanceUs / (2.0 * span);
+    if (count_ > 2) {
+        double ss = 0;
+        for (uint8_t i = 0; i < count_; ++i) {
+            double dx = (samples_[i].localUs - x0) / 1e6 - mx;
+            double r = (samples_[i].offsetUs - y0) - my - slope * dx;
+            ss += r * r;
+        }
+        double se = sqrt(ss / (count_ - 2) / sxx);
+        if (3.0 * se > wander) wander = 3.0 * se;
+    }
+
+    double ppb = slope * 1000.0;
+    if (ppb > maxFreqPpb) ppb = maxFreqPpb;
+    if (ppb < -maxFreqPpb) ppb = -maxFreqPpb;
+    freqPpb = (int32_t)lround(ppb);
+    wander *= 1000.0;
+    wanderPpb = wander > initialWanderPpb ? initialWanderPpb : wander < minWanderPpb ? minWanderPpb : (int32_t)wander;
+    return true;
+}
+
+ClockDiscipline::Action ClockDiscipline::update(int64_t localUs, int64_t offsetUs, int64_t distanceUs) {
+    misses_ = 0;
+    int64_t predicted = model_.offsetUs(localUs);
+    residualUs_ = count_ ? offsetUs - predicted : 0;
+
+    if (count_ == 0 || absUs(residualUs_) > stepThresholdUs) {
+        // first sync, or the model is so far off that its samples are worthless
+        int32_t freq = count_ ? model_.freqPpb : 0;
+        count_ = 0;
+        next_ = 0;
+        add(localUs, offsetUs);
+        model_ = ClockModel();
+        model_.baseLocalUs = localUs;
+        model_.baseOffsetUs = offsetUs;
+        model_.freqPpb = freq;
+        model_.baseErrorUs = distanceUs;
+        model_.wanderPpb = initialWanderPpb;
+        pollExp_ = minPollExp;
+        goodInARow_ = 0;
+        return Action::Step;
+    }
+
+    add(localUs, offsetUs);
+    int32_t freq = model_.freqPpb;
+    int32_t wander = model_.wanderPpb;
+    fit(freq, wander, distanceUs);
+
+    // continue from what we reported so far and slew the difference in
+    model_.baseLocalUs = localUs;
+    model_.baseOffsetUs = predicted;
+    model_.freqPpb = freq;
+    model_.wanderPpb = wander;
+    model_.slewUs = (int32_t)residualUs_;
+    model_.slewDurationUs = absUs(residualUs_) * 1000000 / maxSlewPpm;
+    model_.baseErrorUs = distanceUs;
+
+    int64_t residual = absUs(residualUs_);
+    int64_t growthAtNextUs = (int64_t)(1u << (pollExp_ + 1)) * wander / 1000; // over twice the interval
+    if (residual > errorBudgetUs_ / 2) {
+        if (pollExp_ > minPollExp) pollExp_--;
+        goodInARow_ = 0;
+    } else if (residual < errorBudgetUs_ / 4 && growthAtNextUs < errorBudgetUs_ / 2) {
+        if (++goodInARow_ >= pollUpAfter && pollExp_ < maxPollExp) {
+            pollExp_++;
+            goodInARow_ = 0;
+        }
+    } else {
+        goodInARow_ = 0;
+    }
+    return Action::Slew;
+}
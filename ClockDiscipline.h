@@ -0,0 +1,99 @@
+#ifndef CLOCK_DISCIPLINE_H
+#define CLOCK_DISCIPLINE_H
+
+#include <stdint.h>
+
+// UTC as a function of the local clock (esp_timer_get_time()): a phase, a
+// frequency correction and a phase correction being slewed in. Small and
+// trivially copyable, so TimeManager publishes it in its lock-free snapshot
+// and every getter evaluates it with integer math.
+struct ClockModel {
+    int64_t baseLocalUs = 0;    // local time the model was last updated
+    int64_t baseOffsetUs = 0;   // UTC minus local time at baseLocalUs
+    int32_t freqPpb = 0;        // change of the offset per local time, ppb; negative if the local clock is fast
+    int32_t slewUs = 0;         // correction applied gradually after baseLocalUs ...
+    int64_t slewDurationUs = 0; // ... over this long
+    int64_t baseErrorUs = 0;    // error bound at baseLocalUs: root distance of the sync
+    int32_t wanderPpb = 0;      // uncertainty of freqPpb, grows the bound with time
+
+    int64_t offsetUs(int64_t localUs) const {
+        int64_t dt = localUs - baseLocalUs;
+        return baseOffsetUs + dt * freqPpb / 1000000000 + slewed(dt);
+    }
+    int64_t utcUs(int64_t localUs) const { return localUs + offsetUs(localUs); }
+    // how far utcUs() may be from true time
+    int64_t errorUs(int64_t localUs) const {
+        int64_t dt = localUs - baseLocalUs;
+        int64_t rest = slewUs - slewed(dt);
+        return baseErrorUs + (dt > 0 ? dt : 0) * wanderPpb / 1000000000 + (rest < 0 ? -rest : rest);
+    }
+
+private:
+    int64_t slewed(int64_t dt) const {
+        if (dt <= 0 || slewUs == 0) return 0;
+        if (dt >= slewDurationUs) return slewUs;
+        return slewUs * dt / slewDurationUs;
+    }
+};
+
+// Clock discipline for SNTP results. The local oscillator's frequency error is
+// the slope of the measured offsets (UTC minus local time) over the last few
+// syncs, fitted by least squares. Between syncs the model extrapolates with it;
+// a new measurement that disagrees with the model by less than
+// stepThresholdUs is slewed in at maxSlewPpm, so reported time never jumps,
+// anything larger is stepped. The poll interval doubles from 2^minPollExp s
+// while predictions keep landing well within the error budget and the
+// frequency is known well enough to stay within it until the next poll; it
+// halves when they do not.
+// Not thread safe, TimeManager drives it from its sync task.
+class ClockDiscipline {
+public:
+    static constexpr uint8_t minPollExp = 6;          // 64 s
+    static constexpr uint8_t maxPollExp = 17;         // 36.4 h
+    static constexpr uint8_t maxSamples = 8;          // for the frequency fit
+    static constexpr int64_t stepThresholdUs = 128000;
+    static constexpr int32_t maxSlewPpm = 500;
+    static constexpr int32_t maxFreqPpb = 500000;     // beyond that it is not a crystal
+    static constexpr int32_t initialWanderPpb = 100000; // frequency unknown yet
+    static constexpr int32_t minWanderPpb = 50;
+    static constexpr int64_t defaultErrorBudgetUs = 50000;
+    static constexpr uint8_t pollUpAfter = 2;         // good predictions in a row
+
+    enum class Action { Step, Slew };
+
+    // a sync result: UTC minus local time measured at localUs, with its root distance
+    Action update(int64_t localUs, int64_t offsetUs, int64_t distanceUs);
+    void missed() { if (misses_ < 255) misses_++; }
+    void reset();
+
+    const ClockModel& model() const { return model_; }
+    bool isSet() const { return count_ > 0; }
+    // seconds until the next sync; after failed syncs the retries start at
+    // 2^minPollExp and back off up to the regular interval
+    uint32_t nextPollS() const;
+    uint32_t pollIntervalS() const { return 1u << pollExp_; }
+    int64_t lastResidualUs() const { return residualUs_; } // measured minus predicted at the last update
+
+    void setErrorBudgetUs(int64_t us) { errorBudgetUs_ = us; }
+    int64_t errorBudgetUs() const { return errorBudgetUs_; }
+
+private:
+    struct Sample {
+        int64_t localUs;
+        int64_t offsetUs;
+    };
+    void add(int64_t localUs, int64_t offsetUs);
+    bool fit(int32_t& freqPpb, int32_t& wanderPpb, int64_t distanceUs) const;
+
+    ClockModel model_;
+    Sample samples_[maxSamples];
+    uint8_t count_ = 0;
+    uint8_t next_ = 0;
+    uint8_t pollExp_ = minPollExp;
+    uint8_t goodInARow_ = 0;
+    uint8_t misses_ = 0;
+    int64_t residualUs_ = 0;
+    int64_t errorBudgetUs_ = defaultErrorBudgetUs;
+};
+
+#endif // CLOCK_DISCIPLINE_H
@@ -0,0 +1,158 @@
+#include "DeferredLog.h"
+#include <LoggingBase.h>
+#include <stdio.h>
+#include <string.h>
+
+constexpr size_t DeferredLog::lineBufferSize;
+
+DeferredLog& deferredLog() {
+    static DeferredLog log;
+    return log;
+}
+
+DeferredLog::DeferredLog() {
+    consumerMutex = xSemaphoreCreateMutex();
+}
+
+void DeferredLog::push(const Record& r) {
+    logged_.fetch_add(1, std::memory_order_relaxed);
+    if (!taskAlive.load(std::memory_order_acquire)) {
+        print(r); // nobody flushes, behave like a plain gLogger call
+        return;
+    }
+    if (!queue_.push(r)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void DeferredLog::print(const Record& r) {
+    char line[lineBufferSize];
+    format(r, line, sizeof(line));
+    gLogger->println(line);
+}
+
+void DeferredLog::flush() {
+    xSemaphoreTake(consumerMutex, portMAX_DELAY);
+    Record r;
+    while (queue_.pop(r)) {
+        print(r);
+    }
+    uint32_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped != droppedReported_) {
+        gLogger->print("[DeferredLog] dropped ");
+        gLogger->print(dropped - droppedReported_);
+        gLogger->println(" messages, queue full");
+        droppedReported_ = dropped;
+    }
+    xSemaphoreGive(consumerMutex);
+}
+
+size_t DeferredLog::format(const Record& r, char* buf, size_t len) {
+    if (len == 0) {
+        return 0;
+    }
+    size_t n = 0;
+    uint8_t arg = 0;
+    const char* p = r.format;
+    while (*p && n + 1 < len) {
+        if (*p != '%') {
+            buf[n++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            buf[n++] = '%';
+            p += 2;
+            continue;
+        }
+        // copy one conversion spec without length modifiers, every argument is 32 bits
+        char spec[16];
+        size_t s = 0;
+        spec[s++] = *p++;
+        while (*p && strchr("-+ #0123456789.", *p) && s < sizeof(spec) - 3) spec[s++] = *p++;
+        while (*p && strchr("hlLqjzt", *p)) p++;
+        char conv = *p;
+        if (!conv) {
+            break;
+        }
+        p++;
+        spec[s++] = conv;
+        spec[s] = 0;
+
+        int w;
+        if (arg >= r.argc) {
+            w = snprintf(buf + n, len - n, "?");
+        } else {
+            const Arg& a = r.args[arg++];
+            switch (conv) {
+                case 'd': case 'i':
+                    w = snprintf(buf + n, len - n, spec, a.i);
+                    break;
+                case 'u': case 'x': case 'X': case 'o': case 'c':
+                    w = snprintf(buf + n, len - n, spec, a.u);
+                    break;
+                case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+                    w = snprintf(buf + n, len - n, spec, (double)a.f);
+                    break;
+                case 's':
+                    w = snprintf(buf + n, len - n, spec, a.s ? a.s : "(null)");
+                    break;
+                default:
+                    w = snprintf(buf + n, len - n, "?");
+                    break;
+            }
+        }
+        // snprintf returns what it would have written; keep what actually fits
+        if (w > 0) {
+            n += (size_t)w < len - n ? (size_t)w : len - n - 1;
+        }
+    }
+    buf[n] = 0;
+    return n;
+}
+
+bool DeferredLog::start(UBaseType_t priority, BaseType_t core, uint32_t period) {
+    if (taskAlive.load()) {
+        return true;
+    }
+    periodMs = period;
+    taskRunning = true;
+    taskAlive = true;
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        &_task,
+        "DeferredLog",
+        4*1024,
+        this,
+        priority,
+        &taskHandle,
+        core
+    );
+    if (ok != pdPASS) {
+        gLogger->println("Failed to create DeferredLog task");
+        taskRunning = false;
+        taskAlive = false;
+        return false;
+    }
+    return true;
+}
+
+void DeferredLog::stop() {
+    if (!taskAlive.load()) {
+        return;
+    }
+    taskRunning = false;
+    while (taskAlive.load()) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    taskHandle = nullptr;
+    flush(); // whatever was pushed while the task wound down
+}
+
+void DeferredLog::_task(void* pvParameters) {
+    auto self = static_cast<DeferredLog*>(pvParameters);
+    while (self->taskRunning.load()) {
+        self->flush();
+        vTaskDelay(pdMS_TO_TICKS(self->periodMs));
+    }
+    self->taskAlive = false;
+    vTaskDelete(NULL);
+}
@@ -0,0 +1,101 @@
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <type_traits>
+#include "MpscRing.h"
+
+// Logging off the hot path. log() only copies the format string pointer and the
+// raw arguments into a lock-free queue; a low priority task formats them and
+// writes them to gLogger later, so a slow serial or network logger no longer
+// runs while a caller holds a mutex.
+//
+//   deferredLog().log("[WiFiWrapper] Connected after %u ms", duration);
+//
+// printf style conversions: d i u x X o c f e g s, flags, width and precision;
+// up to maxArgs arguments of 32 bits each. Strings (%s) are stored as pointers,
+// so only pass literals or other storage that outlives the flush (no String::c_str()).
+// Until start() is called, log() formats and prints right away.
+class DeferredLog {
+public:
+    static constexpr uint8_t maxArgs = 10;
+    static constexpr uint32_t capacity = 32;      // queued records, power of two
+    static constexpr size_t lineBufferSize = 192; // longest formatted line
+
+    union Arg {
+        int32_t i;
+        uint32_t u;
+        float f;
+        const char* s;
+    };
+    struct Record {
+        const char* format;
+        uint8_t argc;
+        Arg args[maxArgs];
+    };
+
+    DeferredLog();
+
+    // the flushing task; it wakes every periodMs and prints what was queued
+    bool start(UBaseType_t priority = tskIDLE_PRIORITY + 1, BaseType_t core = tskNO_AFFINITY, uint32_t periodMs = 50);
+    void stop(); // blocks until the task has exited, then flushes the rest
+    bool isRunning() const { return taskAlive.load(); }
+
+    template<typename... Args>
+    void log(const char* format, Args... args) {
+        static_assert(sizeof...(Args) <= maxArgs, "DeferredLog: too many arguments");
+        Record r;
+        r.format = format;
+        r.argc = sizeof...(Args);
+        fill(r.args, args...);
+        push(r);
+    }
+
+    // prints everything queued so far from the calling task, e.g. before a deep sleep
+    void flush();
+
+    uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); } // queue was full
+    uint32_t logged() const { return logged_.load(std::memory_order_relaxed); }
+
+    // the line a record turns into; returns its length, truncated to fit len
+    static size_t format(const Record& r, char* buf, size_t len);
+
+private:
+    static void fill(Arg*) {}
+    template<typename T, typename... Rest>
+    static void fill(Arg* out, T first, Rest... rest) {
+        *out = toArg(first);
+        fill(out + 1, rest...);
+    }
+
+    template<typename T>
+    static typename std::enable_if<std::is_integral<T>::value, Arg>::type toArg(T v) {
+        Arg a;
+        if (std::is_signed<T>::value) a.i = (int32_t)v;
+        else a.u = (uint32_t)v;
+        return a;
+    }
+    static Arg toArg(double v) { Arg a; a.f = (float)v; return a; }
+    static Arg toArg(const char* s) { Arg a; a.s = s; return a; }
+
+    void push(const Record& r);
+    void print(const Record& r);
+    static void _task(void* pvParameters);
+
+    MpscRing<Record, capacity> queue_;
+    SemaphoreHandle_t consumerMutex; // the task and flush() take turns as the single consumer
+    std::atomic<uint32_t> dropped_{0};
+    std::atomic<uint32_t> logged_{0};
+    uint32_t droppedReported_ = 0;
+
+    uint32_t periodMs = 50;
+    TaskHandle_t taskHandle = nullptr;
+    std::atomic<bool> taskRunning{false};
+    std::atomic<bool> taskAlive{false};
+};
+
+// the process wide instance
+DeferredLog& deferredLog();
+
+#endif // DEFERRED_LOG_H
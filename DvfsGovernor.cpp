@@ -0,0 +1,217 @@
+#include "DvfsGovernor.h"
+#include "ThermalGovernor.h"
+#include <LoggingBase.h>
+#include <atomic>
+#include "esp_timer.h"
+#include "Metrics.h"
+
+constexpr uint16_t DvfsGovernor::pStates[];
+
+namespace {
+
+std::atomic<uint32_t> gBoostUntil{0};
+std::atomic<uint32_t> gBoostMhz{0};
+std::atomic<uint32_t> gBoostSeq{0};
+std::atomic<uint32_t> gBoostRequestedAt{0};
+
+// ESP32 modem-sleep supply current (datasheet, both cores), idle and fully busy, mA
+constexpr float idleMa[DvfsStats::numPStates] = {20.0f, 27.0f, 30.0f};
+constexpr float busyMa[DvfsStats::numPStates] = {31.0f, 44.0f, 68.0f};
+constexpr float supplyVolts = 3.3f;
+
+Counter& freqChangesMetric = metrics().counter("cpu.freq_changes");
+Gauge& freqMetric = metrics().gauge("cpu.mhz");
+Gauge& loadMetric = metrics().gauge("cpu.load_pct");
+
+bool boostActive(uint32_t now) {
+    return (int32_t)(gBoostUntil.load(std::memory_order_acquire) - now) > 0;
+}
+
+} // namespace
+
+void dvfsBoost(uint32_t durationMs, uint32_t minMhz) {
+    uint32_t now = millis();
+    uint32_t until = now + durationMs;
+    if (!boostActive(now)) {
+        gBoostMhz.store(minMhz, std::memory_order_relaxed);
+        gBoostRequestedAt.store(now, std::memory_order_relaxed);
+    } else {
+        uint32_t mhz = gBoostMhz.load(std::memory_order_relaxed);
+        while (mhz < minMhz && !gBoostMhz.compare_exchange_weak(mhz, minMhz, std::memory_order_relaxed)) {
+        }
+    }
+    uint32_t old = gBoostUntil.load(std::memory_order_relaxed);
+    while ((int32_t)(until - old) > 0 &&
+           !gBoostUntil.compare_exchange_weak(old, until, std::memory_order_release)) {
+    }
+    gBoostSeq.fetch_add(1, std::memory_order_release);
+}
+
+uint32_t OnDemandPolicy::select(const DvfsInputs& in) {
+    // cycles actually used, in MHz
+    float used = in.load * in.currentMhz;
+
+    if (in.load >= upThreshold) {
+        fitsLower_ = false;
+        // jump to where the load would sit at the threshold; a saturated core
+        // hides how much more it wants, so go all the way up then
+        return in.load >= 0.99f ? in.maxMhz : (uint32_t)(used / upThreshold) + 1;
+    }
+
+    // next lower P-state
+    uint32_t lower = 0;
+    for (uint16_t f : DvfsGovernor::pStates) {
+        if (f < in.currentMhz) lower = f;
+    }
+    if (lower == 0 || used / lower >= downThreshold) {
+        fitsLower_ = false;
+        return in.currentMhz;
+    }
+    if (!fitsLower_) {
+        fitsLower_ = true;
+        fitsLowerSince_ = in.now;
+    }
+    if (in.now - fitsLowerSince_ >= downHoldMs) {
+        fitsLower_ = false;
+        return lower;
+    }
+    return in.currentMhz;
+}
+
+DvfsGovernor::DvfsGovernor(ThermalGovernor* thermal) : thermal_(thermal) {
+    if (thermal_) {
+        thermal_->setApplyFrequency(false); // we own the clock now
+    }
+}
+
+DvfsGovernor::~DvfsGovernor() {
+    if (thermal_) {
+        thermal_->setApplyFrequency(true);
+    }
+}
+
+void DvfsGovernor::setPolicy(DvfsPolicy* policy) {
+    policy_ = policy;
+}
+
+uint8_t DvfsGovernor::pStateAtLeast(uint32_t mhz) {
+    for (uint8_t i = 0; i < numPStates; ++i) {
+        if (pStates[i] >= mhz) return i;
+    }
+    return numPStates - 1;
+}
+
+uint8_t DvfsGovernor::pStateAtMost(uint32_t mhz) {
+    uint8_t i = numPStates - 1;
+    while (i > 0 && pStates[i] > mhz) --i;
+    return i;
+}
+
+float DvfsGovernor::measureLoad() {
+    if (loadSource_) {
+        return loadSource_();
+    }
+#if configGENERATE_RUN_TIME_STATS
+    // idle task run time of all cores against wall time, both in microseconds;
+    // ulTaskGetIdleRunTimeCounter() would only see the core we run on
+    uint32_t idle = 0;
+    for (BaseType_t core = 0; core < portNUM_PROCESSORS; ++core) {
+        idle += ulTaskGetRunTimeCounter(xTaskGetIdleTaskHandleForCore(core));
+    }
+    uint32_t time = (uint32_t)esp_timer_get_time();
+    uint32_t dIdle = idle - lastIdle_;
+    uint32_t dTime = time - lastTime_;
+    lastIdle_ = idle;
+    lastTime_ = time;
+    if (dTime == 0) {
+        return load_;
+    }
+    float load = 1.0f - (float)dIdle / ((float)dTime * portNUM_PROCESSORS);
+    return load < 0.0f ? 0.0f : (load > 1.0f ? 1.0f : load);
+#else
+    // no run time stats: assume busy, i.e. behave like the performance policy
+    if (!warnedNoLoad_) {
+        warnedNoLoad_ = true;
+        gLogger->println("[DvfsGovernor] No FreeRTOS run time stats, the load reads 100% and the clock "
+                         "stays at the top. Set a load source with setLoadSource().");
+    }
+    return 1.0f;
+#endif
+}
+
+void DvfsGovernor::account(uint32_t elapsed, float load, uint32_t maxMhz) {
+    DvfsStats& s = policy_->stats_;
+    uint8_t p = pStateAtLeast(currentMhz_);
+    s.timeMs[p] += elapsed;
+    float ma = idleMa[p] + load * (busyMa[p] - idleMa[p]);
+    s.energyMj += ma * supplyVolts * elapsed / 1000.0f;
+    if (load >= 0.95f && currentMhz_ < maxMhz) {
+        s.saturatedMs += elapsed;
+    }
+}
+
+uint32_t DvfsGovernor::update(uint32_t now) {
+    if (!policy_) {
+        return currentMhz_;
+    }
+    if (!started_) {
+        started_ = true;
+        lastUpdate_ = now;
+        currentMhz_ = getCpuFrequencyMhz();
+        measureLoad(); // sets the reference point
+        boostSeq_ = gBoostSeq.load(std::memory_order_acquire);
+        return currentMhz_;
+    }
+
+    uint32_t elapsed = now - lastUpdate_;
+    lastUpdate_ = now;
+    load_ = measureLoad();
+    loadMetric.set((int32_t)(load_ * 100.0f + 0.5f));
+
+    DvfsInputs in;
+    in.now = now;
+    in.currentMhz = currentMhz_;
+    in.load = load_;
+    in.maxMhz = thermal_ ? thermal_->currentFrequency() : pStates[numPStates - 1];
+    in.boostMhz = boostActive(now) ? gBoostMhz.load(std::memory_order_relaxed) : 0;
+
+    account(elapsed, load_, in.maxMhz);
+
+    DvfsStats& s = policy_->stats_;
+    uint32_t seq = gBoostSeq.load(std::memory_order_acquire);
+    if (seq != boostSeq_) {
+        s.boosts += seq - boostSeq_;
+        boostSeq_ = seq;
+        if (!boostPending_ && currentMhz_ < in.boostMhz) {
+            // (already fast enough counts as no latency)
+            boostPending_ = true;
+            boostRequestedAt_ = gBoostRequestedAt.load(std::memory_order_relaxed);
+        }
+    }
+
+    uint32_t want = policy_->select(in);
+    if (want < in.boostMhz) want = in.boostMhz;
+    uint32_t target = pStates[pStateAtLeast(want)];
+    if (target > in.maxMhz) target = pStates[pStateAtMost(in.maxMhz)]; // thermal budget wins over boosts
+
+    if (target != currentMhz_) {
+        if (setCpuFrequencyMhz(target)) {
+            currentMhz_ = target;
+            s.changes++;
+            freqChangesMetric.add();
+            freqMetric.set(target);
+            metrics().event(MetricEvent::CpuFrequency, target);
+        } else {
+            gLogger->println("[DvfsGovernor] Could not set CPU frequency.");
+        }
+    }
+
+    // boost latency: from the request until the clock met it (or the cap allowed no more)
+    if (boostPending_ && (currentMhz_ >= in.boostMhz || currentMhz_ >= in.maxMhz)) {
+        boostPending_ = false;
+        uint32_t latency = now - boostRequestedAt_;
+        s.boostLatencyTotalMs += latency;
+        if (latency > s.boostLatencyMaxMs) s.boostLatencyMaxMs = latency;
+    }
+    return currentMhz_;
+}
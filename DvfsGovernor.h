@@ -0,0 +1,129 @@
+#ifndef DVFS_GOVERNOR_H
+#define DVFS_GOVERNOR_H
+
+#include <Arduino.h>
+
+class ThermalGovernor;
+
+// Ask for at least minMhz for the next durationMs, e.g. before a latency critical
+// burst (WiFi wake-up, touch event). Lock free, callable from any task, and a
+// no-op if no DvfsGovernor is running. Overlapping requests keep the highest
+// frequency and the latest end.
+void dvfsBoost(uint32_t durationMs, uint32_t minMhz = 240);
+
+// What a policy gets to decide on, sampled by DvfsGovernor::update()
+struct DvfsInputs {
+    uint32_t now;            // millis()
+    uint32_t currentMhz;     // clock during the last interval
+    float load;              // 0..1 busy share of the last interval at currentMhz
+    uint32_t boostMhz;       // active boost floor, 0 if none
+    uint32_t maxMhz;         // thermal budget: highest clock allowed right now
+};
+
+struct DvfsStats {
+    static constexpr uint8_t numPStates = 3;
+    uint32_t timeMs[numPStates] = {0, 0, 0};  // per P-state, see DvfsGovernor::pStates
+    float energyMj = 0;        // estimate from datasheet currents at 3.3 V
+    uint32_t changes = 0;
+    uint32_t saturatedMs = 0;  // load >= 95% while a faster clock was allowed: work was delayed
+    uint32_t boosts = 0;       // boost requests seen
+    uint32_t boostLatencyMaxMs = 0;   // request until the clock met it
+    uint32_t boostLatencyTotalMs = 0; // divide by boosts for the average
+};
+
+// Pluggable frequency selection. select() returns the wanted clock in MHz; the
+// governor rounds it up to a P-state, then applies the boost floor and the thermal cap.
+class DvfsPolicy {
+public:
+    virtual ~DvfsPolicy() {}
+    virtual const char* name() const = 0;
+    virtual uint32_t select(const DvfsInputs& in) = 0;
+
+    // accumulated while this policy was active
+    const DvfsStats& stats() const { return stats_; }
+    void resetStats() { stats_ = DvfsStats(); }
+
+private:
+    friend class DvfsGovernor;
+    DvfsStats stats_;
+};
+
+// always the fastest clock the thermal budget allows
+class PerformancePolicy : public DvfsPolicy {
+public:
+    const char* name() const override { return "performance"; }
+    uint32_t select(const DvfsInputs& in) override { return in.maxMhz; }
+};
+
+// always the slowest clock, only boosts raise it
+class PowersavePolicy : public DvfsPolicy {
+public:
+    const char* name() const override { return "powersave"; }
+    uint32_t select(const DvfsInputs&) override { return 0; }
+};
+
+// lowest clock that keeps utilization under upThreshold; steps up as soon as the
+// load crosses it, steps down only after the load would have fit below
+// downThreshold at the lower clock for downHoldMs
+class OnDemandPolicy : public DvfsPolicy {
+public:
+    float upThreshold = 0.85f;
+    float downThreshold = 0.6f;
+    uint32_t downHoldMs = 500;
+
+    const char* name() const override { return "ondemand"; }
+    uint32_t select(const DvfsInputs& in) override;
+
+private:
+    uint32_t fitsLowerSince_ = 0;
+    bool fitsLower_ = false;
+};
+
+// Picks the CPU clock from load (idle task run time of both cores), boost
+// requests and the thermal budget. Call update() periodically, every 50-100 ms.
+// The idle time needs configGENERATE_RUN_TIME_STATS, which the Arduino core
+// leaves off: without it every policy sees 100% load and keeps the top clock
+// (logged once) unless setLoadSource() supplies the load.
+// With a ThermalGovernor attached, the governor no longer sets the clock itself;
+// its P-state becomes the cap here, e.g. DvfsGovernor dvfs(&safetyManager.governor());
+class DvfsGovernor {
+public:
+    static constexpr uint8_t numPStates = DvfsStats::numPStates;
+    static constexpr uint16_t pStates[numPStates] = {80, 160, 240};
+
+    explicit DvfsGovernor(ThermalGovernor* thermal = nullptr);
+    ~DvfsGovernor();
+
+    void setPolicy(DvfsPolicy* policy);
+    DvfsPolicy* policy() const { return policy_; }
+    // overrides the idle task based load, 0..1; required if run time stats are disabled
+    void setLoadSource(float (*loadSource)()) { loadSource_ = loadSource; }
+
+    uint32_t update(uint32_t now);  // returns the clock in MHz
+
+    float load() const { return load_; }
+    uint32_t currentFrequency() const { return currentMhz_; }
+
+private:
+    float measureLoad();
+    static uint8_t pStateAtLeast(uint32_t mhz);
+    static uint8_t pStateAtMost(uint32_t mhz);
+    void account(uint32_t elapsed, float load, uint32_t maxMhz);
+
+    ThermalGovernor* thermal_;
+    DvfsPolicy* policy_ = nullptr;
+    float (*loadSource_)() = nullptr;
+
+    bool started_ = false;
+    uint32_t lastUpdate_ = 0;
+    uint32_t lastIdle_ = 0;
+    uint32_t lastTime_ = 0;
+    float load_ = 0;
+    bool warnedNoLoad_ = false;
+    uint32_t currentMhz_ = 240;
+    uint32_t boostSeq_ = 0;          // last boost request accounted for
+    uint32_t boostRequestedAt_ = 0;
+    bool boostPending_ = false;
+};
+
+#endif // DVFS_GOVERNOR_H
@@ -0,0 +1,199 @@
+#include "Metrics.h"
+#include <LoggingBase.h>
+#include <string.h>
+
+constexpr uint8_t Histogram::numBuckets;
+constexpr uint32_t Metrics::eventCapacity;
+
+namespace {
+
+void put32(uint8_t*& p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+    p += 4;
+}
+
+void put16(uint8_t*& p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p += 2;
+}
+
+constexpr size_t headerSize = 16;
+constexpr size_t counterSize = 8;
+constexpr size_t gaugeSize = 8;
+constexpr size_t histogramSize = 12 + 4 * Histogram::numBuckets;
+constexpr size_t eventSize = 16;
+
+} // namespace
+
+Metrics& metrics() {
+    static Metrics registry;
+    return registry;
+}
+
+uint8_t Histogram::bucketFor(uint32_t ms) {
+    if (ms == 0) return 0;
+    uint8_t b = 32 - __builtin_clz(ms); // ms in [2^(b-1), 2^b)
+    return b < numBuckets ? b : numBuckets - 1;
+}
+
+void Histogram::record(uint32_t ms) {
+    buckets_[bucketFor(ms)].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(ms, std::memory_order_relaxed);
+    uint32_t m = max_.load(std::memory_order_relaxed);
+    while (ms > m && !max_.compare_exchange_weak(m, ms, std::memory_order_relaxed)) {
+    }
+}
+
+uint32_t Histogram::count() const {
+    uint32_t n = 0;
+    for (uint8_t i = 0; i < numBuckets; ++i) n += bucket(i);
+    return n;
+}
+
+uint32_t Metrics::nameId(const char* name) {
+    uint32_t h = 2166136261u;
+    for (; *name; ++name) {
+        h ^= (uint8_t)*name;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+template<typename T, uint8_t N>
+T& Metrics::find(Table<T, N>& table, const char* name) {
+    uint32_t id = nameId(name);
+    // registration is rare and short, a spin lock keeps it usable before the scheduler runs
+    while (registering_.test_and_set(std::memory_order_acquire)) {
+    }
+    uint8_t n = table.count.load(std::memory_order_relaxed);
+    for (uint8_t i = 0; i < n; ++i) {
+        if (table.ids[i] == id && strcmp(table.names[i], name) == 0) {
+            registering_.clear(std::memory_order_release);
+            return table.items[i];
+        }
+    }
+    if (n == N) {
+        registering_.clear(std::memory_order_release);
+        gLogger->print("[Metrics] Table full, not registered: ");
+        gLogger->println(name);
+        return table.overflow;
+    }
+    table.names[n] = name;
+    table.ids[n] = id;
+    table.count.store(n + 1, std::memory_order_release);
+    registering_.clear(std::memory_order_release);
+    return table.items[n];
+}
+
+Counter& Metrics::counter(const char* name) {
+    return find(counters_, name);
+}
+
+Gauge& Metrics::gauge(const char* name) {
+    return find(gauges_, name);
+}
+
+Histogram& Metrics::histogram(const char* name) {
+    return find(histograms_, name);
+}
+
+void Metrics::event(MetricEvent type, int32_t value) {
+    uint32_t seq = eventHead_.fetch_add(1, std::memory_order_acq_rel);
+    EventSlot& slot = ring_[seq & (eventCapacity - 1)];
+    slot.seq.store(0, std::memory_order_relaxed); // being written
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.timeMs.store(millis(), std::memory_order_relaxed);
+    slot.type.store((uint16_t)type, std::memory_order_relaxed);
+    slot.value.store(value, std::memory_order_relaxed);
+    slot.seq.store(seq + 1, std::memory_order_release);
+}
+
+uint32_t Metrics::events(uint32_t since, MetricEventRecord* out, uint32_t maxOut) const {
+    uint32_t head = eventCount();
+    if ((int32_t)(head - since) <= 0) {
+        return 0;
+    }
+    uint32_t first = head - since > eventCapacity ? head - eventCapacity : since;
+    uint32_t n = 0;
+    for (uint32_t seq = first; seq != head && n < maxOut; ++seq) {
+        const EventSlot& slot = ring_[seq & (eventCapacity - 1)];
+        uint32_t before = slot.seq.load(std::memory_order_acquire);
+        MetricEventRecord r;
+        r.seq = seq;
+        r.timeMs = slot.timeMs.load(std::memory_order_relaxed);
+        r.type = (MetricEvent)slot.type.load(std::memory_order_relaxed);
+        r.value = slot.value.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (before != seq + 1 || slot.seq.load(std::memory_order_relaxed) != before) {
+            continue; // overwritten by a newer event or still being written
+        }
+        out[n++] = r;
+    }
+    return n;
+}
+
+size_t Metrics::exportSize() const {
+    return headerSize + counterCount() * counterSize + gaugeCount() * gaugeSize +
+           histogramCount() * histogramSize + eventCapacity * eventSize;
+}
+
+size_t Metrics::exportBinary(uint8_t* buf, size_t len, uint32_t eventsSince) const {
+    uint8_t nc = counterCount();
+    uint8_t ng = gaugeCount();
+    uint8_t nh = histogramCount();
+    size_t fixed = headerSize + nc * counterSize + ng * gaugeSize + nh * histogramSize;
+    if (len < fixed) {
+        return 0;
+    }
+    uint32_t maxEvents = (len - fixed) / eventSize;
+    if (maxEvents > eventCapacity) maxEvents = eventCapacity;
+
+    uint8_t* p = buf;
+    put32(p, exportMagic);
+    put32(p, millis());
+    *p++ = nc;
+    *p++ = ng;
+    *p++ = nh;
+    *p++ = Histogram::numBuckets;
+    uint8_t* eventCountAt = p;
+    put32(p, 0); // patched below
+    for (uint8_t i = 0; i < nc; ++i) {
+        put32(p, counters_.ids[i]);
+        put32(p, counters_.items[i].value());
+    }
+    for (uint8_t i = 0; i < ng; ++i) {
+        put32(p, gauges_.ids[i]);
+        put32(p, (uint32_t)gauges_.items[i].value());
+    }
+    for (uint8_t i = 0; i < nh; ++i) {
+        const Histogram& h = histograms_.items[i];
+        put32(p, histograms_.ids[i]);
+        put32(p, h.sum());
+        put32(p, h.max());
+        for (uint8_t b = 0; b < Histogram::numBuckets; ++b) put32(p, h.bucket(b));
+    }
+    // a few events at a time, keeps the stack small
+    MetricEventRecord ev[8];
+    uint32_t ne = 0;
+    uint32_t since = eventsSince;
+    while (ne < maxEvents) {
+        uint32_t want = maxEvents - ne < 8 ? maxEvents - ne : 8;
+        uint32_t got = events(since, ev, want);
+        if (got == 0) break;
+        for (uint32_t i = 0; i < got; ++i) {
+            put32(p, ev[i].seq);
+            put32(p, ev[i].timeMs);
+            put16(p, (uint16_t)ev[i].type);
+            put16(p, 0);
+            put32(p, (uint32_t)ev[i].value);
+        }
+        ne += got;
+        since = ev[got - 1].seq + 1;
+    }
+    put32(eventCountAt, ne);
+    return p - buf;
+}
@@ -0,0 +1,158 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Telemetry shared by all managers, so dashboards do not have to parse log text.
+// Counters, gauges and histograms are registered once by name and then updated
+// lock free through the returned reference, from any task:
+//   static Counter& reconnects = metrics().counter("wifi.reconnects");
+//   reconnects.add();
+// Everything is fixed size; nothing allocates after registration.
+
+class Counter {
+public:
+    void add(uint32_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    uint32_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint32_t> value_{0};
+};
+
+class Gauge {
+public:
+    void set(int32_t v) { value_.store(v, std::memory_order_relaxed); }
+    int32_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int32_t> value_{0};
+};
+
+// Latency histogram in ms with fixed power-of-two buckets: bucket 0 counts 0 ms,
+// bucket i counts [2^(i-1), 2^i) ms, the last one everything from 2^(numBuckets-2) ms (~65 s) up.
+class Histogram {
+public:
+    static constexpr uint8_t numBuckets = 18;
+
+    void record(uint32_t ms);
+
+    uint32_t count() const;
+    uint32_t sum() const { return sum_.load(std::memory_order_relaxed); } // ms, wraps after ~49 days
+    uint32_t max() const { return max_.load(std::memory_order_relaxed); }
+    uint32_t bucket(uint8_t i) const { return buckets_[i].load(std::memory_order_relaxed); }
+
+    static uint8_t bucketFor(uint32_t ms);
+    static uint32_t bucketLow(uint8_t i) { return i == 0 ? 0 : 1u << (i - 1); }
+
+private:
+    std::atomic<uint32_t> buckets_[numBuckets] = {};
+    std::atomic<uint32_t> sum_{0};
+    std::atomic<uint32_t> max_{0};
+};
+
+// what happened, for the event ring; the value's meaning depends on the type
+enum class MetricEvent : uint16_t {
+    None = 0,
+    WifiConnected,      // value: WiFiWrapper::ConnectPath
+    WifiConnectFailed,
+    WifiLost,
+    WifiRoam,           // value: RSSI of the new AP
+    WifiPowerMode,      // value: 0 full, 1 low power
+    CpuFrequency,       // value: MHz
+    ThermalLevel,       // value: mitigation level
+    ThermalShutdown,    // value: filtered temperature in 0.1 °C
+    TimeSync,           // value: correction of the local clock in ms
+    TimeSyncFailed,
+    TouchPress,         // value: pin
+};
+
+struct MetricEventRecord {
+    uint32_t seq;       // running number, gaps mean the ring overwrote events
+    uint32_t timeMs;    // millis()
+    MetricEvent type;
+    int32_t value;
+};
+
+class Metrics {
+public:
+    static constexpr uint8_t maxCounters = 32;
+    static constexpr uint8_t maxGauges = 16;
+    static constexpr uint8_t maxHistograms = 8;
+    static constexpr uint32_t eventCapacity = 64; // power of two
+
+    // Find or register by name. The name must stay valid (use string literals).
+    // When a table is full a shared overflow metric is returned and the name is logged.
+    Counter& counter(const char* name);
+    Gauge& gauge(const char* name);
+    Histogram& histogram(const char* name);
+
+    // lock free, callable from any task; the oldest events are overwritten
+    void event(MetricEvent type, int32_t value = 0);
+    // seq of the next event, i.e. events recorded so far
+    uint32_t eventCount() const { return eventHead_.load(std::memory_order_acquire); }
+    // copies the events with seq >= since that are still in the ring, oldest first
+    uint32_t events(uint32_t since, MetricEventRecord* out, uint32_t maxOut) const;
+
+    // Compact binary snapshot, little endian:
+    //   u32 magic "TLM1", u32 millis(),
+    //   u8 counters, u8 gauges, u8 histograms, u8 buckets per histogram, u32 events
+    //   counters:   u32 id, u32 value
+    //   gauges:     u32 id, i32 value
+    //   histograms: u32 id, u32 sum, u32 max, u32 bucket[buckets]
+    //   events:     u32 seq, u32 timeMs, u16 type, u16 reserved, i32 value
+    // id is nameId(name). Only events with seq >= eventsSince are included, so a
+    // collector can poll with the last seq it saw + 1.
+    // Returns the bytes written. Events that do not fit are left for the next call,
+    // 0 if not even the metrics fit (see exportSize()).
+    static constexpr uint32_t exportMagic = 0x314D4C54; // "TLM1"
+    size_t exportBinary(uint8_t* buf, size_t len, uint32_t eventsSince = 0) const;
+    size_t exportSize() const; // upper bound for exportBinary() with all events
+
+    static uint32_t nameId(const char* name); // FNV-1a 32 bit
+
+    uint8_t counterCount() const { return counters_.count.load(std::memory_order_acquire); }
+    uint8_t gaugeCount() const { return gauges_.count.load(std::memory_order_acquire); }
+    uint8_t histogramCount() const { return histograms_.count.load(std::memory_order_acquire); }
+    const char* counterName(uint8_t i) const { return counters_.names[i]; }
+    const char* gaugeName(uint8_t i) const { return gauges_.names[i]; }
+    const char* histogramName(uint8_t i) const { return histograms_.names[i]; }
+    const Counter& counterAt(uint8_t i) const { return counters_.items[i]; }
+    const Gauge& gaugeAt(uint8_t i) const { return gauges_.items[i]; }
+    const Histogram& histogramAt(uint8_t i) const { return histograms_.items[i]; }
+
+private:
+    // entries [0, count) are complete, readers need no lock
+    template<typename T, uint8_t N>
+    struct Table {
+        const char* names[N] = {};
+        uint32_t ids[N] = {};
+        T items[N];
+        std::atomic<uint8_t> count{0};
+        T overflow;
+    };
+    template<typename T, uint8_t N>
+    T& find(Table<T, N>& table, const char* name);
+
+    // one slot of the event ring; seq is 0 while being written, else the event's seq + 1
+    struct EventSlot {
+        std::atomic<uint32_t> seq{0};
+        std::atomic<uint32_t> timeMs{0};
+        std::atomic<uint16_t> type{0};
+        std::atomic<int32_t> value{0};
+    };
+    static_assert((eventCapacity & (eventCapacity - 1)) == 0, "eventCapacity must be a power of two");
+
+    Table<Counter, maxCounters> counters_;
+    Table<Gauge, maxGauges> gauges_;
+    Table<Histogram, maxHistograms> histograms_;
+    std::atomic_flag registering_ = ATOMIC_FLAG_INIT; // registration only, never on an update
+
+    EventSlot ring_[eventCapacity];
+    std::atomic<uint32_t> eventHead_{0};
+};
+
+// the process wide registry, usable during static initialization
+Metrics& metrics();
+
+#endif // METRICS_H
@@ -0,0 +1,149 @@
+#include "MitigationLadder.h"
+#include <LoggingBase.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+// Shed load gradually and keep the station associated as long as possible:
+// TX power and modem sleep first, then the CPU clock and background work,
+// light sleep duty cycling, and deep sleep only at the very top. The light
+// sleep level sleeps 200 ms per check; checks run every checkPeriodMin (250 ms
+// by default) while mitigating, so the chip sleeps a bit under half the time.
+const MitigationLevel defaultLevels[] = {
+    // enter  exit  dwell   tx  maxPS  cpu  pause  wifiOff light  deep
+    {  85.0f, 80.0f, 10000, 15, false,   0, false, false,    0,    0},
+    {  90.0f, 85.0f, 15000, 11, true,  160, false, false,    0,    0},
+    {  93.0f, 88.0f, 20000,  8, true,   80, true,  false,    0,    0},
+    {  95.0f, 90.0f, 30000,  2, true,   80, true,  false,  200,    0},
+    { 100.0f,  0.0f,     0,  2, true,   80, true,  false,  200, 1800},
+};
+
+const MitigationLevel noLimits = {0.0f, 0.0f, 0, 20, false, 0, false, false, 0, 0};
+
+// one "key=value" or flag token into lvl
+bool parseOption(const char* tok, size_t len, MitigationLevel& lvl) {
+    const char* eq = (const char*)memchr(tok, '=', len);
+    size_t keyLen = eq ? (size_t)(eq - tok) : len;
+    auto is = [&](const char* key) { return strlen(key) == keyLen && strncmp(tok, key, keyLen) == 0; };
+
+    if (!eq) {
+        if (is("pause")) { lvl.pauseWorkloads = true; return true; }
+        if (is("wifioff")) { lvl.wifiOff = true; return true; }
+        return false;
+    }
+    const char* val = eq + 1;
+    const char* end = tok + len;
+    if (is("ps")) {
+        if (end - val == 3 && strncmp(val, "max", 3) == 0) { lvl.maxModemSleep = true; return true; }
+        if (end - val == 3 && strncmp(val, "min", 3) == 0) { lvl.maxModemSleep = false; return true; }
+        return false;
+    }
+    char* stop = nullptr;
+    unsigned long v = strtoul(val, &stop, 10);
+    if (stop != end || stop == val) return false;
+    if (is("tx") && v <= 20) { lvl.maxTxPowerDbm = (uint8_t)v; return true; }
+    if (is("cpu") && v <= 240) { lvl.cpuCapMhz = (uint16_t)v; return true; }
+    if (is("light") && v <= MitigationLadder::maxLightSleepMs) { lvl.lightSleepMs = v; return true; }
+    if (is("deep")) { lvl.deepSleepS = v; return true; }
+    return false;
+}
+
+bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+void logError(uint8_t level, const char* what) {
+    gLogger->print("[MitigationLadder] level ");
+    gLogger->print((unsigned int)level);
+    gLogger->print(": ");
+    gLogger->println(what);
+}
+
+} // namespace
+
+MitigationLadder MitigationLadder::defaults() {
+    MitigationLadder ladder;
+    ladder.set(defaultLevels, sizeof(defaultLevels) / sizeof(defaultLevels[0]));
+    return ladder;
+}
+
+const MitigationLevel& MitigationLadder::none() {
+    return noLimits;
+}
+
+bool MitigationLadder::valid(const MitigationLevel* levels, uint8_t count) {
+    if (count == 0 || count > maxLevels) {
+        return false;
+    }
+    for (uint8_t i = 0; i < count; ++i) {
+        // a NaN compares false both ways and would never trigger
+        if (!isfinite(levels[i].enterC) || !isfinite(levels[i].exitC)) return false;
+        if (levels[i].exitC >= levels[i].enterC) return false;
+        if (i > 0 && levels[i].enterC <= levels[i - 1].enterC) return false;
+        if (levels[i].lightSleepMs > maxLightSleepMs) return false;
+    }
+    return true;
+}
+
+bool MitigationLadder::set(const MitigationLevel* levels, uint8_t count) {
+    if (!valid(levels, count)) {
+        gLogger->println("[MitigationLadder] Rejected table: needs 1-8 levels, finite temperatures, rising enter, "
+                         "exit below enter and light sleep up to 500 ms.");
+        return false;
+    }
+    memcpy(levels_, levels, count * sizeof(MitigationLevel));
+    count_ = count;
+    return true;
+}
+
+bool MitigationLadder::parse(const char* text) {
+    MitigationLevel levels[maxLevels];
+    uint8_t count = 0;
+    const char* p = text;
+
+    while (p && *p) {
+        // one level up to ';' or the end of the line
+        const char* eol = p;
+        while (*eol && *eol != ';' && *eol != '\n') ++eol;
+
+        const char* q = p;
+        while (q < eol && isSpace(*q)) ++q;
+        if (q < eol) {
+            if (count == maxLevels) {
+                logError(count + 1, "too many levels");
+                return false;
+            }
+            MitigationLevel lvl = noLimits;
+            char* stop = nullptr;
+            lvl.enterC = strtof(q, &stop);
+            bool ok = stop != q;
+            q = stop;
+            lvl.exitC = ok ? strtof(q, &stop) : 0.0f;
+            ok = ok && stop != q;
+            q = stop;
+            float dwellS = ok ? strtof(q, &stop) : 0.0f;
+            // also rejects NaN, and anything whose ms do not fit dwellMs
+            ok = ok && stop != q && dwellS >= 0.0f && dwellS <= UINT32_MAX / 1000;
+            lvl.dwellMs = ok ? (uint32_t)(dwellS * 1000.0) : 0;
+            q = stop;
+            if (!ok || q > eol) {
+                logError(count + 1, "expected <enter> <exit> <dwell s>");
+                return false;
+            }
+            // options
+            while (q < eol) {
+                while (q < eol && isSpace(*q)) ++q;
+                const char* tok = q;
+                while (q < eol && !isSpace(*q)) ++q;
+                if (q > tok && !parseOption(tok, q - tok, lvl)) {
+                    logError(count + 1, "unknown option");
+                    return false;
+                }
+            }
+            levels[count++] = lvl;
+        }
+        p = *eol ? eol + 1 : eol;
+    }
+    return set(levels, count);
+}
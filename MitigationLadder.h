@@ -0,0 +1,61 @@
+#ifndef MITIGATION_LADDER_H
+#define MITIGATION_LADDER_H
+
+#include <Arduino.h>
+
+// One step of the thermal mitigation ladder. Each level is a complete set of
+// limits, not a delta: a level usually repeats the limits of the one below and
+// tightens some of them. Level 0 (not in the table) is normal operation.
+struct MitigationLevel {
+    float enterC;            // entered once the trend predicts this within TEMP_MITIGATION_LEAD_MS
+    float exitC;             // left for the level below at or under this, when not rising
+    uint32_t dwellMs;        // minimum time in the level before it may be left
+    uint8_t maxTxPowerDbm;   // TX power limit, 20 = unlimited
+    bool maxModemSleep;      // force WIFI_PS_MAX_MODEM, the station stays associated
+    uint16_t cpuCapMhz;      // highest CPU clock, 0 = no cap
+    bool pauseWorkloads;     // pause the workloads registered with TemperatureSafetyManager
+    bool wifiOff;            // stop WiFi completely
+    uint32_t lightSleepMs;   // light sleep this long after every check while in the level, up to maxLightSleepMs
+    uint32_t deepSleepS;     // deep sleep this long on entry; only on the filtered value, never a prediction
+};
+
+// Ordered table of mitigation levels, trivially copyable so it can be swapped
+// at runtime through a SeqLock. Enter temperatures rise strictly with the level.
+class MitigationLadder {
+public:
+    static constexpr uint8_t maxLevels = 8;
+    // one light sleep: a few beacon intervals, so the AP keeps the station;
+    // seconds get it dropped by some APs and stall a loop() caller that long
+    static constexpr uint32_t maxLightSleepMs = 500;
+
+    MitigationLadder() = default;
+
+    // the built-in ladder, see defaultLevels in MitigationLadder.cpp
+    static MitigationLadder defaults();
+
+    // false (and the ladder unchanged) if the table is empty, too long, not ordered
+    // or has a temperature that is not finite
+    bool set(const MitigationLevel* levels, uint8_t count);
+
+    // Text form, one level per line or ';' separated, e.g. from NVS or a config file:
+    //   <enter °C> <exit °C> <dwell s> [tx=<dBm>] [ps=max] [cpu=<MHz>] [pause] [wifioff]
+    //   [light=<ms>] [deep=<s>]
+    // "85 80 10 tx=15; 90 85 15 tx=11 ps=max cpu=160; 100 0 0 deep=1800"
+    // false (and the ladder unchanged) on any syntax error, which is logged. Dwell up to 4294967 s.
+    bool parse(const char* text);
+
+    uint8_t size() const { return count_; }
+    // level 1..size(), level(0) is not valid
+    const MitigationLevel& level(uint8_t n) const { return levels_[n - 1]; }
+
+    // what level 0 means: no limits at all
+    static const MitigationLevel& none();
+
+private:
+    static bool valid(const MitigationLevel* levels, uint8_t count);
+
+    MitigationLevel levels_[maxLevels];
+    uint8_t count_ = 0;
+};
+
+#endif // MITIGATION_LADDER_H
@@ -0,0 +1,67 @@
+#ifndef MPSC_RING_H
+#define MPSC_RING_H
+
+#include <atomic>
+#include <stdint.h>
+
+// Lock-free bounded multi-producer/single-consumer queue. Any number of tasks
+// push(), one task pop()s; nobody ever blocks. Each slot carries a sequence
+// number telling whose turn it is, so a producer that claimed a slot but has
+// not finished writing it simply looks empty to the consumer until it has.
+// N must be a power of two.
+template<typename T, uint32_t N>
+class MpscRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "MpscRing size must be a power of two");
+
+public:
+    MpscRing() {
+        for (uint32_t i = 0; i < N; ++i) {
+            slots_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // producer side, any task; returns false (and drops the item) if the ring is full
+    bool push(const T& item) {
+        uint32_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots_[pos & (N - 1)];
+            int32_t diff = (int32_t)(slot.seq.load(std::memory_order_acquire) - pos);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.item = item;
+                    slot.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // the consumer has not freed this slot yet
+            } else {
+                pos = head_.load(std::memory_order_relaxed); // another producer took it
+            }
+        }
+    }
+
+    // consumer side
+    bool pop(T& out) {
+        Slot& slot = slots_[tail_ & (N - 1)];
+        if (slot.seq.load(std::memory_order_acquire) != tail_ + 1) {
+            return false;
+        }
+        out = slot.item;
+        slot.seq.store(tail_ + N, std::memory_order_release);
+        tail_++;
+        return true;
+    }
+
+    static constexpr uint32_t capacity() { return N; }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> seq;
+        T item;
+    };
+    Slot slots_[N];
+    std::atomic<uint32_t> head_{0}; // next slot to claim, shared by the producers
+    uint32_t tail_ = 0;             // consumer only
+};
+
+#endif // MPSC_RING_H
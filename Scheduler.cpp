@@ -0,0 +1,465 @@
+#include "Scheduler.h"
+#include "Metrics.h"
+#include "DeferredLog.h"
+
+static Counter& runsMetric = metrics().counter("scheduler.runs");
+static Histogram& lateMsMetric = metrics().histogram("scheduler.late_ms"); // deadline until the callback starts
+
+Scheduler::Scheduler(TimeManager& time)
+    : time_(time)
+{
+    lock_ = xSemaphoreCreateMutex();
+    wake_ = xSemaphoreCreateBinary();
+    time_.onClockChange(&clockChanged, this);
+}
+
+Scheduler::~Scheduler() {
+    stop();
+    time_.removeClockChange(&clockChanged, this); // unless another one took the slot since
+    vSemaphoreDelete(wake_);
+    vSemaphoreDelete(lock_);
+}
+
+// from TimeManager's sync task, with its lock held
+void Scheduler::clockChanged(void* arg) {
+    auto self = static_cast<Scheduler*>(arg);
+    self->clockChanged_.store(true, std::memory_order_release);
+    xSemaphoreGive(self->wake_);
+}
+
+Scheduler::JobId Scheduler::daily(uint8_t hour, uint8_t minute, JobCallback callback, void* arg) {
+    return weekly(everyDay, hour, minute, callback, arg);
+}
+
+Scheduler::JobId Scheduler::weekly(uint8_t days, uint8_t hour, uint8_t minute, JobCallback callback, void* arg) {
+    if (!callback || !(days & everyDay) || hour > 23 || minute > 59) {
+        return invalidJob;
+    }
+    Job job;
+    job.kind = Kind::Weekly;
+    job.days = days & everyDay;
+    job.minute = hour * 60 + minute;
+    job.callback = callback;
+    job.arg = arg;
+    return add(job);
+}
+
+Scheduler::JobId Scheduler::at(uint32_t localTime, JobCallback callback, void* arg) {
+    if (!callback || localTime == 0) {
+        return invalidJob;
+    }
+    Job job;
+    job.kind = Kind::At;
+    job.local = localTime;
+    job.callback = callback;
+    job.arg = arg;
+    return add(job);
+}
+
+Scheduler::JobId Scheduler::every(uint32_t periodMs, JobCallback callback, void* arg) {
+    if (!callback || periodMs == 0) {
+        return invalidJob;
+    }
+    Job job;
+    job.kind = Kind::Every;
+    job.periodMs = periodMs;
+    job.callback = callback;
+    job.arg = arg;
+    return add(job);
+}
+
+Scheduler::JobId Scheduler::after(uint32_t delayMs, JobCallback callback, void* arg) {
+    if (!callback) {
+        return invalidJob;
+    }
+    Job job;
+    job.kind = Kind::After;
+    job.periodMs = delayMs;
+    job.callback = callback;
+    job.arg = arg;
+    return add(job);
+}
+
+Scheduler::JobId Scheduler::window(uint8_t days, uint8_t startHour, uint8_t startMinute, uint8_t endHour,
+                                   uint8_t endMinute, WindowCallback callback, void* arg) {
+    if (!callback || !(days & everyDay) || startHour > 23 || startMinute > 59 || endHour > 23 || endMinute > 59) {
+        return invalidJob;
+    }
+    uint16_t start = startHour * 60 + startMinute;
+    uint16_t end = endHour * 60 + endMinute;
+    if (start == end) {
+        return invalidJob;
+    }
+    Job job;
+    job.kind = Kind::Window;
+    job.days = days & everyDay;
+    job.minute = start;
+    job.length = (end + 1440 - start) % 1440;
+    job.windowCallback = callback;
+    job.arg = arg;
+    return add(job);
+}
+
+Scheduler::JobId Scheduler::add(const Job& job) {
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    uint8_t slot = 0;
+    while (slot < maxJobs && jobs_[slot].kind != Kind::Free) {
+        ++slot;
+    }
+    if (slot == maxJobs) {
+        xSemaphoreGive(lock_);
+        return invalidJob;
+    }
+    Job& j = jobs_[slot];
+    uint16_t generation = (j.generation + 1) & 0x7FFF;
+    j = job;
+    j.generation = generation ? generation : 1;
+
+    Now t = now();
+    switch (j.kind) {
+    case Kind::Every:
+    case Kind::After:
+        j.due = t.mono + (int64_t)j.periodMs * 1000;
+        break;
+    case Kind::Window:
+        // the dispatcher finds out whether it is open and reports it
+        j.due = t.synced ? t.mono : INT64_MAX;
+        break;
+    default:
+        arm(j, t);
+        break;
+    }
+    push(slot);
+    JobId id = ((JobId)j.generation << 8) | slot;
+    xSemaphoreGive(lock_);
+    xSemaphoreGive(wake_); // it may be due before whatever the task sleeps for
+    return id;
+}
+
+bool Scheduler::cancel(JobId id) {
+    if (id < 0) {
+        return false;
+    }
+    uint8_t slot = id & 0xFF;
+    bool ok = false;
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    if (slot < maxJobs && jobs_[slot].kind != Kind::Free && jobs_[slot].generation == (id >> 8)) {
+        remove(slot);
+        jobs_[slot].kind = Kind::Free;
+        ok = true;
+    }
+    xSemaphoreGive(lock_);
+    return ok;
+}
+
+bool Scheduler::isOpen(JobId id) const {
+    if (id < 0) {
+        return false;
+    }
+    uint8_t slot = id & 0xFF;
+    bool open = false;
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    if (slot < maxJobs && jobs_[slot].kind == Kind::Window && jobs_[slot].generation == (id >> 8)) {
+        open = jobs_[slot].open;
+    }
+    xSemaphoreGive(lock_);
+    return open;
+}
+
+uint8_t Scheduler::jobCount() const {
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    uint8_t n = heapSize_;
+    xSemaphoreGive(lock_);
+    return n;
+}
+
+Scheduler::Now Scheduler::now() const {
+    Now t;
+    t.mono = esp_timer_get_time();
+    t.synced = time_.isSynced();
+    t.utcUs = t.synced ? time_.getUnixUTCMicros() : 0;
+    return t;
+}
+
+int32_t Scheduler::localDay(uint32_t utc) const {
+    return (int32_t)(((int64_t)utc + time_.getUtcOffset(utc)) / 86400);
+}
+
+uint32_t Scheduler::utcOfLocal(int32_t day, uint32_t minute) const {
+    return time_.getUnixUTCTime((uint32_t)((int64_t)day * 86400 + minute * 60));
+}
+
+// the first local day in the mask after the given one
+int32_t Scheduler::nextDay(uint8_t days, int32_t after) {
+    int32_t d = after + 1;
+    while (!(days & (1 << CivilTime::weekday(d)))) {
+        ++d;
+    }
+    return d;
+}
+
+// the first start strictly after the given UTC time
+uint32_t Scheduler::nextStart(uint8_t days, uint16_t minute, uint32_t after) const {
+    for (int32_t d = nextDay(days, localDay(after) - 2);; d = nextDay(days, d)) {
+        uint32_t utc = utcOfLocal(d, minute);
+        if (utc > after) {
+            return utc;
+        }
+    }
+}
+
+// Works out the UTC deadline of a wall-clock job from its local spec, and the
+// heap key from that: the time until the deadline on the monotonic clock. The
+// dispatcher checks UTC again before it runs anything, so a key that came out
+// early only costs another wake-up.
+// Weekly jobs count local days, so a step back or a repeated hour cannot run a
+// day twice, and a step forward over a run makes it up; skipPast passes over
+// runs already behind instead (just added, or several were stepped over).
+bool Scheduler::arm(Job& job, const Now& t, bool skipPast) {
+    if (!t.synced) {
+        job.due = INT64_MAX; // parked until the first sync
+        return false;
+    }
+    uint32_t utc = (uint32_t)(t.utcUs / 1000000);
+    bool changed = false;
+    switch (job.kind) {
+    case Kind::At:
+        job.utcAt = time_.getUnixUTCTime(job.local);
+        break;
+    case Kind::Weekly:
+        if (job.lastDay < 0) {
+            job.lastDay = localDay(utc) - 1;
+            skipPast = true;
+        }
+        for (;;) {
+            job.day = nextDay(job.days, job.lastDay);
+            job.utcAt = utcOfLocal(job.day, job.minute);
+            if (!skipPast || job.utcAt > utc) {
+                break;
+            }
+            job.lastDay = job.day;
+        }
+        break;
+    case Kind::Window: {
+        // open if the latest start (today or yesterday, windows are shorter
+        // than a day) has not reached its end yet
+        bool open = false;
+        int32_t today = localDay(utc);
+        for (int32_t d = today; d >= today - 1 && !open; --d) {
+            if (!(job.days & (1 << CivilTime::weekday(d))) || utcOfLocal(d, job.minute) > utc) {
+                continue;
+            }
+            uint32_t end = utcOfLocal(d, job.minute + job.length);
+            if (utc < end) {
+                open = true;
+                job.utcAt = end;
+            }
+        }
+        if (!open) {
+            job.utcAt = nextStart(job.days, job.minute, utc);
+        }
+        changed = open != job.open;
+        job.open = open;
+        break;
+    }
+    default:
+        return false;
+    }
+    job.due = t.mono + ((int64_t)job.utcAt * 1000000 - t.utcUs);
+    return changed;
+}
+
+int64_t Scheduler::runDue() {
+    struct Run {
+        JobCallback callback;
+        WindowCallback windowCallback;
+        bool open;
+        void* arg;
+    };
+    Run runs[2 * maxJobs]; // a window can flip on the re-arm and once more when due
+    uint8_t n = 0;
+
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    Now t = now();
+    if (clockChanged_.exchange(false, std::memory_order_acq_rel) || t.synced != wasSynced_) {
+        // sync, DST change or new timezone: the UTC deadlines of the local specs
+        // may have moved, and every key on the monotonic clock may be off
+        wasSynced_ = t.synced;
+        for (uint8_t slot = 0; slot < maxJobs; ++slot) {
+            Job& j = jobs_[slot];
+            if (j.kind != Kind::At && j.kind != Kind::Weekly && j.kind != Kind::Window) {
+                continue;
+            }
+            if (arm(j, t)) {
+                runs[n++] = {nullptr, j.windowCallback, j.open, j.arg};
+            }
+            update(slot);
+        }
+    }
+
+    while (heapSize_ > 0 && jobs_[heap_[0]].due <= t.mono) {
+        uint8_t slot = heap_[0];
+        Job& j = jobs_[slot];
+        int64_t lateUs = t.mono - j.due;
+        if (j.kind == Kind::At || j.kind == Kind::Weekly || j.kind == Kind::Window) {
+            int64_t untilUs = (int64_t)j.utcAt * 1000000 - t.utcUs;
+            if (untilUs > 0) {
+                // the clock model moved since this was armed
+                j.due = t.mono + untilUs;
+                update(slot);
+                continue;
+            }
+            lateUs = -untilUs;
+        }
+
+        Run r = {j.callback, j.windowCallback, false, j.arg};
+        switch (j.kind) {
+        case Kind::Every:
+            j.due += (int64_t)j.periodMs * 1000;
+            if (j.due <= t.mono) {
+                j.due = t.mono + (int64_t)j.periodMs * 1000; // fell behind, skip instead of bursting
+            }
+            update(slot);
+            break;
+        case Kind::Weekly:
+            // after a step forward past several runs, only one is made up
+            j.lastDay = j.day;
+            arm(j, t, true);
+            update(slot);
+            break;
+        case Kind::Window:
+            if (!arm(j, t)) {
+                update(slot);
+                continue;
+            }
+            r.open = j.open;
+            update(slot);
+            break;
+        default: // After, At
+            remove(slot);
+            j.kind = Kind::Free;
+            break;
+        }
+        lateMsMetric.record((uint32_t)(lateUs / 1000));
+        runs[n++] = r;
+    }
+
+    int64_t waitUs = heapSize_ > 0 && jobs_[heap_[0]].due != INT64_MAX ? jobs_[heap_[0]].due - t.mono : INT64_MAX;
+    xSemaphoreGive(lock_);
+
+    for (uint8_t i = 0; i < n; ++i) {
+        if (runs[i].windowCallback) {
+            runs[i].windowCallback(runs[i].open, runs[i].arg);
+        } else {
+            runs[i].callback(runs[i].arg);
+        }
+    }
+    if (n > 0) {
+        runs_.fetch_add(n, std::memory_order_relaxed);
+        runsMetric.add(n);
+        return 0; // the callbacks took time, look again
+    }
+    return waitUs;
+}
+
+bool Scheduler::start(UBaseType_t priority, BaseType_t core) {
+    if (isRunning()) {
+        return true;
+    }
+    running_.store(true, std::memory_order_release);
+    taskAlive_.store(true, std::memory_order_release);
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        &_task,
+        "Scheduler",
+        4*1024,
+        this,
+        priority,
+        &task_,
+        core
+    );
+    if (ok != pdPASS) {
+        deferredLog().log("[Scheduler] Failed to create the dispatcher task");
+        running_.store(false, std::memory_order_release);
+        taskAlive_.store(false, std::memory_order_release);
+        return false;
+    }
+    return true;
+}
+
+void Scheduler::stop() {
+    if (!isRunning()) {
+        return;
+    }
+    running_.store(false, std::memory_order_release);
+    xSemaphoreGive(wake_);
+    while (taskAlive_.load(std::memory_order_acquire)) {
+        vTaskDelay(1);
+    }
+    task_ = nullptr;
+}
+
+void Scheduler::_task(void* pvParameters) {
+    auto self = static_cast<Scheduler*>(pvParameters);
+    while (self->running_.load(std::memory_order_acquire)) {
+        int64_t waitUs = self->runDue();
+        if (waitUs == 0) {
+            continue;
+        }
+        // rounded up so it never wakes early, and at most an hour: pdMS_TO_TICKS()
+        // overflows beyond ~71 min. Any add(), sync or DST change wakes it sooner.
+        uint32_t waitMs = waitUs >= (int64_t)HOUR * 1000 ? HOUR : (uint32_t)((waitUs + 999) / 1000);
+        TickType_t ticks = pdMS_TO_TICKS(waitMs);
+        xSemaphoreTake(self->wake_, ticks > 0 ? ticks : 1);
+    }
+    self->taskAlive_.store(false, std::memory_order_release);
+    vTaskDelete(NULL);
+}
+
+void Scheduler::swapNodes(uint8_t a, uint8_t b) {
+    uint8_t s = heap_[a];
+    heap_[a] = heap_[b];
+    heap_[b] = s;
+    pos_[heap_[a]] = a;
+    pos_[heap_[b]] = b;
+}
+
+void Scheduler::siftUp(uint8_t i) {
+    while (i > 0 && earlier(i, (i - 1) / 2)) {
+        swapNodes(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+void Scheduler::siftDown(uint8_t i) {
+    for (;;) {
+        uint8_t first = i;
+        uint8_t l = 2 * i + 1, r = 2 * i + 2;
+        if (l < heapSize_ && earlier(l, first)) first = l;
+        if (r < heapSize_ && earlier(r, first)) first = r;
+        if (first == i) {
+            return;
+        }
+        swapNodes(i, first);
+        i = first;
+    }
+}
+
+void Scheduler::push(uint8_t slot) {
+    heap_[heapSize_] = slot;
+    pos_[slot] = heapSize_;
+    siftUp(heapSize_++);
+}
+
+void Scheduler::remove(uint8_t slot) {
+    uint8_t i = pos_[slot];
+    swapNodes(i, --heapSize_);
+    if (i < heapSize_) {
+        update(heap_[i]);
+    }
+}
+
+// after the slot's key changed either way
+void Scheduler::update(uint8_t slot) {
+    siftUp(pos_[slot]);
+    siftDown(pos_[slot]);
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "TimeManager.h"
+
+// Runs jobs at local wall-clock times (daily, weekly, once) or at intervals,
+// and opens and closes daily time windows, instead of the application loop
+// polling getSecondsUntilWeHit() / isInBetween() for each of them.
+//
+// Jobs sit in a min-heap ordered by deadline (esp_timer_get_time()), so the
+// dispatcher task looks at the earliest one only and sleeps until then; adding
+// or cancelling a job wakes it. Wall-clock deadlines are kept in UTC and
+// recomputed from their local spec whenever TimeManager reports a sync, a DST
+// change or a new timezone, so clock steps and DST neither skip nor repeat a
+// run. Until the first sync only interval jobs run.
+//
+//   scheduler.daily(3, 0, &nightlyUpload);
+//   scheduler.window(Scheduler::everyDay, 22, 0, 7, 0, &nightMode);
+//   scheduler.start();
+//
+// Callbacks run on the dispatcher task, one after another, without any lock
+// held; they may add and cancel jobs. A time skipped by a DST change runs
+// right after the gap, one that happens twice runs the second time.
+//
+// One Scheduler per TimeManager: it takes TimeManager's only onClockChange()
+// slot, and a second Scheduler (or any other onClockChange()) replaces it, so
+// the first one misses syncs and DST changes. Destroying a Scheduler frees the
+// slot only if it still holds it.
+class Scheduler {
+public:
+    typedef void (*JobCallback)(void* arg);
+    // true when the window opens, false when it closes
+    typedef void (*WindowCallback)(bool open, void* arg);
+    typedef int32_t JobId;
+
+    static constexpr JobId invalidJob = -1;
+    static constexpr uint8_t maxJobs = 16;
+
+    // weekday masks, bit 0 = Sunday like TimeManager::getDay()
+    static constexpr uint8_t sunday = 0x01, monday = 0x02, tuesday = 0x04, wednesday = 0x08,
+                             thursday = 0x10, friday = 0x20, saturday = 0x40;
+    static constexpr uint8_t weekdays = 0x3E, weekend = 0x41, everyDay = 0x7F;
+
+    explicit Scheduler(TimeManager& time);
+    ~Scheduler();
+
+    // local HH:MM on the given days; invalidJob if the table is full or the spec is wrong
+    JobId daily(uint8_t hour, uint8_t minute, JobCallback callback, void* arg = nullptr);
+    JobId weekly(uint8_t days, uint8_t hour, uint8_t minute, JobCallback callback, void* arg = nullptr);
+    // once at a local time as returned by getUnixTime(); a time already past runs right away
+    JobId at(uint32_t localTime, JobCallback callback, void* arg = nullptr);
+    // every periodMs from now, and once after delayMs; monotonic, independent of the wall clock
+    JobId every(uint32_t periodMs, JobCallback callback, void* arg = nullptr);
+    JobId after(uint32_t delayMs, JobCallback callback, void* arg = nullptr);
+    // open from start to end local time on the given days (by the day it opens),
+    // end before start crosses midnight. Called with true right away if added
+    // while inside the window.
+    JobId window(uint8_t days, uint8_t startHour, uint8_t startMinute, uint8_t endHour, uint8_t endMinute,
+                 WindowCallback callback, void* arg = nullptr);
+
+    bool cancel(JobId id); // false if it already ran (one-shots) or was cancelled
+    bool isOpen(JobId id) const; // a window, as of its last callback
+    uint8_t jobCount() const;
+
+    // the dispatcher task; false if it could not be created
+    bool start(UBaseType_t priority = tskIDLE_PRIORITY + 1, BaseType_t core = tskNO_AFFINITY);
+    void stop(); // blocks until the task has exited
+    bool isRunning() const { return taskAlive_.load(std::memory_order_acquire); }
+
+    // runs everything that is due and returns microseconds until the next
+    // deadline (INT64_MAX without jobs); what the task does on every wake-up,
+    // so it can be called from loop() instead of start()
+    int64_t runDue();
+
+    uint32_t runs() const { return runs_.load(std::memory_order_relaxed); }
+
+private:
+    enum class Kind : uint8_t { Free, Every, After, At, Weekly, Window };
+
+    struct Job {
+        Kind kind = Kind::Free;
+        uint8_t days = 0;          // Weekly, Window
+        uint16_t minute = 0;       // minute of the local day: Weekly, Window start
+        uint16_t length = 0;       // Window, minutes
+        bool open = false;         // Window
+        uint16_t generation = 0;   // tells a stale JobId from the slot's current job
+        uint32_t periodMs = 0;     // Every
+        uint32_t local = 0;        // At
+        int32_t lastDay = -1;      // Weekly: local day (since 1970) of the last run, -1 until armed
+        int32_t day = 0;           // Weekly: local day of the next run
+        uint32_t utcAt = 0;        // wall-clock kinds: the deadline in UTC seconds
+        int64_t due = 0;           // heap key, esp_timer_get_time()
+        JobCallback callback = nullptr;
+        WindowCallback windowCallback = nullptr;
+        void* arg = nullptr;
+    };
+
+    struct Now {
+        int64_t mono;  // esp_timer_get_time()
+        int64_t utcUs; // valid if synced
+        bool synced;
+    };
+
+    static void _task(void* pvParameters);
+    static void clockChanged(void* arg);
+
+    JobId add(const Job& job);
+    Now now() const;
+    // wall-clock kinds; true if a window changed state
+    bool arm(Job& job, const Now& now, bool skipPast = false);
+    int32_t localDay(uint32_t utc) const;
+    uint32_t utcOfLocal(int32_t day, uint32_t minute) const;
+    static int32_t nextDay(uint8_t days, int32_t after);
+    uint32_t nextStart(uint8_t days, uint16_t minute, uint32_t after) const;
+
+    // the heap holds slots, pos_ where each slot is in it
+    bool earlier(uint8_t a, uint8_t b) const { return jobs_[heap_[a]].due < jobs_[heap_[b]].due; }
+    void swapNodes(uint8_t a, uint8_t b);
+    void siftUp(uint8_t i);
+    void siftDown(uint8_t i);
+    void push(uint8_t slot);
+    void remove(uint8_t slot);
+    void update(uint8_t slot);
+
+    TimeManager& time_;
+    Job jobs_[maxJobs];
+    uint8_t heap_[maxJobs];
+    uint8_t pos_[maxJobs];
+    uint8_t heapSize_ = 0;
+    bool wasSynced_ = false;
+
+    SemaphoreHandle_t lock_;   // jobs_ and the heap
+    SemaphoreHandle_t wake_;   // binary, the task sleeps on it until the next deadline
+    TaskHandle_t task_ = nullptr;
+    std::atomic<bool> clockChanged_{false};
+    std::atomic<bool> running_{false};
+    std::atomic<bool> taskAlive_{false};
+    std::atomic<uint32_t> runs_{0};
+};
@@ -0,0 +1,84 @@
+#ifndef SEQ_LOCK_H
+#define SEQ_LOCK_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Single-writer sequence lock for small, trivially copyable snapshots.
+// The writer never blocks and readers never take a lock: they copy the payload
+// and retry only if a store() overlapped the copy. Concurrent writers must be
+// serialized by the caller.
+// A reader that keeps failing gives up the CPU after spinTries attempts: if it
+// preempted the writer on the same core, spinning would never let it finish.
+template<typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock payload must be trivially copyable");
+    static constexpr size_t NWORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+    static constexpr uint32_t spinTries = 32;
+
+public:
+    SeqLock() {
+        store(T());
+        seq_.store(0, std::memory_order_relaxed); // the default value does not count as a publish
+    }
+
+    void store(const T& value) {
+        uint32_t words[NWORDS] = {};
+        memcpy(words, &value, sizeof(T));
+
+        uint32_t seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed); // odd: write in progress
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < NWORDS; ++i) {
+            words_[i].store(words[i], std::memory_order_relaxed);
+        }
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    T load() const {
+        uint32_t words[NWORDS];
+        for (uint32_t tries = 1;; ++tries) {
+            uint32_t before = seq_.load(std::memory_order_acquire);
+            if (!(before & 1u)) {
+                for (size_t i = 0; i < NWORDS; ++i) {
+                    words[i] = words_[i].load(std::memory_order_relaxed);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (seq_.load(std::memory_order_relaxed) == before) {
+                    break;
+                }
+            }
+            // the writer only copies a few words; if that is not enough it was
+            // preempted, possibly by us. taskYIELD() would not let a lower
+            // priority writer run, a tick of sleep does.
+            retries_.fetch_add(1, std::memory_order_relaxed);
+            if (tries % spinTries == 0) {
+                vTaskDelay(1);
+            }
+        }
+        T value;
+        memcpy(&value, words, sizeof(T));
+        return value;
+    }
+
+    // number of completed stores, handy to detect that a new snapshot was published
+    uint32_t version() const {
+        return seq_.load(std::memory_order_acquire) / 2;
+    }
+
+    // reads that had to copy again, for contention diagnostics
+    uint32_t retries() const {
+        return retries_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint32_t> seq_{0};
+    mutable std::atomic<uint32_t> retries_{0}; // only touched on the slow path
+    std::atomic<uint32_t> words_[NWORDS];
+};
+
+#endif // SEQ_LOCK_H
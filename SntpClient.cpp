@@ -0,0 +1,227 @@
+#include "SntpClient.h"
+#include "DeferredLog.h"
+
+#include <algorithm>
+#include <string.h>
+
+static constexpr size_t packetSize = 48;
+static constexpr uint32_t ntpToUnix = 2208988800u; // seconds from 1900 to 1970
+
+static uint32_t get32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+// NTP 32.32 timestamp to Unix microseconds. Era 1 (from 2036) comes out right
+// through the uint32_t wrap, good until 2106.
+static int64_t timestampUs(const uint8_t* p) {
+    uint32_t sec = get32(p) - ntpToUnix;
+    uint32_t frac = get32(p + 4);
+    return (int64_t)sec * 1000000 + (int64_t)(((uint64_t)frac * 1000000) >> 32);
+}
+
+// NTP 16.16 short format (root delay, root dispersion) to microseconds
+static int64_t shortUs(const uint8_t* p) {
+    return (int64_t)(((uint64_t)get32(p) * 1000000) >> 16);
+}
+
+bool SntpClient::addServer(const char* host, uint16_t port) {
+    if (count_ >= maxServers || !host || strlen(host) > maxHostLength) {
+        return false;
+    }
+    Server& s = servers_[count_++];
+    strcpy(s.host, host);
+    s.port = port;
+    return true;
+}
+
+bool SntpClient::start(uint32_t timeoutMs) {
+    if (running_) {
+        return true;
+    }
+    if (WiFi.status() != WL_CONNECTED) {
+        return false;
+    }
+    if (!socketOpen_) {
+        socketOpen_ = udp_.begin(localPort);
+        if (!socketOpen_) return false;
+    }
+    while (udp_.parsePacket()) {
+        udp_.flush(); // late replies to an earlier round
+    }
+
+    result_ = SntpResult();
+    pending_ = 0;
+    startedUs_ = esp_timer_get_time();
+    timeoutUs_ = (int64_t)timeoutMs * 1000;
+    for (uint8_t i = 0; i < count_; ++i) {
+        Server& s = servers_[i];
+        s.sample = SntpSample();
+        s.pending = send(s);
+        if (s.pending) pending_++;
+    }
+    running_ = pending_ > 0;
+    return running_;
+}
+
+bool SntpClient::send(Server& s) {
+    if (!s.resolved || s.failures >= resolveAfterFailures) {
+        IPAddress ip;
+        if (!WiFi.hostByName(s.host, ip)) {
+            deferredLog().log("[SntpClient] Cannot resolve %s", s.host);
+            return false;
+        }
+        if (s.resolved && ip != s.ip) {
+            s.failures = 0; // the pool handed out another server, give it a fresh start
+        }
+        s.ip = ip;
+        s.resolved = true;
+    }
+
+    uint8_t packet[packetSize] = {0};
+    packet[0] = 0x23; // LI 0, version 4, mode 3 (client)
+    // transmit timestamp: a random nonce instead of our clock, the server echoes
+    // it as origin; that matches replies without trusting our own time at all
+    uint32_t r0 = esp_random();
+    uint32_t r1 = esp_random();
+    memcpy(s.nonce, &r0, 4);
+    memcpy(s.nonce + 4, &r1, 4);
+    memcpy(packet + 40, s.nonce, 8);
+
+    if (!udp_.beginPacket(s.ip, s.port)) return false;
+    udp_.write(packet, sizeof(packet));
+    s.sentUs = esp_timer_get_time();
+    return udp_.endPacket() == 1;
+}
+
+bool SntpClient::poll() {
+    if (!running_) {
+        return false;
+    }
+    receive();
+    if (pending_ > 0 && esp_timer_get_time() - startedUs_ < timeoutUs_) {
+        return false;
+    }
+    finish();
+    return true;
+}
+
+void SntpClient::abort() {
+    running_ = false;
+    pending_ = 0;
+    for (uint8_t i = 0; i < count_; ++i) servers_[i].pending = false;
+}
+
+void SntpClient::receive() {
+    uint8_t packet[packetSize];
+    while (int size = udp_.parsePacket()) {
+        int64_t now = esp_timer_get_time(); // T4 of this reply, not of the poll
+        if (size < (int)packetSize || udp_.read(packet, packetSize) != (int)packetSize) {
+            udp_.flush();
+            continue;
+        }
+        udp_.flush();
+        IPAddress from = udp_.remoteIP();
+        for (uint8_t i = 0; i < count_; ++i) {
+            Server& s = servers_[i];
+            if (s.pending && s.ip == from && accept(s, packet, now)) {
+                s.pending = false;
+                pending_--;
+                break;
+            }
+        }
+    }
+}
+
+bool SntpClient::accept(Server& s, const uint8_t* p, int64_t now) {
+    if (memcmp(p + 24, s.nonce, 8) != 0) {
+        return false; // not the answer to our request (stale, spoofed, other server)
+    }
+    uint8_t li = p[0] >> 6;
+    uint8_t mode = p[0] & 0x07;
+    uint8_t stratum = p[1];
+    if (mode != 4 || li == 3 || stratum == 0 || stratum > 15) {
+        if (stratum == 0) {
+            deferredLog().log("[SntpClient] %s sent kiss code %c%c%c%c", s.host, p[12], p[13], p[14], p[15]);
+        }
+        return true; // answered, just not usable
+    }
+
+    // RFC 4330 section 5: an unsynchronized server may send a zero transmit
+    // timestamp, which would come out as 1900; and it cannot send before it received
+    if (get32(p + 40) == 0 && get32(p + 44) == 0) {
+        deferredLog().log("[SntpClient] %s sent no transmit timestamp", s.host);
+        return true;
+    }
+    int64_t t1 = s.sentUs;
+    int64_t t2 = timestampUs(p + 32);
+    int64_t t3 = timestampUs(p + 40);
+    int64_t t4 = now;
+    if (t3 < t2) {
+        deferredLog().log("[SntpClient] %s sent before it received", s.host);
+        return true;
+    }
+    SntpSample& sample = s.sample;
+    sample.offsetUs = ((t2 - t1) + (t3 - t4)) / 2;
+    sample.delayUs = std::max<int64_t>((t4 - t1) - (t3 - t2), 0);
+    sample.distanceUs = (shortUs(p + 4) + sample.delayUs) / 2 + shortUs(p + 8);
+    sample.stratum = stratum;
+    sample.localUs = t4;
+    sample.valid = true;
+    return true;
+}
+
+void SntpClient::finish() {
+    running_ = false;
+    int64_t offsets[maxServers];
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < count_; ++i) {
+        Server& s = servers_[i];
+        s.pending = false;
+        if (s.sample.valid) {
+            offsets[n++] = s.sample.offsetUs;
+            s.failures = 0;
+        } else if (s.failures < 255) {
+            s.failures++;
+        }
+    }
+    pending_ = 0;
+    result_.replies = n;
+    if (n == 0) {
+        return;
+    }
+
+    // a falseticker cannot win on distance if it disagrees with the majority
+    if (n >= 3) {
+        for (uint8_t i = 1; i < n; ++i) { // at most maxServers, insertion sort
+            for (uint8_t j = i; j > 0 && offsets[j - 1] > offsets[j]; --j) std::swap(offsets[j - 1], offsets[j]);
+        }
+        int64_t median = n & 1 ? offsets[n / 2] : (offsets[n / 2 - 1] + offsets[n / 2]) / 2;
+        for (uint8_t i = 0; i < count_; ++i) {
+            SntpSample& sample = servers_[i].sample;
+            if (sample.valid && llabs(sample.offsetUs - median) > outlierMarginUs + sample.delayUs / 2) {
+                sample.outlier = true;
+                result_.outliers++;
+            }
+        }
+    }
+
+    const SntpSample* best = nullptr;
+    for (uint8_t i = 0; i < count_; ++i) {
+        const SntpSample& sample = servers_[i].sample;
+        if (!sample.valid || sample.outlier) continue;
+        if (!best || sample.distanceUs < best->distanceUs ||
+            (sample.distanceUs == best->distanceUs && sample.stratum < best->stratum)) {
+            best = &sample;
+            result_.server = i;
+        }
+    }
+    if (!best) {
+        return; // no majority: all outliers, e.g. four replies in two pairs far apart
+    }
+    result_.valid = true;
+    result_.stratum = best->stratum;
+    result_.offsetUs = best->offsetUs;
+    result_.delayUs = best->delayUs;
+    result_.distanceUs = best->distanceUs;
+    result_.localUs = best->localUs;
+}
@@ -0,0 +1,101 @@
+#ifndef SNTP_CLIENT_H
+#define SNTP_CLIENT_H
+
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include "esp_timer.h"
+
+// One server's answer in the last round. Times are microseconds; offset is UTC
+// minus esp_timer_get_time(), so UTC at any later local time t is t + offset.
+struct SntpSample {
+    bool valid = false;
+    bool outlier = false;
+    uint8_t stratum = 0;
+    int64_t offsetUs = 0;   // ((T2 - T1) + (T3 - T4)) / 2
+    int64_t delayUs = 0;    // (T4 - T1) - (T3 - T2)
+    int64_t distanceUs = 0; // root distance: (root delay + delay) / 2 + root dispersion
+    int64_t localUs = 0;    // T4
+};
+
+// The sample a round settled on
+struct SntpResult {
+    bool valid = false;
+    uint8_t server = 0;     // index as passed to addServer()
+    uint8_t stratum = 0;
+    uint8_t replies = 0;    // valid answers in the round
+    uint8_t outliers = 0;   // of those, rejected as too far from the median
+    int64_t offsetUs = 0;
+    int64_t delayUs = 0;
+    int64_t distanceUs = 0;
+    int64_t localUs = 0;
+
+    int64_t utcUs(int64_t local) const { return local + offsetUs; }
+};
+
+// Non-blocking SNTP (RFC 4330) client for a few servers at once.
+// start() sends one request to every server and returns; poll() picks up
+// whatever replies have arrived and returns true exactly once, when all servers
+// have answered or the timeout ran out. Replies are checked against the nonce
+// sent in the transmit timestamp, offsets further than outlierMarginUs from the
+// median are dropped (with three or more replies) and the reply with the
+// smallest root distance wins, lower stratum breaking ties. With two replies
+// there is no majority to check against: the closer one wins even if they
+// disagree. T4 is taken when poll() picks a reply up, so the caller polls
+// often while a round is running (TimeManager: every tick).
+// Not thread safe, TimeManager drives it from its sync task.
+class SntpClient {
+public:
+    static constexpr uint8_t maxServers = 4;
+    static constexpr uint16_t ntpPort = 123;
+    static constexpr uint16_t localPort = 4123;
+    static constexpr uint32_t defaultTimeoutMs = 2000;
+    static constexpr int64_t outlierMarginUs = 100000;
+    static constexpr uint8_t resolveAfterFailures = 3; // look the name up again after this many silent rounds
+    static constexpr size_t maxHostLength = 63;
+
+    SntpClient() {}
+
+    // false if the table is full or the name is too long
+    bool addServer(const char* host, uint16_t port = ntpPort);
+    uint8_t serverCount() const { return count_; }
+    const char* serverName(uint8_t i) const { return servers_[i].host; }
+
+    // sends the requests; false if none could be sent (no WiFi, DNS failed)
+    bool start(uint32_t timeoutMs = defaultTimeoutMs);
+    bool poll();
+    void abort();
+    bool isRunning() const { return running_; }
+
+    const SntpResult& result() const { return result_; }
+    const SntpSample& sample(uint8_t i) const { return servers_[i].sample; }
+
+private:
+    struct Server {
+        char host[maxHostLength + 1] = "";
+        uint16_t port = ntpPort;
+        IPAddress ip;
+        bool resolved = false;
+        uint8_t failures = 0;  // rounds in a row without a valid reply
+        bool pending = false;  // request out, no reply yet
+        uint8_t nonce[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+        int64_t sentUs = 0;    // T1
+        SntpSample sample;
+    };
+
+    bool send(Server& s);
+    void receive();
+    bool accept(Server& s, const uint8_t* packet, int64_t now);
+    void finish();
+
+    Server servers_[maxServers];
+    uint8_t count_ = 0;
+    WiFiUDP udp_;
+    bool socketOpen_ = false;
+    bool running_ = false;
+    uint8_t pending_ = 0;
+    int64_t startedUs_ = 0;
+    int64_t timeoutUs_ = 0;
+    SntpResult result_;
+};
+
+#endif // SNTP_CLIENT_H
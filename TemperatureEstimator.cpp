@@ -0,0 +1,70 @@
+#include "TemperatureEstimator.h"
+
+float TemperatureEstimator::medianOfRaw() const {
+    float s[medianSize];
+    for (uint8_t i = 0; i < rawCount_; ++i) {
+        float v = raw_[i];
+        uint8_t j = i;
+        for (; j > 0 && s[j - 1] > v; --j) s[j] = s[j - 1];
+        s[j] = v;
+    }
+    return s[rawCount_ / 2];
+}
+
+void TemperatureEstimator::addSample(float celsius, uint32_t now) {
+    state_.raw = celsius;
+    state_.lastSampleAt = now;
+
+    raw_[rawPos_] = celsius;
+    rawPos_ = (rawPos_ + 1) % medianSize;
+    if (rawCount_ < medianSize) rawCount_++;
+    float median = medianOfRaw();
+
+    state_.filtered = count_ == 0 ? median : state_.filtered + alpha_ * (median - state_.filtered);
+
+    values_[pos_] = state_.filtered;
+    times_[pos_] = now;
+    pos_ = (pos_ + 1) % windowSize;
+    if (count_ < windowSize) count_++;
+    state_.samples = count_;
+
+    fitSlope();
+}
+
+void TemperatureEstimator::fitSlope() {
+    if (count_ < 3) {
+        state_.slope = 0;
+        return;
+    }
+    // least squares on times relative to the newest sample, in seconds
+    uint32_t newest = state_.lastSampleAt;
+    float sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (uint8_t i = 0; i < count_; ++i) {
+        float x = -(float)(uint32_t)(newest - times_[i]) / 1000.0f;
+        float y = values_[i];
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    float denom = count_ * sxx - sx * sx;
+    state_.slope = denom > 1e-6f ? (count_ * sxy - sx * sy) / denom : 0;
+}
+
+float TemperatureEstimator::predict(uint32_t aheadMs) const {
+    return state_.filtered + state_.slope * (aheadMs / 1000.0f);
+}
+
+uint32_t TemperatureEstimator::timeToReach(float threshold) const {
+    if (!valid()) {
+        return never;
+    }
+    if (state_.filtered >= threshold) {
+        return 0;
+    }
+    if (state_.slope <= 0.001f) {
+        return never; // flat or cooling
+    }
+    float seconds = (threshold - state_.filtered) / state_.slope;
+    return seconds >= 4.0e6f ? never : (uint32_t)(seconds * 1000.0f);
+}
@@ -0,0 +1,61 @@
+#ifndef TEMPERATURE_ESTIMATOR_H
+#define TEMPERATURE_ESTIMATOR_H
+
+#include <Arduino.h>
+
+// Robust view of the noisy internal temperature sensor.
+// Each raw sample goes through a median of the last few raw samples (a single
+// spike never gets through) and an EMA; the smoothed values are kept with their
+// timestamps in a ring, and a least-squares fit over the ring gives the trend.
+// From that the time until a threshold is reached can be predicted, so
+// mitigations can start before the threshold instead of after it.
+// Not thread safe; TemperatureSafetyManager feeds it from one task.
+class TemperatureEstimator {
+public:
+    static constexpr uint8_t windowSize = 16;   // samples used for the slope
+    static constexpr uint8_t medianSize = 5;    // raw samples in the spike filter
+    static constexpr uint32_t never = 0xFFFFFFFF;
+
+    struct State {
+        float raw = 0;          // last sample as read
+        float filtered = 0;     // median + EMA
+        float slope = 0;        // °C per second, least squares over the window
+        uint32_t lastSampleAt = 0;
+        uint8_t samples = 0;    // in the window, the slope needs at least 3
+    };
+
+    explicit TemperatureEstimator(float emaAlpha = 0.3f) : alpha_(emaAlpha) {}
+
+    void addSample(float celsius, uint32_t now);
+    void reset() { count_ = 0; rawCount_ = 0; state_ = State(); }
+
+    bool valid() const { return count_ > 0; }
+    float filtered() const { return state_.filtered; }
+    float slope() const { return state_.slope; }
+    const State& state() const { return state_; }
+
+    // filtered value extrapolated aheadMs past the last sample
+    float predict(uint32_t aheadMs) const;
+    // ms from the last sample until the trend reaches threshold: 0 if already there,
+    // never if the temperature is not rising
+    uint32_t timeToReach(float threshold) const;
+
+private:
+    float medianOfRaw() const;
+    void fitSlope();
+
+    float alpha_;
+
+    float raw_[medianSize];
+    uint8_t rawPos_ = 0;
+    uint8_t rawCount_ = 0;
+
+    float values_[windowSize];
+    uint32_t times_[windowSize];
+    uint8_t pos_ = 0;
+    uint8_t count_ = 0;
+
+    State state_;
+};
+
+#endif // TEMPERATURE_ESTIMATOR_H
@@ -1,58 +1,239 @@
 #include "TemperatureSafetyManager.h"
 #include <WiFi.h>
 #include "esp_wifi.h"
-#include "throttle.h"
 #include <LoggingBase.h>
 
 #include "WiFiWrapper.h"
+#include "Metrics.h"
+#include "DeferredLog.h"
+
+static Gauge& temperatureMetric = metrics().gauge("thermal.temp_dc"); // filtered, 0.1 °C
+static Gauge& levelMetric = metrics().gauge("thermal.level");
+static Counter& levelChangesMetric = metrics().counter("thermal.level_changes");
+static Counter& shutdownsMetric = metrics().counter("thermal.shutdowns");
 
 
 void TemperatureSafetyManager::manageTemperatureSafety() {
-    float temp = temperatureRead(); // Read internal temperature
+    uint32_t now = millis();
+    estimator.addSample(temperatureRead(), now); // Read internal temperature
+    float temp = estimator.filtered();
+    temperatureMetric.set((int32_t)lroundf(temp * 10.0f));
+    bool rising = estimator.slope() > 0.01f; // °C/s, above sensor noise
 
+    MitigationLadder table = ladder.load();
+    uint8_t n = table.size();
+    uint8_t current = level;
+    uint8_t next = current > n ? n : current;
 
     // ===========================
-    // Emergency Shutdown Logic
+    // Escalating
     // ===========================
-    if (temp >= TEMP_SHUTDOWN) {
-        esp_sleep_enable_timer_wakeup(30ULL * 60 * 1000000);  // Wake up in 30 minutes and re-check
-        esp_deep_sleep_start(); // Enter deep sleep (reset required)
-        return;  // Exit early if shutting down
+    // highest level whose enter temperature is predicted within the lead, so load is
+    // shed before it is reached; a deep sleep level needs the filtered value itself
+    // and a few samples for the spike filter to work with
+    for (uint8_t i = n; i > next; --i) {
+        const MitigationLevel& l = table.level(i);
+        bool reached = l.deepSleepS
+            ? temp >= l.enterC && estimator.state().samples >= 3
+            : estimator.timeToReach(l.enterC) <= TEMP_MITIGATION_LEAD_MS;
+        if (reached) {
+            next = i;
+            break;
+        }
     }
 
     // ===========================
-    // Reducing System Load
+    // Restoring, one level at a time
     // ===========================
-    
-    if (temp >= TEMP_DISABLE_WIFI && !wifiDisabled && wifi) {
-        wifi->stop();  // Turn off WiFi completely
-        wifiDisabled = true;
-        gLogger->println("WiFi disabled due to high temperature.");
-    } 
+    // only below the exit temperature, no longer heating up and after the dwell time
+    if (next == current && current > 0) {
+        const MitigationLevel& l = table.level(current);
+        if (temp <= l.exitC && !rising && now - levelEnteredAt >= l.dwellMs) {
+            next = current - 1;
+        }
+    }
 
-    if (temp >= TEMP_REDUCE_WIFI_POWER && !lowPowerMode && wifi) {
-        wifi->configureLowPowerMode();  // Lower WiFi TX power
-        lowPowerMode = true;
-        gLogger->println("WiFi power reduced due to high temperature.");
+    if (next != current) {
+        setLevel(next, table, temp, now);
     }
 
-    //this can be silent
-    int cpuf = throttleCPU(temp); //external
-    currentCpuFrequency = cpuf;
-    
+    ThermalStatus st;
+    st.estimate = estimator.state();
+    st.level = next;
+    float nextEnterC = next < n ? table.level(next + 1).enterC : temp;
+    if (next < n) {
+        st.msToNextLevel = estimator.timeToReach(nextEnterC);
+    }
+    for (uint8_t i = 1; i <= n; ++i) {
+        if (table.level(i).deepSleepS) {
+            st.msToShutdown = estimator.timeToReach(table.level(i).enterC);
+            break;
+        }
+    }
+    status.store(st);
+    checkPeriod = periodFor(st, nextEnterC);
+
     // ===========================
-    // Restoring System State
+    // Emergency Shutdown Logic
     // ===========================
+    if (applied.deepSleepS) {
+        shutdownTriggered = true;
+        shutdownsMetric.add();
+        metrics().event(MetricEvent::ThermalShutdown, (int32_t)lroundf(temp * 10.0f));
+        gLogger->println("Temperature critical, entering deep sleep.");
+        deferredLog().flush(); // whatever is still queued would be lost
+        esp_sleep_enable_timer_wakeup((uint64_t)applied.deepSleepS * 1000000);  // Wake up and re-check
+        esp_deep_sleep_start(); // Enter deep sleep (reset required)
+        return;  // Exit early if shutting down
+    }
+
+    //this can be silent; the level's CPU cap is applied by the governor
+    int cpuf = cpuGovernor.update(temp, now);
+    currentCpuFrequency = cpuf;
+
+    // duty cycle the whole chip, at most MitigationLadder::maxLightSleepMs at a time
+    // so the station stays associated; this blocks whoever called the check
+    if (applied.lightSleepMs) {
+        esp_sleep_enable_timer_wakeup((uint64_t)applied.lightSleepMs * 1000);
+        esp_light_sleep_start();
+    }
+}
+
+void TemperatureSafetyManager::setLevel(uint8_t next, const MitigationLadder& table, float temp, uint32_t now) {
+    const MitigationLevel& to = next ? table.level(next) : MitigationLadder::none();
+
+    deferredLog().log("Thermal mitigation level %u -> %u at %.1f C", level.load(), next, temp);
+
+    if (wifi) {
+        if (to.wifiOff && !applied.wifiOff) {
+            wifi->stop();  // Turn off WiFi completely
+            deferredLog().log("WiFi disabled due to high temperature.");
+        }
+        if (to.maxTxPowerDbm != applied.maxTxPowerDbm || to.maxModemSleep != applied.maxModemSleep) {
+            wifi->setThermalLimits(to.maxTxPowerDbm, to.maxModemSleep ? WIFI_PS_MAX_MODEM : WIFI_PS_NONE);
+        }
+        if (!to.wifiOff && applied.wifiOff) {
+            wifi->resume();  // Turn WiFi back on
+            deferredLog().log("WiFi restored due to lower temperature.");
+        }
+    }
+    wifiDisabled = wifi && to.wifiOff;
+    lowPowerMode = wifi && (to.maxTxPowerDbm < 20 || to.maxModemSleep);
 
-    if (temp <= TEMP_RESTORE_WIFI_POWER && lowPowerMode && wifi) {
-        wifi->configureNormalPowerMode();  // Restore full WiFi power
-        lowPowerMode = false;
-        gLogger->println("WiFi power restored due to lower temperature.");
+    cpuGovernor.setFrequencyCap(to.cpuCapMhz);
+
+    if (to.pauseWorkloads != applied.pauseWorkloads) {
+        for (uint8_t i = 0; i < workloadCount; ++i) {
+            const Workload& w = workloads[i];
+            if (to.pauseWorkloads && w.pause) w.pause(w.arg);
+            if (!to.pauseWorkloads && w.resume) w.resume(w.arg);
+        }
+    }
+
+    levelChangesMetric.add();
+    levelMetric.set(next);
+    metrics().event(MetricEvent::ThermalLevel, next);
+
+    applied = to;
+    level = next;
+    levelEnteredAt = now;
+}
+
+bool TemperatureSafetyManager::loadMitigationLadder(const char* text) {
+    MitigationLadder table;
+    if (!table.parse(text)) {
+        return false;
+    }
+    setMitigationLadder(table);
+    return true;
+}
+
+bool TemperatureSafetyManager::registerWorkload(void (*pause)(void* arg), void (*resume)(void* arg), void* arg) {
+    if (workloadCount == maxWorkloads) {
+        gLogger->println("TemperatureSafetyManager: too many workloads registered");
+        return false;
+    }
+    workloads[workloadCount++] = {pause, resume, arg};
+    return true;
+}
+
+uint32_t TemperatureSafetyManager::periodFor(const ThermalStatus& st, float nextEnterC) const {
+    // mitigating, or heating up fast, counts as near, even if still far below
+    if (st.level > 0 || st.msToNextLevel <= TEMP_MITIGATION_LEAD_MS * 2) {
+        return checkPeriodMin;
+    }
+    float below = nextEnterC - st.estimate.filtered;
+    if (below <= TEMP_NEAR_BAND) {
+        return checkPeriodMin;
+    }
+    if (below >= TEMP_FAR_BAND) {
+        return checkPeriodMax;
+    }
+    float f = (below - TEMP_NEAR_BAND) / (TEMP_FAR_BAND - TEMP_NEAR_BAND);
+    return checkPeriodMin + (uint32_t)(f * (checkPeriodMax - checkPeriodMin));
+}
+
+void TemperatureSafetyManager::loop() {
+    if (taskAlive.load()) {
+        return;
+    }
+    uint32_t now = millis();
+    if (checkedOnce && now - lastCheck < checkPeriod.load()) {
+        return;
+    }
+    checkedOnce = true;
+    lastCheck = now;
+    manageTemperatureSafety();
+}
+
+bool TemperatureSafetyManager::startTask(UBaseType_t priority, BaseType_t core) {
+    if (taskAlive.load()) {
+        return true;
+    }
+    taskRunning = true;
+    taskAlive = true;
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        &_task,
+        "TempSafety",
+        4*1024,
+        this,
+        priority,
+        &taskHandle,
+        core
+    );
+    if (ok != pdPASS) {
+        gLogger->println("Failed to create TempSafety task");
+        taskRunning = false;
+        taskAlive = false;
+        return false;
+    }
+    return true;
+}
+
+void TemperatureSafetyManager::stopTask() {
+    if (!taskAlive.load()) {
+        return;
+    }
+    taskRunning = false;
+    while (taskAlive.load()) {
+        vTaskDelay(pdMS_TO_TICKS(10));
     }
+    taskHandle = nullptr;
+}
 
-    if (temp <= TEMP_RESTORE_WIFI && wifiDisabled && wifi) {
-        wifi->resume();  // Turn WiFi back on
-        wifiDisabled = false;
-        gLogger->println("WiFi restored due to lower temperature.");
+void TemperatureSafetyManager::_task(void* pvParameters) {
+    auto self = static_cast<TemperatureSafetyManager*>(pvParameters);
+    while (self->taskRunning.load()) {
+        self->manageTemperatureSafety();
+        // sleep in short slices so stopTask() does not wait for a long period
+        uint32_t period = self->checkPeriod.load();
+        uint32_t slept = 0;
+        while (slept < period && self->taskRunning.load()) {
+            uint32_t slice = period - slept < 100 ? period - slept : 100;
+            vTaskDelay(pdMS_TO_TICKS(slice));
+            slept += slice;
+        }
     }
-}
\ No newline at end of file
+    self->taskAlive = false;
+    vTaskDelete(NULL);
+}
@@ -2,36 +2,100 @@
 #define TEMPERATURE_SAFETY_MANAGER_H
 
 #include <Arduino.h>
+#include <atomic>
+#include "ThermalGovernor.h"
+#include "TemperatureEstimator.h"
+#include "SeqLock.h"
+#include "MitigationLadder.h"
 
 
 class WiFiWrapper;
 
-// Configurable temperature thresholds
-static constexpr float TEMP_SHUTDOWN = 100.0;
-static constexpr float TEMP_DISABLE_WIFI = 95.0;
-static constexpr float TEMP_REDUCE_WIFI_POWER = 90.0;
+// Mitigation levels are entered this long before the filtered trend is predicted to
+// cross their enter temperature; a deep sleep level only acts on the filtered
+// value itself, never on a prediction or a single raw sample.
+// The levels themselves are a MitigationLadder, see setMitigationLadder().
+static constexpr uint32_t TEMP_MITIGATION_LEAD_MS = 30000;
 
+// The fixed thresholds from before the ladder, kept so existing sketches still build.
+// They are the matching enter/exit temperatures of MitigationLadder::defaults() and no
+// longer configure anything: the ladder does, and it may be replaced at run time.
+[[deprecated("use the MitigationLadder levels")]] static constexpr float TEMP_SHUTDOWN = 100.0;          // deep sleep level
+[[deprecated("use the MitigationLadder levels")]] static constexpr float TEMP_DISABLE_WIFI = 95.0;       // light sleep level
+[[deprecated("use the MitigationLadder levels")]] static constexpr float TEMP_REDUCE_WIFI_POWER = 90.0;  // TX 11 dBm level
+[[deprecated("use the MitigationLadder levels")]] static constexpr float TEMP_RESTORE_WIFI_POWER = 85.0; // its exit
+[[deprecated("use the MitigationLadder levels")]] static constexpr float TEMP_RESTORE_WIFI = 90.0;       // light sleep exit
 
-// Hysteresis threshold for restoring settings
-static constexpr float TEMP_RESTORE_WIFI_POWER = 85.0;
-static constexpr float TEMP_RESTORE_WIFI = 90.0;
+// Check interval: checkPeriodMin while mitigating or within TEMP_NEAR_BAND of the next
+// level, growing linearly to checkPeriodMax at TEMP_FAR_BAND below it
+static constexpr float TEMP_NEAR_BAND = 2.0;
+static constexpr float TEMP_FAR_BAND = 20.0;
+
+// what the last check saw, for monitoring
+struct ThermalStatus {
+    TemperatureEstimator::State estimate;
+    uint8_t level = 0;                                     // mitigation level, 0 = none
+    uint32_t msToNextLevel = TemperatureEstimator::never;  // predicted, 0 = at or above
+    uint32_t msToShutdown = TemperatureEstimator::never;   // until the first deep sleep level
+};
 
 class TemperatureSafetyManager {
 private:
-    bool wifiDisabled = false;
-    bool lowPowerMode = false;
-    bool shutdownTriggered = false;
-    int currentCpuFrequency = 240;
+    std::atomic<bool> wifiDisabled{false};
+    std::atomic<bool> lowPowerMode{false};
+    std::atomic<bool> shutdownTriggered{false};
+    std::atomic<int> currentCpuFrequency{240};
     uint32_t runcount;
+    ThermalGovernor cpuGovernor;
+    TemperatureEstimator estimator;
+    SeqLock<ThermalStatus> status;
+
+    // mitigation ladder; level and applied only change on the checking task
+    SeqLock<MitigationLadder> ladder;
+    std::atomic<uint8_t> level{0};
+    MitigationLevel applied = MitigationLadder::none();
+    uint32_t levelEnteredAt = 0;
+
+    static constexpr uint8_t maxWorkloads = 8;
+    struct Workload {
+        void (*pause)(void* arg);
+        void (*resume)(void* arg);
+        void* arg;
+    };
+    Workload workloads[maxWorkloads];
+    uint8_t workloadCount = 0;
+
+    // time based scheduling
+    uint32_t checkPeriodMin = 250;
+    uint32_t checkPeriodMax = 5000;
+    std::atomic<uint32_t> checkPeriod{250};  // adapted after every check
+    uint32_t lastCheck = 0;
+    bool checkedOnce = false;
+    TaskHandle_t taskHandle = nullptr;
+    std::atomic<bool> taskRunning{false};
+    std::atomic<bool> taskAlive{false};
     
     WiFiWrapper* wifi;
 
+    uint32_t periodFor(const ThermalStatus& st, float nextEnterC) const;
+    void setLevel(uint8_t next, const MitigationLadder& table, float temp, uint32_t now);
+    static void _task(void* pvParameters);
+
 public:
-    TemperatureSafetyManager(WiFiWrapper* wifi=0): runcount(0),wifi(wifi) {} 
+    TemperatureSafetyManager(WiFiWrapper* wifi=0): runcount(0),wifi(wifi) { ladder.store(MitigationLadder::defaults()); }
+    ~TemperatureSafetyManager() { stopTask(); }
     
     void manageTemperatureSafety();
     void begin(){manageTemperatureSafety();}//execute directly
-    void loop(uint32_t runevery=1000){
+
+    // Call from the main loop: checks when the adaptive period has elapsed, by millis(),
+    // so the interval no longer depends on how fast the loop spins. Does nothing while
+    // the task below runs. At a level with light sleep each check blocks the caller for
+    // that long (up to MitigationLadder::maxLightSleepMs); the whole chip sleeps then,
+    // from the task as well, so the main loop runs at that duty cycle either way.
+    void loop();
+    // Legacy: check every runevery-th call
+    void loop(uint32_t runevery){
         if(runcount == runevery){
             runcount = 0;
             manageTemperatureSafety();
@@ -39,11 +103,41 @@ public:
         runcount++;
     }//just a wrapper for the main loop
 
+    // Run the checks on an own low priority task instead, independent of the main loop
+    // (e.g. during a blocking connect). Checks once right away.
+    bool startTask(UBaseType_t priority = tskIDLE_PRIORITY + 1, BaseType_t core = tskNO_AFFINITY);
+    void stopTask(); // blocks until the task has exited
+    bool isTaskRunning() const { return taskAlive.load(); }
+
+    // bounds of the adaptive check interval in ms
+    void setCheckPeriod(uint32_t minMs, uint32_t maxMs) {
+        checkPeriodMin = minMs;
+        checkPeriodMax = maxMs < minMs ? minMs : maxMs;
+    }
+    uint32_t getCheckPeriod() const { return checkPeriod.load(); }
+
+    // Replace the mitigation ladder at runtime, e.g. parsed from NVS or a config file.
+    // Takes effect at the next check; a level above the new table's size drops to its top.
+    // Single writer: do not call concurrently from several tasks.
+    void setMitigationLadder(const MitigationLadder& table) { ladder.store(table); }
+    bool loadMitigationLadder(const char* text); // MitigationLadder::parse() format, false if rejected
+    MitigationLadder getMitigationLadder() const { return ladder.load(); }
+    uint8_t getMitigationLevel() const { return level; }
+
+    // Background work to pause at levels with pauseWorkloads (e.g. sensor polling,
+    // uploads). Callbacks run on the checking task. Register before startTask().
+    bool registerWorkload(void (*pause)(void* arg), void (*resume)(void* arg), void* arg = nullptr);
+
     // Getters for external monitoring
     bool isWifiDisabled() const { return wifiDisabled; }
-    bool isLowPowerMode() const { return lowPowerMode; }
+    bool isLowPowerMode() const { return lowPowerMode; }  // TX power or modem sleep limited
     bool isShutdownTriggered() const { return shutdownTriggered; }
     int getCurrentCpuFrequency() const { return currentCpuFrequency; }
+    // filtered temperature, trend, level and predicted time to the next one; lock free
+    ThermalStatus getThermalStatus() const { return status.load(); }
+    // CPU clock controller, e.g. to change the setpoint or read time per P-state
+    ThermalGovernor& governor() { return cpuGovernor; }
+    const ThermalGovernor& governor() const { return cpuGovernor; }
 };
 
 #endif // TEMPERATURE_SAFETY_MANAGER_H
\ No newline at end of file
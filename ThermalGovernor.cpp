@@ -0,0 +1,113 @@
+#include "ThermalGovernor.h"
+#include <LoggingBase.h>
+#include "Metrics.h"
+
+static Counter& freqChangesMetric = metrics().counter("cpu.freq_changes");
+static Gauge& freqMetric = metrics().gauge("cpu.mhz");
+
+constexpr uint16_t ThermalGovernor::pStates[];
+
+ThermalGovernor::ThermalGovernor() : ThermalGovernor(Config()) {}
+
+ThermalGovernor::ThermalGovernor(const Config& config) : config_(config) {}
+
+void ThermalGovernor::reset() {
+    started_ = false;
+    integral_ = 0.0f;
+    demand_ = pStates[numPStates - 1];
+    transitions_ = 0;
+    for (uint8_t i = 0; i < numPStates; ++i) {
+        timeIn_[i] = 0;
+    }
+}
+
+uint8_t ThermalGovernor::nearestPState(uint32_t mhz) const {
+    uint8_t best = 0;
+    for (uint8_t i = 1; i < numPStates; ++i) {
+        if (abs((int)pStates[i] - (int)mhz) < abs((int)pStates[best] - (int)mhz)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+uint8_t ThermalGovernor::pStateAtMost(uint32_t mhz) {
+    uint8_t i = numPStates - 1;
+    while (i > 0 && pStates[i] > mhz) --i;
+    return i;
+}
+
+uint32_t ThermalGovernor::update(float temperature, uint32_t now) {
+    const float fmin = pStates[0];
+    const float fmax = pStates[numPStates - 1];
+
+    if (!started_) {
+        // take over whatever clock we were started at
+        started_ = true;
+        pState_ = applyFrequency_ ? nearestPState(getCpuFrequencyMhz()) : numPStates - 1;
+        lastUpdate_ = now;
+        enteredAt_ = now;
+        lastTemperature_ = temperature;
+        integral_ = 0.0f;
+    }
+
+    uint32_t elapsed = now - lastUpdate_;
+    float dt = elapsed / 1000.0f;
+    timeIn_[pState_] += elapsed;
+    lastUpdate_ = now;
+
+    // PID around full speed: no error = 240 MHz, positive error (too hot) pulls down
+    float error = temperature - config_.setpoint;
+    float derivative = dt > 0.0f ? (temperature - lastTemperature_) / dt : 0.0f;
+    lastTemperature_ = temperature;
+
+    // integral term is the sustained clock reduction, bounded to the usable range (anti-windup)
+    integral_ = constrain(integral_ + config_.ki * error * dt, 0.0f, fmax - fmin);
+    demand_ = constrain(fmax - config_.kp * error - integral_ - config_.kd * derivative, fmin, fmax);
+
+    // quantize with hysteresis and dwell
+    uint8_t target = pState_;
+    if (pState_ + 1 < numPStates &&
+        demand_ > (pStates[pState_] + pStates[pState_ + 1]) / 2.0f + config_.marginMhz) {
+        target = pState_ + 1;
+    } else if (pState_ > 0 &&
+               demand_ < (pStates[pState_] + pStates[pState_ - 1]) / 2.0f - config_.marginMhz) {
+        target = pState_ - 1;
+    }
+    // when far too hot, go straight to the bottom
+    bool emergency = temperature >= config_.setpoint + config_.emergencyMargin;
+    if (emergency) {
+        target = 0;
+    }
+    // a cap (mitigation ladder) wins over the PID and does not wait for the dwell
+    bool capped = pState_ > capPState_;
+    if (target > capPState_) {
+        target = capPState_;
+    }
+
+    if (target != pState_ && (emergency || capped || now - enteredAt_ >= config_.minDwellMs)) {
+        if (!applyFrequency_ || setCpuFrequencyMhz(pStates[target])) {
+            pState_ = target;
+            enteredAt_ = now;
+            transitions_++;
+            if (applyFrequency_) {
+                freqChangesMetric.add();
+                freqMetric.set(pStates[target]);
+                metrics().event(MetricEvent::CpuFrequency, pStates[target]);
+            }
+        } else {
+            gLogger->println("[ThermalGovernor] Could not set CPU frequency.");
+        }
+    }
+    return pStates[pState_];
+}
+
+float ThermalGovernor::averageFrequency() const {
+    uint64_t total = 0;
+    uint64_t weighted = 0;
+    for (uint8_t i = 0; i < numPStates; ++i) {
+        total += timeIn_[i];
+        weighted += (uint64_t)timeIn_[i] * pStates[i];
+    }
+    return total ? (float)weighted / total : (float)pStates[pState_];
+}
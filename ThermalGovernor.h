@@ -0,0 +1,71 @@
+#ifndef THERMAL_GOVERNOR_H
+#define THERMAL_GOVERNOR_H
+
+#include <Arduino.h>
+
+// Closed-loop CPU clock governor. A PID controller turns the distance to a
+// temperature setpoint into a frequency demand, which is quantized to the
+// P-states the ESP32 PLL supports (80/160/240 MHz). A P-state change needs
+// the demand to clear the midpoint between two states by a margin and the
+// current state to have been held for a minimum dwell time, so bursty load
+// does not make the clock flap. Above the emergency margin the dwell is skipped.
+class ThermalGovernor {
+public:
+    static constexpr uint8_t numPStates = 3;
+    static constexpr uint16_t pStates[numPStates] = {80, 160, 240};
+
+    struct Config {
+        float setpoint = 80.0f;        // °C the controller regulates to
+        float kp = 4.0f;               // MHz per °C
+        float ki = 0.2f;               // MHz per °C*s
+        float kd = 10.0f;              // MHz per °C/s, on the measurement
+        float marginMhz = 30.0f;       // quantization hysteresis beyond the midpoint
+        uint32_t minDwellMs = 15000;   // minimum time in a P-state
+        float emergencyMargin = 8.0f;  // °C above setpoint where dwell is ignored
+    };
+
+    ThermalGovernor();
+    explicit ThermalGovernor(const Config& config);
+
+    // feed one temperature sample; applies and returns the CPU frequency in MHz
+    // (only returns it, as a cap, with setApplyFrequency(false))
+    uint32_t update(float temperature, uint32_t now);
+
+    void setConfig(const Config& config) { config_ = config; }
+    // false: only compute the P-state (used as a cap by DvfsGovernor), leave the clock alone
+    void setApplyFrequency(bool apply) { applyFrequency_ = apply; }
+    const Config& config() const { return config_; }
+    void reset();
+
+    // highest clock allowed regardless of the PID, rounded down to a P-state; 0 = no cap.
+    // A lower cap applies at the next update(), without waiting for the dwell time.
+    void setFrequencyCap(uint32_t mhz) { capPState_ = mhz ? pStateAtMost(mhz) : numPStates - 1; }
+    uint32_t frequencyCap() const { return pStates[capPState_]; }
+
+    uint32_t currentFrequency() const { return pStates[pState_]; }
+    float demand() const { return demand_; }          // unquantized PID output, MHz
+    uint32_t transitions() const { return transitions_; }
+    // ms spent in each P-state since reset(), including the current one up to the last update()
+    uint32_t timeInPState(uint8_t i) const { return timeIn_[i]; }
+    // time weighted average frequency since reset()
+    float averageFrequency() const;
+
+private:
+    uint8_t nearestPState(uint32_t mhz) const;
+    static uint8_t pStateAtMost(uint32_t mhz);
+
+    Config config_;
+    bool applyFrequency_ = true;
+    bool started_ = false;
+    uint32_t lastUpdate_ = 0;
+    uint32_t enteredAt_ = 0;
+    float integral_ = 0.0f;   // MHz
+    float lastTemperature_ = 0.0f;
+    float demand_ = 240.0f;
+    uint8_t pState_ = numPStates - 1;
+    uint8_t capPState_ = numPStates - 1;
+    uint32_t transitions_ = 0;
+    uint32_t timeIn_[numPStates] = {0, 0, 0};
+};
+
+#endif // THERMAL_GOVERNOR_H
@@ -1,14 +1,21 @@
 #include <TimeManager.h>
 #include <LoggingBase.h>
+#include "Metrics.h"
+#include "DeferredLog.h"
 
-// Helper: Convert a struct tm in UTC to time_t.
-// Use timegm() if available. On some systems you might need to implement your own.
-#ifndef timegm
-  #define timegm mktime  // Note: mktime assumes local time, so ideally use timegm.
-#endif
+static Counter& syncsMetric = metrics().counter("time.syncs");
+static Counter& syncFailuresMetric = metrics().counter("time.sync_failures");
+static Histogram& syncMsMetric = metrics().histogram("time.sync_ms");
+static Gauge& correctionMetric = metrics().gauge("time.correction_ms");
+static Gauge& driftMetric = metrics().gauge("time.drift_ppb");
+static Gauge& pollMetric = metrics().gauge("time.poll_s");
 
 void TimeManager::begin() {
-    timeClient.begin();
+    if (sntp.serverCount() == 0) {
+        sntp.addServer("0.pool.ntp.org");
+        sntp.addServer("1.pool.ntp.org");
+        sntp.addServer("2.pool.ntp.org");
+    }
     syncTime();
 
     BaseType_t ok =  xTaskCreatePinnedToCore(
@@ -28,107 +35,194 @@ void TimeManager::begin() {
 void TimeManager::_syncTask(void* pvParameters){
     auto self = static_cast<TimeManager*>(pvParameters);
   
-    const TickType_t delayTicks = pdMS_TO_TICKS(60UL*60UL*1000UL);  // one hour
-  
     for(;;){
-      // protect the NTP client
-      if(xSemaphoreTake(self->_lock, pdMS_TO_TICKS(500)) == pdTRUE){
+      // sleep until the next sync is due, or until just after the next DST change
+      // (the getters switch on their own, this moves the snapshot on to the one after)
+      int32_t untilSync = (int32_t)(self->_nextSyncAt - millis());
+      // at most an hour per delay, pdMS_TO_TICKS() overflows a 32 bit tick count beyond ~71 min
+      uint32_t wait = untilSync <= 0 ? 0 : (uint32_t)untilSync < HOUR ? (uint32_t)untilSync : HOUR;
+      TimeSnapshot s = self->_snapshot.load();
+      if (s.synced && s.nextChange != Timezone::noTransition) {
+        uint32_t utc = utcEpoch(s);
+        uint32_t untilChange = s.nextChange > utc ? s.nextChange - utc + 1 : 1;
+        if (untilChange < wait / 1000) wait = untilChange * 1000;
+      }
+      vTaskDelay(pdMS_TO_TICKS(wait));
+      if ((int32_t)(self->_nextSyncAt - millis()) <= 0) {
         self->syncTime();
+      } else if (xSemaphoreTake(self->_lock, pdMS_TO_TICKS(500)) == pdTRUE) {
+        self->publish(nullptr);
         xSemaphoreGive(self->_lock);
-      } else {
-        // if we cannot take the lock, skip this round
-        gLogger->println("TimeSync: failed to acquire lock");
       }
-      vTaskDelay(delayTicks);
     }
   }
 
 void TimeManager::syncTime() {
-    if (WiFi.status() == WL_CONNECTED) {
-        
-        timeClient.setTimeOffset(0); // Ensure we start from UTC
-        timeClient.update();
-        
-        uint32_t utcTime = timeClient.getEpochTime(); // Get raw UTC time
-        struct tm timeinfo;
-        gmtime_r((time_t*)&utcTime, &timeinfo);
+    if (WiFi.status() != WL_CONNECTED) {
+        gLogger->println("WiFi not connected, cannot sync time!");
+        syncFailuresMetric.add();
+        metrics().event(MetricEvent::TimeSyncFailed);
+        xSemaphoreTake(_lock, portMAX_DELAY);
+        discipline.missed();
+        _nextSyncAt = millis() + discipline.nextPollS() * 1000;
+        xSemaphoreGive(_lock);
+        return;
+    }
+
+    // the round trip happens here without any lock, getters keep reading the old snapshot
+    uint32_t started = millis();
+    if (sntp.start()) {
+        while (!sntp.poll()) {
+            vTaskDelay(syncPollTicks);
+        }
+    }
+    syncMsMetric.record(millis() - started);
+
+    const SntpResult& result = sntp.result();
+    if (result.valid) {
+        deferredLog().log("[TimeManager] %s stratum %u, delay %d ms, %u of %u replies (%u outliers)",
+                          sntp.serverName(result.server), result.stratum, (int32_t)(result.delayUs / 1000),
+                          result.replies, sntp.serverCount(), result.outliers);
+    } else {
+        syncFailuresMetric.add();
+        metrics().event(MetricEvent::TimeSyncFailed);
+    }
+
+    // the discipline is also read by setTimezone() on the caller's task
+    if (xSemaphoreTake(_lock, pdMS_TO_TICKS(500)) == pdTRUE) {
+        if (!result.valid) {
+            discipline.missed();
+        }
+        publish(result.valid ? &result : nullptr);
+        _nextSyncAt = millis() + discipline.nextPollS() * 1000;
+        xSemaphoreGive(_lock);
+    } else {
+        gLogger->println("TimeSync: failed to acquire lock");
+        _nextSyncAt = millis() + (1000u << ClockDiscipline::minPollExp);
+    }
+}
 
-        // Determine if Berlin is in summer time
-        bool summerTime = isSummerTime(utcTime);
-        timeOffset = summerTime ? 7200 : 3600;  // 2 hours for summer, 1 hour for winter
+// Feeds a sync result to the clock discipline, swaps in the new snapshot and
+// corrects the system clock: stepped the first time and after large errors,
+// slewed with adjtime() otherwise. Without a result the clock model is kept and
+// only the DST offset is brought up to date.
+void TimeManager::publish(const SntpResult* result) {
+    if (!result && !discipline.isSet()) {
+        return;
+    }
 
-        // Apply DST offset
-        time_t localTime = utcTime + timeOffset;
+    ClockDiscipline::Action action = ClockDiscipline::Action::Slew;
+    if (result) {
+        action = discipline.update(result->localUs, result->offsetUs, result->distanceUs);
+        int32_t correctionMs = (int32_t)(discipline.lastResidualUs() / 1000);
+        syncsMetric.add();
+        correctionMetric.set(correctionMs);
+        driftMetric.set(-discipline.model().freqPpb);
+        pollMetric.set(discipline.nextPollS());
+        metrics().event(MetricEvent::TimeSync, correctionMs);
+        deferredLog().log("[TimeManager] %s %d ms, drift %d ppb, next sync in %u s",
+                          action == ClockDiscipline::Action::Step ? "Stepped" : "Slewing",
+                          correctionMs, -discipline.model().freqPpb, discipline.nextPollS());
+    }
 
+    TimeSnapshot snapshot;
+    snapshot.clock = discipline.model();
+    int64_t utcUs = snapshot.clock.utcUs(esp_timer_get_time());
 
+    uint32_t utcTime = (uint32_t)(utcUs / 1000000);
+    int32_t lastOffset = timeOffset;
+    timeOffset = tz.offsetAt(utcTime);
+    snapshot.lastChange = tz.lastTransition(utcTime, &snapshot.lastOffset);
+    snapshot.nextChange = tz.nextTransition(utcTime, &snapshot.nextOffset);
+
+    // Apply DST offset
+    if (action == ClockDiscipline::Action::Step || timeOffset != lastOffset) {
         struct timeval tv;
-        tv.tv_sec = localTime;
-        tv.tv_usec = 0;
+        tv.tv_sec = (time_t)utcTime + timeOffset;
+        tv.tv_usec = (suseconds_t)(utcUs % 1000000);
         settimeofday(&tv, NULL);
+    } else if (result) {
+        int64_t slewUs = snapshot.clock.slewUs;
+        struct timeval delta;
+        delta.tv_sec = (time_t)(slewUs / 1000000);
+        delta.tv_usec = (suseconds_t)(slewUs % 1000000);
+        adjtime(&delta, NULL);
+    }
 
-        timeClient.setTimeOffset(timeOffset); 
-    } else {
-        gLogger->println("WiFi not connected, cannot sync time!");
+    // publish for the lock-free getters
+    snapshot.offset = timeOffset;
+    snapshot.pollIntervalS = discipline.pollIntervalS();
+    snapshot.synced = true;
+    _snapshot.store(snapshot);
+
+    if (_clockChangeCallback) {
+        _clockChangeCallback(_clockChangeArg);
+    }
+}
+
+void TimeManager::onClockChange(ClockChangeCallback callback, void* arg) {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _clockChangeCallback = callback;
+    _clockChangeArg = arg;
+    xSemaphoreGive(_lock);
+}
+
+void TimeManager::removeClockChange(ClockChangeCallback callback, void* arg) {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    if (_clockChangeCallback == callback && _clockChangeArg == arg) {
+        _clockChangeCallback = nullptr;
+        _clockChangeArg = nullptr;
     }
+    xSemaphoreGive(_lock);
 }
 
 
-bool TimeManager::isSummerTime(uint32_t rawTime) const {
-    struct tm timeInfo;
-    gmtime_r((time_t*)&rawTime, &timeInfo);
-    int year = timeInfo.tm_year + 1900;
-    int month = timeInfo.tm_mon + 1;
-    int day = timeInfo.tm_mday;
-    
-    // Outside DST months in Europe:
-    if (month < 3 || month > 10)
+uint32_t TimeManager::utcOf(const TimeSnapshot& s, uint32_t localTime) {
+    // the latest instant that reads localTime under the offset in effect then
+    const int32_t offsets[3] = {s.lastOffset, s.offset, s.nextOffset};
+    uint32_t best = 0;
+    for (int32_t offset : offsets) {
+        uint32_t utc = localTime - offset;
+        if (offsetAt(s, utc) == offset && utc > best) {
+            best = utc;
+        }
+    }
+    if (best) {
+        return best;
+    }
+    // in the gap of a change forward: keep the offset from before it
+    return localTime - ((int64_t)localTime - s.offset >= (int64_t)s.nextChange ? s.offset : s.lastOffset);
+}
+
+bool TimeManager::setTimezone(const char* posixTz) {
+    if (xSemaphoreTake(_lock, portMAX_DELAY) != pdTRUE) {
         return false;
-    if (month > 3 && month < 10)
-        return true;
-    
-    // For March and October, calculate the last Sunday of the month.
-    int lastSunday = 0;
-    if (month == 3) {
-        // March always has 31 days.
-        struct tm t31 = {0};
-        t31.tm_year = year - 1900;
-        t31.tm_mon  = 2;    // March (0-indexed)
-        t31.tm_mday = 31;
-        t31.tm_hour = 12;   // Use midday to avoid edge issues
-        time_t ts31 = timegm(&t31); // Get Unix time for March 31 in UTC
-        // Calculate weekday: 0=Sunday, ... 6=Saturday.
-        int wday31 = ((ts31 / 86400UL) + 4) % 7;  // Unix epoch (Jan 1, 1970) was a Thursday (4)
-        lastSunday = 31 - ((wday31 + 6) % 7);
-        // DST starts on the last Sunday of March.
-        return day >= lastSunday;
-    }
-    if (month == 10) {
-        // October always has 31 days.
-        struct tm t31 = {0};
-        t31.tm_year = year - 1900;
-        t31.tm_mon  = 9;    // October (0-indexed)
-        t31.tm_mday = 31;
-        t31.tm_hour = 12;
-        time_t ts31 = timegm(&t31);
-        int wday31 = ((ts31 / 86400UL) + 4) % 7;
-        lastSunday = 31 - ((wday31 + 6) % 7);
-        // DST ends on the last Sunday of October: if current day is before that, DST is still active.
-        return day < lastSunday;
-    }
-    return false;
+    }
+    bool ok = tz.set(posixTz);
+    if (ok) {
+        publish(nullptr); // only if synced, and then the system clock follows
+    }
+    xSemaphoreGive(_lock);
+    return ok;
 }
 
-String TimeManager::formattedDateAndTime(uint32_t rawTime){
+size_t TimeManager::getFormattedTime(char* buf, size_t len) const {
+    return CivilTime::formatTime(getEpochTime(), buf, len);
+}
 
-    struct tm timeInfo;
-    gmtime_r((time_t*)&rawTime, &timeInfo);  // Convert Unix time to UTC struct
+size_t TimeManager::formattedDateAndTime(uint32_t rawTime, char* buf, size_t len){
+    return CivilTime::formatDateTime(rawTime, buf, len);
+}
 
-    // Format the date as DD-MM-YYYY HH:MM:SS
-    char buffer[20];
-    snprintf(buffer, sizeof(buffer), "%02d-%02d-%04d %02d:%02d:%02d",
-    timeInfo.tm_mday, timeInfo.tm_mon + 1, timeInfo.tm_year + 1900,
-    timeInfo.tm_hour, timeInfo.tm_min, timeInfo.tm_sec);
+size_t TimeManager::getIso8601(char* buf, size_t len) const {
+    TimeSnapshot s = _snapshot.load();
+    uint32_t utc = utcEpoch(s);
+    return CivilTime::formatIso8601(utc, offsetAt(s, utc), buf, len);
+}
 
+String TimeManager::formattedDateAndTime(uint32_t rawTime){
+    char buffer[formattedDateAndTimeSize];
+    formattedDateAndTime(rawTime, buffer, sizeof(buffer));
     return String(buffer);
 }
 
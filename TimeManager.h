@@ -2,11 +2,14 @@
 #define TIME_MANAGER_H
 
 #include <WiFi.h>
-#include "NTPClient.h"
 #include "esp_wifi.h"
-#include <WiFiUdp.h>
+#include "SntpClient.h"
+#include "ClockDiscipline.h"
+#include "Timezone.h"
+#include "CivilTime.h"
 #include <time.h>
 #include <TimeProviderBase.h>
+#include "SeqLock.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
@@ -26,21 +29,67 @@ class TimeManager: public TimeProviderBase {
         if (ms > 0xFFFFFFFFu) ms = 0xFFFFFFFFu;
         return static_cast<uint32_t>(ms + 0.5);
     };
+    typedef void (*ClockChangeCallback)(void* arg);
 private:
-    WiFiUDP ntpUDP;
-    NTPClient timeClient;
+    SntpClient sntp;            // used by begin() and then _syncTask only
+    ClockDiscipline discipline; // under _lock, publish() reads it from setTimezone() too
+    uint32_t _nextSyncAt = 0;   // millis()
     int32_t timeOffset = 0; // Start with UTC (no offset)
+    Timezone tz{Timezone::berlin};
+
+    // everything the getters need, published once per syncTime()
+    struct TimeSnapshot {
+        ClockModel clock;          // UTC from esp_timer_get_time()
+        int32_t  offset = 0;       // local offset incl. DST
+        uint32_t lastChange = 0;   // UTC of the last DST change ...
+        int32_t  lastOffset = 0;   // ... and the offset until then
+        uint32_t nextChange = Timezone::noTransition; // UTC of the next DST change ...
+        int32_t  nextOffset = 0;   // ... and the offset from then on
+        uint32_t pollIntervalS = 0;
+        bool     synced = false;
+    };
+    SeqLock<TimeSnapshot> _snapshot; // lock-free for readers, written by syncTime() only
+
+    static uint32_t utcEpoch(const TimeSnapshot& s) {
+        return (uint32_t)(s.clock.utcUs(esp_timer_get_time()) / 1000000);
+    }
+    // the DST change is applied by the getters themselves, to the second;
+    // _syncTask only moves the snapshot on to the following one
+    static int32_t offsetAt(const TimeSnapshot& s, uint32_t utc) {
+        return utc >= s.nextChange ? s.nextOffset : utc < s.lastChange ? s.lastOffset : s.offset;
+    }
+    static uint32_t localEpoch(const TimeSnapshot& s) {
+        uint32_t utc = utcEpoch(s);
+        return utc + offsetAt(s, utc);
+    }
+    // a local time skipped by a DST change maps to as far after the gap as it
+    // was into it, one that happens twice to the second time
+    static uint32_t utcOf(const TimeSnapshot& s, uint32_t localTime);
+    static uint32_t nextLocalHit(uint32_t local, int hours, int minutes) {
+        uint32_t dayStart  = local - local % 86400;                // local 00:00 today
+        uint32_t candidate = dayStart + uint32_t(hours) * 3600UL + uint32_t(minutes) * 60UL;
+        // if that time has already passed (or is exactly now), move to tomorrow
+        if (candidate <= local) {
+            candidate += 86400;
+        }
+        return candidate;
+    }
 
-    bool isSummerTime(uint32_t rawTime) const; //in UTC
-
-    SemaphoreHandle_t   _lock;         // protects timeClient / timeOffset
+    SemaphoreHandle_t   _lock;         // protects tz, timeOffset, discipline, the callback and setting the clock (writer side only)
     TaskHandle_t        _syncTaskHandle;
+    ClockChangeCallback _clockChangeCallback = nullptr;
+    void*               _clockChangeArg = nullptr;
 
     static void        _syncTask(void* pvParameters);
-    void syncTime();//now private as it requires a lock
+    void syncTime(); // runs an SNTP round, only the final swap takes the lock
+    void publish(const SntpResult* result);
 
 public:
-    TimeManager() : timeClient(ntpUDP, "pool.ntp.org", 0) {
+    // how often _syncTask looks for replies during a round: every tick, since a
+    // reply picked up late reads as a longer round trip and a skewed offset
+    static constexpr TickType_t syncPollTicks = 1;
+
+    TimeManager() {
         _lock = xSemaphoreCreateMutex();
         _syncTaskHandle = nullptr;
     }
@@ -53,117 +102,139 @@ public:
         }
     }
 
+    // up to SntpClient::maxServers, before begin(); without any, 0-2.pool.ntp.org
+    bool addNtpServer(const char* host) { return sntp.addServer(host); }
+    // POSIX TZ string, e.g. "EST5EDT,M3.2.0,M11.1.0"; Berlin until set.
+    // false if it does not parse. Can be changed at any time.
+    bool setTimezone(const char* posixTz);
+    // accuracy to keep; the poll interval grows as long as syncs confirm it, before begin()
+    void setErrorBudgetMs(uint32_t ms) { discipline.setErrorBudgetUs((int64_t)ms * 1000); }
+    // called from the sync task after every sync, DST change and setTimezone(),
+    // while the lock is held: keep it short (Scheduler only wakes its task)
+    void onClockChange(ClockChangeCallback callback, void* arg = nullptr);
+    // clears the callback, only if it is still this one with this arg
+    void removeClockChange(ClockChangeCallback callback, void* arg);
+
     void begin();
     void loop() {
         //empty
     }
+    // all getters below read one consistent snapshot and never block,
+    // even while _syncTask is in the middle of an NTP round trip
     bool isSynced() const {
-        if(xSemaphoreTake(_lock, pdMS_TO_TICKS(50))==pdTRUE){
-            bool synced = timeClient.isTimeSet();
-            xSemaphoreGive(_lock);
-            return synced;
-        }
-        return false; // if we cannot take the lock, assume not synced
-    }   
-
-    int getHours() {
-        int h = 0;
-        if(xSemaphoreTake(_lock, pdMS_TO_TICKS(50))==pdTRUE){
-            h = timeClient.getHours();
-            xSemaphoreGive(_lock);
-        }
-        return h;
-    }
-    int getHour(){return getHours();} // for compatibility with other classes
-    int getMinutes() {
-        int m = 0;
-        if(xSemaphoreTake(_lock, pdMS_TO_TICKS(50))==pdTRUE){
-            m = timeClient.getMinutes();
-            xSemaphoreGive(_lock);
-        }
-        return m;
+        return _snapshot.load().synced;
     }
-    int getSeconds() {
-        int s = 0;
-        if(xSemaphoreTake(_lock, pdMS_TO_TICKS(50))==pdTRUE){
-            s = timeClient.getSeconds();
-            xSemaphoreGive(_lock);
-        }
-        return s;
+
+    // UTC in microseconds, drift corrected and slewed
+    int64_t getUnixUTCMicros() const {
+        return _snapshot.load().clock.utcUs(esp_timer_get_time());
+    }
+    // how far the time reported now may be off: the last sync's root distance,
+    // plus what the remaining frequency uncertainty has added since, plus any
+    // correction still being slewed in. UINT32_MAX until synced.
+    uint32_t getErrorBoundMs() const {
+        TimeSnapshot s = _snapshot.load();
+        if (!s.synced) return UINT32_MAX;
+        int64_t ms = (s.clock.errorUs(esp_timer_get_time()) + 999) / 1000;
+        return ms >= UINT32_MAX ? UINT32_MAX - 1 : (uint32_t)ms;
+    }
+    // estimated frequency error of the local oscillator, ppb; positive is fast
+    int32_t getDriftPpb() const {
+        return -_snapshot.load().clock.freqPpb;
+    }
+    uint32_t getPollIntervalS() const {
+        return _snapshot.load().pollIntervalS;
+    }
+    // getter reads that overlapped a publish and copied the snapshot again
+    uint32_t getSnapshotRetries() const {
+        return _snapshot.retries();
+    }
+
+    int getHours() const {
+        return (getEpochTime() % 86400L) / 3600;
+    }
+    int getHour() const {return getHours();} // for compatibility with other classes
+    int getMinutes() const {
+        return (getEpochTime() % 3600) / 60;
+    }
+    int getSeconds() const {
+        return getEpochTime() % 60;
     }
 
     uint32_t getDay(uint32_t rawTime=0) const {
         if(rawTime == 0)
-            rawTime = timeClient.getEpochTime();
+            rawTime = getEpochTime();
         return (((rawTime  / 86400L) + 4 ) % 7);
     }
 
-    uint32_t getEpochTime() {
-        uint32_t rawTime = 0;
-        if(xSemaphoreTake(_lock, pdMS_TO_TICKS(50))==pdTRUE){
-            rawTime = timeClient.getEpochTime();
-            xSemaphoreGive(_lock);
-        }
-        return rawTime;
+    // local time (UTC + offset)
+    uint32_t getEpochTime() const {
+        return localEpoch(_snapshot.load());
     }
 
-    bool isNightTime() {
+    bool isNightTime() const {
         int hour = getHour();
         return (hour >= 22 || hour < 7);
     }
 
-    int getSecondsOfDay() {
-        return getHours() * 3600 +  getMinutes() * 60 +  getSeconds();
+    int getSecondsOfDay() const {
+        return getEpochTime() % 86400L; // one snapshot, cannot tear across a second boundary
     }
 
-    uint32_t getUnixTime() {
+    uint32_t getUnixTime() const {
         return  getEpochTime(); 
     }
 
-    uint32_t getUnixUTCTime(uint32_t localTime=0) {
+    uint32_t getUnixUTCTime(uint32_t localTime=0) const {
+        TimeSnapshot s = _snapshot.load();
         if(!localTime)
-            return  getEpochTime() - timeOffset; // Always return UTC
-        return localTime - timeOffset;
+            return  utcEpoch(s); // Always return UTC
+        return utcOf(s, localTime);
+    }
+    // offset from UTC (DST included) in effect at the given UTC time; exact
+    // from before the last DST change until the one after the next
+    int32_t getUtcOffset(uint32_t utc) const {
+        return offsetAt(_snapshot.load(), utc);
     }
 
-    // returns the UNIX‑time (seconds since epoch) of the next occurrence
+    // returns the local time (like getUnixTime()) of the next occurrence
     // of HH:MM in 24h, (midnight = 00:00).
-    uint32_t getUnixNextTimeWeHit(int hours, int minutes = 0) {
-        static constexpr uint32_t SEC_PER_DAY = 24UL * 3600UL;
-    
-        uint32_t now       = getUnixTime();
-        uint32_t elapsed   = now % SEC_PER_DAY;                    // seconds since today’s 00:00 UTC
-        uint32_t targetOff = uint32_t(hours) * 3600UL              // seconds into the day
-                            + uint32_t(minutes) * 60UL;
-        uint32_t dayStart  = now - elapsed;                        // UNIX time at today’s 00:00 UTC
-        uint32_t candidate = dayStart + targetOff;                 // today’s HH:MM
-    
-        // if that time has already passed (or is exactly now), move to tomorrow
-        if (candidate <= now) {
-            candidate += SEC_PER_DAY;
-        }
-        return candidate;
+    uint32_t getUnixNextTimeWeHit(int hours, int minutes = 0) const {
+        return nextLocalHit(getUnixTime(), hours, minutes);
     }
 
-    uint32_t getSecondsUntilWeHit(int hours, int minutes = 0){
-        uint32_t now = getUnixTime();
-        uint32_t target = getUnixNextTimeWeHit(hours, minutes);
-        return target - now;
+    // real seconds until then, also when a DST change lies in between
+    uint32_t getSecondsUntilWeHit(int hours, int minutes = 0) const {
+        TimeSnapshot s = _snapshot.load();
+        uint32_t utc = utcEpoch(s);
+        uint32_t target = nextLocalHit(utc + offsetAt(s, utc), hours, minutes);
+        return utcOf(s, target) - utc;
     }
 
-    String getFormattedTime() {
-        String formattedTime;
-        if(xSemaphoreTake(_lock, pdMS_TO_TICKS(50))==pdTRUE){
-            formattedTime = timeClient.getFormattedTime();
-            xSemaphoreGive(_lock);
-        }
-        return formattedTime;
+    // buffer sizes including the terminating zero
+    static constexpr size_t formattedTimeSize = CivilTime::timeSize;            // HH:MM:SS
+    static constexpr size_t formattedDateAndTimeSize = CivilTime::dateTimeSize; // DD-MM-YYYY HH:MM:SS
+    static constexpr size_t iso8601Size = CivilTime::isoSize;                   // YYYY-MM-DDTHH:MM:SS+01:00
+
+    // The char* versions write into the caller's buffer without touching the heap and
+    // return the number of characters written (excluding the zero, truncated to fit).
+    size_t getFormattedTime(char* buf, size_t len) const;
+    String getFormattedTime() const {
+        char buffer[formattedTimeSize];
+        getFormattedTime(buffer, sizeof(buffer));
+        return String(buffer);
     }
     
+    size_t getFormattedDateAndTime(uint32_t rawTime, char* buf, size_t len) const {
+        return formattedDateAndTime(rawTime, buf, len);
+    }
     String getFormattedDateAndTime(uint32_t rawTime) const;
+    static size_t formattedDateAndTime(uint32_t rawTime, char* buf, size_t len);
     static  String formattedDateAndTime(uint32_t rawTime);
+    // local time with its UTC offset, for logs and telemetry records
+    size_t getIso8601(char* buf, size_t len) const;
 
-    bool isInBetween(int startHour, int endHour) {
+    bool isInBetween(int startHour, int endHour) const {
         int currentHour = getHour();
         if (startHour < endHour) {
             return currentHour >= startHour && currentHour < endHour;
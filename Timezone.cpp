@@ -0,0 +1,202 @@
+#include "Timezone.h"
+#include "CivilTime.h"
+
+#include <ctype.h>
+#include <string.h>
+
+const char* Timezone::parseName(const char* p, char* out) {
+    size_t n = 0;
+    if (*p == '<') {
+        // quoted, may contain digits and signs: <+0330>
+        for (++p; *p && *p != '>'; ++p) {
+            if (n >= maxNameLength) return nullptr;
+            out[n++] = *p;
+        }
+        if (*p++ != '>') return nullptr;
+    } else {
+        for (; isalpha((unsigned char)*p); ++p) {
+            if (n >= maxNameLength) return nullptr;
+            out[n++] = *p;
+        }
+    }
+    out[n] = 0;
+    return n >= 3 ? p : nullptr;
+}
+
+// [+-]hh[:mm[:ss]]
+const char* Timezone::parseTime(const char* p, int32_t& seconds, int32_t maxHours) {
+    int32_t sign = 1;
+    if (*p == '+' || *p == '-') {
+        sign = *p == '-' ? -1 : 1;
+        ++p;
+    }
+    int32_t parts[3] = {0, 0, 0};
+    for (int i = 0; i < 3; ++i) {
+        if (!isdigit((unsigned char)*p)) return nullptr;
+        int32_t v = 0;
+        for (int digits = 0; isdigit((unsigned char)*p); ++p) {
+            if (++digits > 3) return nullptr;
+            v = v * 10 + (*p - '0');
+        }
+        parts[i] = v;
+        if (*p != ':' || i == 2) break;
+        ++p;
+    }
+    if (parts[0] > maxHours || parts[1] > 59 || parts[2] > 59) return nullptr;
+    seconds = sign * (parts[0] * 3600 + parts[1] * 60 + parts[2]);
+    return p;
+}
+
+static const char* parseNumber(const char* p, uint32_t& v, uint32_t lo, uint32_t hi) {
+    if (!isdigit((unsigned char)*p)) return nullptr;
+    v = 0;
+    for (int digits = 0; isdigit((unsigned char)*p); ++p) {
+        if (++digits > 3) return nullptr;
+        v = v * 10 + (*p - '0');
+    }
+    return v >= lo && v <= hi ? p : nullptr;
+}
+
+// Mm.w.d | Jn | n, then an optional /time
+const char* Timezone::parseRule(const char* p, Rule& rule) {
+    uint32_t a, b, c;
+    rule = Rule();
+    if (*p == 'M') {
+        if (!(p = parseNumber(p + 1, a, 1, 12)) || *p++ != '.') return nullptr;
+        if (!(p = parseNumber(p, b, 1, 5)) || *p++ != '.') return nullptr;
+        if (!(p = parseNumber(p, c, 0, 6))) return nullptr;
+        rule.kind = Rule::Month;
+        rule.month = (uint8_t)a;
+        rule.week = (uint8_t)b;
+        rule.weekday = (uint8_t)c;
+    } else if (*p == 'J') {
+        if (!(p = parseNumber(p + 1, a, 1, 365))) return nullptr;
+        rule.kind = Rule::Julian1;
+        rule.day = (uint16_t)a;
+    } else {
+        if (!(p = parseNumber(p, a, 0, 365))) return nullptr;
+        rule.kind = Rule::Julian0;
+        rule.day = (uint16_t)a;
+    }
+    if (*p == '/') {
+        p = parseTime(p + 1, rule.time, 167);
+    }
+    return p;
+}
+
+bool Timezone::set(const char* posixTz) {
+    if (!posixTz) return false;
+    Timezone tz; // parse into a scratch copy, so a bad string changes nothing
+    const char* p = posixTz;
+    int32_t seconds;
+    if (!(p = parseName(p, tz.stdName_)) || !(p = parseTime(p, seconds, 24))) return false;
+    tz.stdOffset_ = -seconds;
+    tz.dstOffset_ = tz.stdOffset_;
+    tz.hasDst_ = false;
+    tz.dstName_[0] = 0;
+    if (*p) {
+        if (!(p = parseName(p, tz.dstName_))) return false;
+        tz.hasDst_ = true;
+        tz.dstOffset_ = tz.stdOffset_ + 3600;
+        if (*p && *p != ',') {
+            if (!(p = parseTime(p, seconds, 24))) return false;
+            tz.dstOffset_ = -seconds;
+        }
+        if (*p == ',') {
+            if (!(p = parseRule(p + 1, tz.start_)) || *p++ != ',') return false;
+            if (!(p = parseRule(p, tz.end_))) return false;
+        } else {
+            parseRule("M3.2.0", tz.start_);
+            parseRule("M11.1.0", tz.end_);
+        }
+    }
+    if (*p) return false; // trailing garbage
+    *this = tz;
+    return true;
+}
+
+int64_t Timezone::transitionAt(const Rule& rule, int32_t year, int32_t offsetBefore) {
+    int64_t day;
+    switch (rule.kind) {
+    case Rule::Julian1: // Feb 29 is never counted
+        day = CivilTime::daysFromCivil(year, 1, 1) + rule.day - 1 + (CivilTime::isLeap(year) && rule.day >= 60);
+        break;
+    case Rule::Julian0:
+        day = CivilTime::daysFromCivil(year, 1, 1) + rule.day;
+        break;
+    default: {
+        int64_t first = CivilTime::daysFromCivil(year, rule.month, 1);
+        uint32_t firstWeekday = CivilTime::weekday(first);
+        uint32_t mday = 1 + (rule.weekday + 7 - firstWeekday) % 7 + (rule.week - 1) * 7;
+        while (mday > CivilTime::daysInMonth(year, rule.month)) mday -= 7; // week 5: the last one
+        day = first + mday - 1;
+        break;
+    }
+    }
+    return day * 86400 + rule.time - offsetBefore;
+}
+
+// fills the table for the years around utc and finds its segment
+void Timezone::locate(uint32_t utc) {
+    if (!hasDst_) {
+        from_ = 0;
+        until_ = noTransition;
+        offset_ = nextOffset_ = stdOffset_;
+        return;
+    }
+    int32_t year = CivilTime::civilFromDays(utc / 86400).year;
+    if (year != tableYear_) {
+        uint8_t n = 0;
+        for (int32_t y = year - 1; y <= year + 1; ++y) {
+            table_[n++] = {transitionAt(start_, y, stdOffset_), dstOffset_};
+            table_[n++] = {transitionAt(end_, y, dstOffset_), stdOffset_};
+        }
+        // southern zones end DST before they start it; keep the table in order
+        for (uint8_t i = 1; i < n; ++i) {
+            for (uint8_t j = i; j > 0 && table_[j - 1].at > table_[j].at; --j) {
+                Transition t = table_[j - 1];
+                table_[j - 1] = table_[j];
+                table_[j] = t;
+            }
+        }
+        tableYear_ = year;
+    }
+
+    // utc is always past the first entry: that one is in the previous year
+    uint8_t i = 0;
+    while (i + 1 < tableSize && table_[i + 1].at <= (int64_t)utc) ++i;
+    offset_ = table_[i].offset;
+    from_ = table_[i].at < 0 ? 0 : (uint32_t)table_[i].at;
+    if (i + 1 < tableSize && table_[i + 1].at <= (int64_t)UINT32_MAX) {
+        until_ = (uint32_t)table_[i + 1].at;
+        nextOffset_ = table_[i + 1].offset;
+    } else {
+        until_ = noTransition;
+        nextOffset_ = offset_;
+    }
+}
+
+int32_t Timezone::offsetAt(uint32_t utc) {
+    if (utc >= from_ && utc < until_) {
+        return offset_;
+    }
+    locate(utc);
+    return offset_;
+}
+
+uint32_t Timezone::nextTransition(uint32_t utc, int32_t* offsetAfter) {
+    offsetAt(utc);
+    if (offsetAfter) *offsetAfter = nextOffset_;
+    return until_;
+}
+
+uint32_t Timezone::lastTransition(uint32_t utc, int32_t* offsetBefore) {
+    int32_t offset = offsetAt(utc);
+    if (!hasDst_) {
+        if (offsetBefore) *offsetBefore = offset;
+        return 0;
+    }
+    // two offsets only: before a change it was the other one
+    if (offsetBefore) *offsetBefore = offset == dstOffset_ ? stdOffset_ : dstOffset_;
+    return from_;
+}
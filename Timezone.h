@@ -0,0 +1,80 @@
+#ifndef TIMEZONE_H
+#define TIMEZONE_H
+
+#include <stdint.h>
+
+// A POSIX TZ rule, e.g. "CET-1CEST,M3.5.0,M10.5.0/3" for Berlin, parsed once.
+// Transitions are computed with plain integer date math for the years around
+// the time asked for (CivilTime), never with gmtime/mktime or the TZ environment. The
+// segment the last lookup fell into is cached, so while time moves forward
+// offsetAt() is a compare against the next boundary.
+//
+//   std offset [dst [offset] [,start[/time],end[/time]]]
+//
+// Offsets are returned east of UTC (Berlin: +3600), the opposite sign of the
+// string. Rules: Mm.w.d (week 5 = last), Jn (1-365, no Feb 29) and n (0-365);
+// times may be negative or beyond 24h. A zone with DST but no rules gets the US
+// rule, like glibc. Times are uint32 Unix seconds, good until 2106.
+// Not thread safe, the cache is updated by lookups.
+class Timezone {
+public:
+    static constexpr const char* berlin = "CET-1CEST,M3.5.0,M10.5.0/3";
+    static constexpr uint32_t noTransition = UINT32_MAX;
+    static constexpr uint8_t maxNameLength = 15;
+
+    Timezone() {} // UTC
+    explicit Timezone(const char* posixTz) { set(posixTz); } // UTC if it does not parse
+
+    // false if the string cannot be parsed; the zone is left unchanged then
+    bool set(const char* posixTz);
+
+    // offset east of UTC in seconds at utc
+    int32_t offsetAt(uint32_t utc);
+    bool isDstAt(uint32_t utc) { return hasDst_ && offsetAt(utc) == dstOffset_; }
+    // the first change after utc and the offset from then on; noTransition without DST
+    uint32_t nextTransition(uint32_t utc, int32_t* offsetAfter = nullptr);
+    // the last change at or before utc and the offset until then; 0 without DST
+    uint32_t lastTransition(uint32_t utc, int32_t* offsetBefore = nullptr);
+    const char* abbreviation(uint32_t utc) { return isDstAt(utc) ? dstName_ : stdName_; }
+
+    bool hasDst() const { return hasDst_; }
+    int32_t standardOffset() const { return stdOffset_; }
+    int32_t dstOffset() const { return dstOffset_; }
+
+private:
+    struct Rule {
+        enum Kind : uint8_t { Month, Julian1, Julian0 } kind = Month;
+        uint8_t month = 0, week = 0, weekday = 0;
+        uint16_t day = 0;
+        int32_t time = 7200; // local time of day, seconds
+    };
+    struct Transition {
+        int64_t at;
+        int32_t offset; // from then on
+    };
+
+    static const char* parseName(const char* p, char* out);
+    static const char* parseTime(const char* p, int32_t& seconds, int32_t maxHours);
+    static const char* parseRule(const char* p, Rule& rule);
+    // UTC instant of rule in year, taking effect while offsetBefore applies
+    static int64_t transitionAt(const Rule& rule, int32_t year, int32_t offsetBefore);
+    void locate(uint32_t utc);
+
+    char stdName_[maxNameLength + 1] = "UTC";
+    char dstName_[maxNameLength + 1] = "";
+    int32_t stdOffset_ = 0;
+    int32_t dstOffset_ = 0;
+    bool hasDst_ = false;
+    Rule start_, end_;
+
+    // transitions of three years around the last lookup, and the segment it hit
+    static constexpr uint8_t tableSize = 6;
+    Transition table_[tableSize];
+    int32_t tableYear_ = INT32_MIN;
+    uint32_t from_ = 1;  // empty until the first lookup
+    uint32_t until_ = 0;
+    int32_t offset_ = 0;
+    int32_t nextOffset_ = 0;
+};
+
+#endif // TIMEZONE_H
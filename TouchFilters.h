@@ -0,0 +1,128 @@
+#pragma once
+#include <Arduino.h>
+
+// Smoothing stages for touch readings, picked at compile time as the Filter
+// parameter of BasicTouchSensor. All of them:
+//   uint16_t update(uint16_t x)   feed one raw sample, returns the filtered value
+//   uint16_t value() const        last filtered value
+//   void reset(uint16_t x)        restart as if x had been read forever
+// Updates are constant time and never divide by a runtime value. The first
+// sample primes the state, so there is no ramp up from 0 after boot.
+
+// Exponential moving average, the classic (n * last + x) / (n + 1), but with the
+// state kept in 16.16 fixed point: small rises accumulate instead of being
+// truncated away, so the filter has no downward bias for large n.
+class EmaFilter {
+public:
+    static constexpr uint32_t one = 1u << 16;
+
+    explicit EmaFilter(uint8_t nMovingAvg = 0) : alpha_(alphaFor(nMovingAvg)) {}
+
+    // weight of a new sample in 0.16 fixed point; the only division, done once
+    static uint32_t alphaFor(uint8_t nMovingAvg) {
+        return (one + (nMovingAvg + 1u) / 2) / (nMovingAvg + 1u);
+    }
+    // one step on a 16.16 state, shared with TouchSensorBank
+    static uint32_t step(uint32_t state, uint16_t x, uint32_t alpha) {
+        int64_t diff = (int64_t)((uint32_t)x << 16) - (int64_t)state;
+        return (uint32_t)((int64_t)state + ((diff * (int64_t)alpha) >> 16));
+    }
+    static uint16_t round(uint32_t state) {
+        uint32_t v = (state + (one >> 1)) >> 16;
+        return v > 0xFFFF ? 0xFFFF : (uint16_t)v;
+    }
+
+    uint16_t update(uint16_t x) {
+        state_ = primed_ ? step(state_, x, alpha_) : (uint32_t)x << 16;
+        primed_ = true;
+        return value();
+    }
+    uint16_t value() const { return round(state_); }
+    void reset(uint16_t x) {
+        state_ = (uint32_t)x << 16;
+        primed_ = true;
+    }
+
+private:
+    uint32_t alpha_;
+    uint32_t state_ = 0;
+    bool primed_ = false;
+};
+
+// True N-sample moving average over a ring buffer with a running sum.
+// N is a compile-time constant, so the division is a multiply (a shift for powers of two).
+template<uint8_t N>
+class BoxcarFilter {
+    static_assert(N >= 1, "BoxcarFilter needs at least one sample");
+
+public:
+    explicit BoxcarFilter(uint8_t = 0) {} // window is N, the runtime length is ignored
+
+    uint16_t update(uint16_t x) {
+        if (!primed_) {
+            reset(x);
+            return x;
+        }
+        sum_ += x;
+        sum_ -= ring_[pos_];
+        ring_[pos_] = x;
+        pos_ = (pos_ + 1 == N) ? 0 : pos_ + 1;
+        return value();
+    }
+    uint16_t value() const { return (uint16_t)((sum_ + N / 2) / N); }
+    void reset(uint16_t x) {
+        for (uint8_t i = 0; i < N; ++i) ring_[i] = x;
+        sum_ = (uint32_t)x * N;
+        pos_ = 0;
+        primed_ = true;
+    }
+
+private:
+    uint16_t ring_[N];
+    uint32_t sum_ = 0;
+    uint8_t pos_ = 0;
+    bool primed_ = false;
+};
+
+// Median of the last K samples, K odd. Rejects single-sample spikes
+// (K = 3) or bursts up to K/2 samples long, at the cost of K/2 samples delay.
+template<uint8_t K>
+class MedianFilter {
+    static_assert(K % 2 == 1 && K <= 9, "MedianFilter needs an odd window of at most 9");
+
+public:
+    explicit MedianFilter(uint8_t = 0) {} // window is K, the runtime length is ignored
+
+    uint16_t update(uint16_t x) {
+        if (!primed_) {
+            reset(x);
+            return x;
+        }
+        ring_[pos_] = x;
+        pos_ = (pos_ + 1 == K) ? 0 : pos_ + 1;
+
+        // insertion sort of a copy, fixed K so this is a bounded handful of compares
+        uint16_t s[K];
+        for (uint8_t i = 0; i < K; ++i) {
+            uint16_t v = ring_[i];
+            uint8_t j = i;
+            for (; j > 0 && s[j - 1] > v; --j) s[j] = s[j - 1];
+            s[j] = v;
+        }
+        value_ = s[K / 2];
+        return value_;
+    }
+    uint16_t value() const { return value_; }
+    void reset(uint16_t x) {
+        for (uint8_t i = 0; i < K; ++i) ring_[i] = x;
+        value_ = x;
+        pos_ = 0;
+        primed_ = true;
+    }
+
+private:
+    uint16_t ring_[K];
+    uint16_t value_ = 0;
+    uint8_t pos_ = 0;
+    bool primed_ = false;
+};
@@ -0,0 +1,80 @@
+#include "TouchSampler.h"
+#include <LoggingBase.h>
+
+TouchSampler::TouchSampler(TouchSensorBank& bank)
+    : bank_(bank)
+{
+}
+
+TouchSampler::~TouchSampler() {
+    stop();
+}
+
+bool TouchSampler::start(uint32_t periodMs, UBaseType_t priority, BaseType_t core) {
+    if (isRunning()) {
+        return true;
+    }
+    periodTicks_ = pdMS_TO_TICKS(periodMs);
+    if (periodTicks_ == 0) {
+        periodTicks_ = 1;
+    }
+    Frame stale;
+    while (ring_.pop(stale)) {
+    }
+
+    running_.store(true, std::memory_order_release);
+    taskAlive_.store(true, std::memory_order_release);
+    bank_.sampler_ = this;
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        &_task,
+        "TouchSampler",
+        2*1024,
+        this,
+        priority,
+        &task_,
+        core
+    );
+    if (ok != pdPASS) {
+        gLogger->println("Failed to create TouchSampler task");
+        bank_.sampler_ = nullptr;
+        running_.store(false, std::memory_order_release);
+        taskAlive_.store(false, std::memory_order_release);
+        return false;
+    }
+    return true;
+}
+
+void TouchSampler::stop() {
+    if (!isRunning()) {
+        return;
+    }
+    running_.store(false, std::memory_order_release);
+    while (taskAlive_.load(std::memory_order_acquire)) {
+        vTaskDelay(1);
+    }
+    task_ = nullptr;
+    bank_.sampler_ = nullptr; // back to polled reads in update()
+}
+
+void TouchSampler::_task(void* pvParameters) {
+    auto self = static_cast<TouchSampler*>(pvParameters);
+    TickType_t lastWake = xTaskGetTickCount();
+
+    while (self->running_.load(std::memory_order_acquire)) {
+        vTaskDelayUntil(&lastWake, self->periodTicks_);
+
+        Frame frame;
+        frame.tick = xTaskGetTickCount();
+        TickType_t late = frame.tick - lastWake;
+        if (late > self->maxLate_.load(std::memory_order_relaxed)) {
+            self->maxLate_.store(late, std::memory_order_relaxed);
+        }
+        self->bank_.acquire(frame.input);
+        self->samples_.fetch_add(1, std::memory_order_relaxed);
+        if (!self->ring_.push(frame)) {
+            self->dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    self->taskAlive_.store(false, std::memory_order_release);
+    vTaskDelete(NULL);
+}
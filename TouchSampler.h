@@ -0,0 +1,48 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "SpscRing.h"
+#include "TouchSensorBank.h"
+
+// Reads all pads of a TouchSensorBank at a fixed rate on its own task
+// (vTaskDelayUntil, so the rate does not depend on how often loop() runs)
+// and hands the frames to bank.update() through a lock-free ring.
+// The main loop then never waits for the touch peripheral. Standalone
+// TouchSensors are not covered, their update() still calls touchRead().
+class TouchSampler {
+public:
+    struct Frame {
+        TickType_t tick;
+        uint16_t input[TouchSensorBank::maxPads];
+    };
+    static constexpr uint32_t ringSize = 32; // frames, 320 ms at the default rate
+
+    explicit TouchSampler(TouchSensorBank& bank);
+    ~TouchSampler();
+
+    bool start(uint32_t periodMs = 10, UBaseType_t priority = tskIDLE_PRIORITY + 2, BaseType_t core = 0);
+    void stop(); // blocks until the task has exited
+    bool isRunning() const { return taskAlive_.load(std::memory_order_acquire); }
+
+    // consumer side, used by TouchSensorBank::update()
+    bool pop(Frame& out) { return ring_.pop(out); }
+
+    uint32_t samples() const { return samples_.load(std::memory_order_relaxed); }
+    // frames lost because update() did not drain the ring in time
+    uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    // worst wake-up delay behind the fixed schedule, in ticks
+    TickType_t maxLateTicks() const { return maxLate_.load(std::memory_order_relaxed); }
+
+private:
+    static void _task(void* pvParameters);
+
+    TouchSensorBank& bank_;
+    SpscRing<Frame, ringSize> ring_;
+    TickType_t periodTicks_ = 0;
+    TaskHandle_t task_ = nullptr;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> taskAlive_{false};
+    std::atomic<uint32_t> samples_{0};
+    std::atomic<uint32_t> dropped_{0};
+    std::atomic<TickType_t> maxLate_{0};
+};
@@ -1,65 +1,108 @@
 #include "TouchSensor.h"
+#include "TouchSensorBank.h"
 #include "driver/touch_pad.h"
 #include "threadSafeArduino.h"
+#include "DvfsGovernor.h"
+#include "Metrics.h"
 
-TouchSensor::TouchSensor(uint8_t pin, uint16_t threshold, uint16_t hysteresis,  uint8_t samples, uint8_t nMovingAvg,
+static Counter& pressesMetric = metrics().counter("touch.presses");
+
+template<typename Filter>
+BasicTouchSensor<Filter>::BasicTouchSensor(uint8_t pin, uint16_t threshold, uint16_t hysteresis,  uint8_t samples, uint8_t nMovingAvg,
 int referencePin)
     : pin_(pin), threshold_(threshold), hysteresis_(hysteresis), state_(false), 
-    lastValue_(0), samples_(samples), nMovingAvg_(nMovingAvg), referencePin_(referencePin)
+    filter_(nMovingAvg), samples_(samples), referencePin_(referencePin)
+{
+}
+
+template<typename Filter>
+void BasicTouchSensor<Filter>::attach(TouchSensorBank& bank, uint8_t pin, uint16_t threshold, uint16_t hysteresis, uint8_t samples,
+uint8_t nMovingAvg, int referencePin)
 {
+    channel_ = bank.add(pin, threshold, hysteresis, samples, nMovingAvg, referencePin);
+    if (channel_ >= 0)
+        bank_ = &bank; // otherwise the bank is full, fall back to reading ourselves
 }
 
-void TouchSensor::update() {
+template<typename Filter>
+void BasicTouchSensor<Filter>::update() {
+    if (bank_)
+        return; // bank.update() covers us
     auto thisvalue = threadSafe::touchRead(pin_);
     if(referencePin_ >= 0) {
         uint32_t referenceValue = threadSafe::touchRead(referencePin_);
         // add a simple fixed offset to keep things uint16_t and avoid underflow
         thisvalue = ((uint32_t)thisvalue + 10000) - referenceValue;
     }
-    if(thisvalue == lastValue_)
-        return; // no change => do nothing we might be calling over sampling frequency
-    
-    //use nMovingAvg_ if >0
-    uint16_t n = nMovingAvg_;
-    lastValue_ = (n * lastValue_ + thisvalue) / (n + 1);
+    uint16_t value = filter_.update(thisvalue);
 
     if (state_) {
-        if (lastValue_ < (threshold_ - hysteresis_) && sampleCount > 0) {
+        if (value < (threshold_ - hysteresis_) && sampleCount > 0) {
             sampleCount--;
         }
     } else {
-        if (lastValue_ > (threshold_ + hysteresis_) && sampleCount < samples_) {
+        if (value > (threshold_ + hysteresis_) && sampleCount < samples_) {
             sampleCount++;
         }
     }
 
     if (sampleCount >= samples_) {
+        if (!state_) {
+            dvfsBoost(touchBoostMs); // whatever reacts to the touch should not wait for the clock
+            pressesMetric.add();
+            metrics().event(MetricEvent::TouchPress, pin_);
+        }
         state_ = true;
     } else if (sampleCount == 0) {
         state_ = false;
     }
 }
 
-bool TouchSensor::isActive() const {
+template<typename Filter>
+bool BasicTouchSensor<Filter>::isActive() const {
+    if (bank_)
+        return bank_->isActive(channel_);
     return state_;
 }
 
-void TouchSensor::setThreshold(uint16_t threshold) {
+template<typename Filter>
+void BasicTouchSensor<Filter>::setThreshold(uint16_t threshold) {
     threshold_ = threshold;
+    if (bank_)
+        bank_->setThreshold(channel_, threshold);
 }
 
-void TouchSensor::setHysteresis(uint16_t hysteresis) {
+template<typename Filter>
+void BasicTouchSensor<Filter>::setHysteresis(uint16_t hysteresis) {
     hysteresis_ = hysteresis;
+    if (bank_)
+        bank_->setHysteresis(channel_, hysteresis);
 }
 
-uint16_t TouchSensor::threshold() const {
+template<typename Filter>
+uint16_t BasicTouchSensor<Filter>::threshold() const {
+    if (bank_)
+        return bank_->threshold(channel_);
     return threshold_;
 }
 
-uint16_t TouchSensor::hysteresis() const {
+template<typename Filter>
+uint16_t BasicTouchSensor<Filter>::hysteresis() const {
+    if (bank_)
+        return bank_->hysteresis(channel_);
     return hysteresis_;
 }
 
-uint16_t TouchSensor::lastValue() const {
-    return lastValue_;
-}
\ No newline at end of file
+template<typename Filter>
+uint16_t BasicTouchSensor<Filter>::lastValue() const {
+    if (bank_)
+        return bank_->lastValue(channel_);
+    return filter_.value();
+}
+
+template class BasicTouchSensor<EmaFilter>;
+template class BasicTouchSensor<BoxcarFilter<4>>;
+template class BasicTouchSensor<BoxcarFilter<8>>;
+template class BasicTouchSensor<BoxcarFilter<16>>;
+template class BasicTouchSensor<MedianFilter<3>>;
+template class BasicTouchSensor<MedianFilter<5>>;
@@ -1,12 +1,37 @@
 #pragma once
 #include <Arduino.h>
+#include <type_traits>
+#include "TouchFilters.h"
 
-class TouchSensor {
+class TouchSensorBank;
+
+// full clock for this long after a pad becomes active (see dvfsBoost)
+static constexpr uint32_t touchBoostMs = 200;
+
+// Filter: smoothing stage from TouchFilters.h. nMovingAvg configures EmaFilter,
+// the window of BoxcarFilter/MedianFilter is their template argument.
+// Instantiated in TouchSensor.cpp for the filters listed there.
+template<typename Filter = EmaFilter>
+class BasicTouchSensor {
 public:
-    TouchSensor(uint8_t pin, uint16_t threshold, uint16_t hysteresis = 200, uint8_t samples = 3, uint8_t nMovingAvg = 0,
+    BasicTouchSensor(uint8_t pin, uint16_t threshold, uint16_t hysteresis = 200, uint8_t samples = 3, uint8_t nMovingAvg = 0,
     int referencePin=-1);
+    // view onto a channel of the bank: the bank does the reading and filtering
+    // (always its EMA with nMovingAvg), call bank.update() once per loop instead
+    // of update() on every sensor. Only for TouchSensor, the bank has no other filters.
+    template<typename F = Filter>
+    BasicTouchSensor(TouchSensorBank& bank, uint8_t pin, uint16_t threshold, uint16_t hysteresis = 200, uint8_t samples = 3,
+    uint8_t nMovingAvg = 0, int referencePin=-1)
+        : BasicTouchSensor(pin, threshold, hysteresis, samples, nMovingAvg, referencePin) {
+        static_assert(std::is_same<F, EmaFilter>::value,
+                      "TouchSensorBank filters with its EmaFilter, a bank view must be a TouchSensor");
+        attach(bank, pin, threshold, hysteresis, samples, nMovingAvg, referencePin);
+    }
 
-    void update();  // Call this in loop()
+    // Call this in loop(); does nothing for a bank view. A standalone sensor reads
+    // the pad right here, touchRead() blocking the caller for the measurement;
+    // only a TouchSensorBank with a TouchSampler is sampled off the caller's task.
+    void update();
     bool isActive() const;
 
     void begin() {
@@ -21,13 +46,19 @@ public:
     uint16_t lastValue() const;
 
 private:
+    void attach(TouchSensorBank& bank, uint8_t pin, uint16_t threshold, uint16_t hysteresis, uint8_t samples,
+                uint8_t nMovingAvg, int referencePin);
+
     uint8_t pin_;
     uint16_t threshold_;
     uint16_t hysteresis_;
     bool state_;
-    uint16_t lastValue_;
+    Filter filter_;
     uint8_t samples_;
     uint8_t sampleCount = 0;
-    uint8_t nMovingAvg_;
     int referencePin_;
-};
\ No newline at end of file
+    TouchSensorBank* bank_ = nullptr;
+    int channel_ = -1;
+};
+
+using TouchSensor = BasicTouchSensor<EmaFilter>;
@@ -0,0 +1,120 @@
+#include "TouchSensorBank.h"
+#include "TouchSampler.h"
+#include "TouchSensor.h"
+#include "DvfsGovernor.h"
+#include "driver/touch_pad.h"
+#include "threadSafeArduino.h"
+#include <LoggingBase.h>
+#include "Metrics.h"
+
+static Counter& pressesMetric = metrics().counter("touch.presses"); // shared with TouchSensor
+
+int TouchSensorBank::add(uint8_t pin, uint16_t threshold, uint16_t hysteresis, uint8_t samples, uint8_t nMovingAvg,
+                         int referencePin) {
+    if (count_ >= maxPads) {
+        gLogger->println("[TouchSensorBank] Too many pads.");
+        return -1;
+    }
+    uint8_t ch = count_;
+
+    uint8_t slot = noReference;
+    if (referencePin >= 0) {
+        for (uint8_t r = 0; r < refCount_; ++r) {
+            if (refPins_[r] == referencePin) {
+                slot = r;
+                break;
+            }
+        }
+        if (slot == noReference) {
+            slot = refCount_;
+            refPins_[refCount_] = (uint8_t)referencePin;
+            refCount_++;
+        }
+    }
+
+    pins_[ch] = pin;
+    refSlot_[ch] = slot;
+    threshold_[ch] = threshold;
+    hysteresis_[ch] = hysteresis;
+    samples_[ch] = samples;
+    alpha_[ch] = EmaFilter::alphaFor(nMovingAvg);
+    ema_[ch] = 0;
+    primed_[ch] = 0;
+    sampleCount_[ch] = 0;
+    state_[ch] = 0;
+    count_++;
+    return ch;
+}
+
+void TouchSensorBank::update() {
+    if (sampler_) {
+        // fixed-rate frames from the sampler task, oldest first
+        TouchSampler::Frame frame;
+        while (sampler_->pop(frame)) {
+            filter(frame.input);
+        }
+        return;
+    }
+    uint16_t input[maxPads];
+    acquire(input);
+    filter(input);
+}
+
+void TouchSensorBank::acquire(uint16_t* out) const {
+    // the touch peripheral is the slow part, read each pad once
+    uint16_t refRaw[maxPads];
+    for (uint8_t r = 0; r < refCount_; ++r) {
+        refRaw[r] = threadSafe::touchRead(refPins_[r]);
+    }
+    for (uint8_t i = 0; i < count_; ++i) {
+        uint16_t raw = threadSafe::touchRead(pins_[i]);
+        if (refSlot_[i] != noReference) {
+            // add a simple fixed offset to keep things uint16_t and avoid underflow
+            raw = ((uint32_t)raw + 10000) - refRaw[refSlot_[i]];
+        }
+        out[i] = raw;
+    }
+}
+
+void TouchSensorBank::filter(const uint16_t* input) {
+    // same rules as TouchSensor::update(), written as selects instead of branches
+    for (uint8_t i = 0; i < count_; ++i) {
+        uint32_t ema = primed_[i] ? EmaFilter::step(ema_[i], input[i], alpha_[i]) : (uint32_t)input[i] << 16;
+        int32_t v = EmaFilter::round(ema);
+
+        int32_t thr = threshold_[i];
+        int32_t hyst = hysteresis_[i];
+        int32_t count = sampleCount_[i];
+        int32_t samples = samples_[i];
+        int32_t state = state_[i];
+
+        int32_t dec = state & (v < thr - hyst) & (count > 0);
+        int32_t inc = !state & (v > thr + hyst) & (count < samples);
+        count += inc - dec;
+
+        int32_t on = count >= samples;
+        int32_t off = count == 0;
+        state = on | (state & !off);
+
+        ema_[i] = ema;
+        primed_[i] = 1;
+        sampleCount_[i] = (uint8_t)count;
+        state_[i] = (uint8_t)state;
+    }
+
+    uint16_t mask = 0;
+    for (uint8_t i = 0; i < count_; ++i) {
+        mask |= (uint16_t)(state_[i] << i);
+    }
+    uint16_t rising = mask & ~activeMask_;
+    if (rising) {
+        dvfsBoost(touchBoostMs); // a pad just became active
+        for (uint8_t i = 0; i < count_; ++i) {
+            if ((rising >> i) & 1) {
+                pressesMetric.add();
+                metrics().event(MetricEvent::TouchPress, pins_[i]);
+            }
+        }
+    }
+    activeMask_ = mask;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <Arduino.h>
+#include "TouchFilters.h"
+
+// All touch pads of a device in one place. update() reads every pad and every
+// distinct reference pad exactly once, then runs the fixed-point EMA (EmaFilter), hysteresis
+// and debounce of all channels in one pass over structure-of-arrays buffers
+// (no per-channel branches, so the compiler can vectorize it).
+// TouchSensor can be constructed as a view onto one channel of a bank.
+// With a running TouchSampler, update() only drains the sampled frames and
+// never touches the peripheral itself.
+class TouchSampler;
+
+class TouchSensorBank {
+public:
+    static constexpr uint8_t maxPads = 16; // activeMask() has one bit per channel
+
+    TouchSensorBank() = default;
+
+    // returns the channel index, or -1 if the bank is full.
+    // Add all pads before starting a TouchSampler on the bank.
+    int add(uint8_t pin, uint16_t threshold, uint16_t hysteresis = 200, uint8_t samples = 3, uint8_t nMovingAvg = 0,
+            int referencePin = -1);
+
+    void update();  // Call this in loop(), once for all pads; single consumer if sampled
+
+    uint8_t size() const { return count_; }
+    uint16_t activeMask() const { return activeMask_; } // bit n set = channel n active
+    bool isActive(uint8_t channel) const { return (activeMask_ >> channel) & 1; }
+
+    void setThreshold(uint8_t channel, uint16_t threshold) { threshold_[channel] = threshold; }
+    void setHysteresis(uint8_t channel, uint16_t hysteresis) { hysteresis_[channel] = hysteresis; }
+    uint16_t threshold(uint8_t channel) const { return threshold_[channel]; }
+    uint16_t hysteresis(uint8_t channel) const { return hysteresis_[channel]; }
+    uint16_t lastValue(uint8_t channel) const { return EmaFilter::round(ema_[channel]); }
+    uint8_t pin(uint8_t channel) const { return pins_[channel]; }
+
+private:
+    friend class TouchSampler;
+    static constexpr uint8_t noReference = 0xFF;
+
+    // reads all pads into out[0..size()), reference compensated; only reads configuration
+    void acquire(uint16_t* out) const;
+    void filter(const uint16_t* input);
+
+    uint8_t count_ = 0;
+
+    // configuration
+    uint8_t pins_[maxPads];
+    uint8_t refSlot_[maxPads];   // index into refPins_, or noReference
+    uint16_t threshold_[maxPads];
+    uint16_t hysteresis_[maxPads];
+    uint8_t samples_[maxPads];
+    uint32_t alpha_[maxPads];     // EmaFilter::alphaFor(nMovingAvg)
+
+    // distinct reference pads, each read once per cycle
+    uint8_t refPins_[maxPads];
+    uint8_t refCount_ = 0;
+
+    TouchSampler* sampler_ = nullptr; // set while a sampler task feeds us
+
+    // filter state
+    uint32_t ema_[maxPads];       // 16.16 fixed point
+    uint8_t primed_[maxPads];
+    uint8_t sampleCount_[maxPads];
+    uint8_t state_[maxPads];
+    uint16_t activeMask_ = 0;
+};
@@ -1,6 +1,9 @@
 #include "WiFiWrapper.h"
 #include <LoggingBase.h>
 #include "esp_task_wdt.h"  
+#include "DvfsGovernor.h"
+#include "Metrics.h"
+#include "DeferredLog.h"
 
 
 static WiFiWrapper* instance = nullptr;
@@ -15,15 +18,27 @@ struct LockGuard {
     }
   };
 
-static void wifiStatusComplete(void* arg) {
-    vTaskDelay(pdMS_TO_TICKS(10));  // wait 10ms for hardware to adjust
-    instance->_setStateReady(true);
-    vTaskDelete(NULL);  
+// telemetry, see Metrics.h
+static Counter& connectsMetric = metrics().counter("wifi.connects");
+static Counter& connectFailuresMetric = metrics().counter("wifi.connect_failures");
+static Counter& lostMetric = metrics().counter("wifi.lost");
+static Counter& roamsMetric = metrics().counter("wifi.roams");
+static Counter& powerModeMetric = metrics().counter("wifi.power_mode_changes");
+static Histogram& connectMsMetric = metrics().histogram("wifi.connect_ms");
+// driver's disconnect/lost-IP event, or without one the last poll that saw the link up, until
+// linkDown() handled it; the driver's own beacon timeout before the event is not included
+static Histogram& detectMsMetric = metrics().histogram("wifi.detect_ms");
+static Histogram& recoverMsMetric = metrics().histogram("wifi.recover_ms"); // loss noticed until connected again
+static Gauge& rssiMetric = metrics().gauge("wifi.rssi");
+
+// esp_timer task, powerSettleMs after a power mode change: the hardware has adjusted
+void WiFiWrapper::powerSettled(void* arg) {
+    static_cast<WiFiWrapper*>(arg)->_setStateReady(true);
 }
 
 
 WiFiWrapper::WiFiWrapper(const char* ssid, const char* password)
-: ssid(ssid), password(password) {
+: ssid(ssid), password(password), scanner(ssid) {
     if (instance != nullptr) {
         gLogger->println("WiFiWrapper instance already exists. Only one instance is allowed.");
         abort();
@@ -31,83 +46,62 @@ WiFiWrapper::WiFiWrapper(const char* ssid, const char* password)
     instance = this;
     autoSleep = true;
     alwaysOn = false;
-    stateReady = true;
     stateMutex = xSemaphoreCreateMutex();
     if (stateMutex == nullptr) {
         gLogger->println("WiFiWrapper: Failed to create mutex");
         abort();
     }
+    powerEvents = xEventGroupCreate();
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = &powerSettled;
+    timerArgs.arg = this;
+    timerArgs.dispatch_method = ESP_TIMER_TASK;
+    timerArgs.name = "WiFiSettle";
+    if (powerEvents == nullptr || esp_timer_create(&timerArgs, &settleTimer) != ESP_OK) {
+        gLogger->println("WiFiWrapper: Failed to create power settle timer");
+        abort();
+    }
+    _setStateReady(true);
+    Status s = {};
+    s.status = WL_IDLE_STATUS;
+    s.rssi = -127;
+    s.hostname[0] = '-';
+    status_.store(s);
 }
 
-WiFiWrapper::APChoice WiFiWrapper::findBestAPForSSID(bool locked) {
-    LockGuard lg(locked ? stateMutex : nullptr);
-
-    APChoice best;
-
-    gLogger->println("[WiFiWrapper] Scanning for APs with configured SSID...");
-
-    // Synchronous scan.
-    // second argument true = include hidden networks. Harmless for normal SSIDs.
-    int n = WiFi.scanNetworks(false, true);
-
-    if (n <= 0) {
-        gLogger->println("[WiFiWrapper] No WiFi networks found during scan.");
-        WiFi.scanDelete();
-        return best;
+WiFiWrapper::~WiFiWrapper() {
+    if (eventHandlerId) {
+        WiFi.removeEvent(eventHandlerId);
     }
-
-    String targetSSID(ssid);
-
-    for (int i = 0; i < n; ++i) {
-        if (WiFi.SSID(i) != targetSSID) {
-            continue;
-        }
-
-        const uint8_t* bssidPtr = WiFi.BSSID(i);
-        if (!bssidPtr) {
-            continue;
-        }
-
-        int32_t rssi = WiFi.RSSI(i);
-        int32_t channel = WiFi.channel(i);
-
-        gLogger->print("[WiFiWrapper] Candidate ");
-        gLogger->print(WiFi.BSSIDstr(i));
-        gLogger->print(" ch=");
-        gLogger->print(channel);
-        gLogger->print(" RSSI=");
-        gLogger->println(rssi);
-
-        if (!best.valid || rssi > best.rssi) {
-            best.valid = true;
-            best.rssi = rssi;
-            best.channel = channel;
-            memcpy(best.bssid, bssidPtr, 6);
-        }
+    if (settleTimer) {
+        esp_timer_stop(settleTimer); // fails harmlessly if it is not running
+        esp_timer_delete(settleTimer);
     }
+    if (powerEvents) {
+        vEventGroupDelete(powerEvents);
+    }
+    if (stateMutex) {
+        vSemaphoreDelete(stateMutex);
+    }
+    if (instance == this) {
+        instance = nullptr; // allows re-creating it, e.g. a simulated reboot on the host
+    }
+}
 
-    WiFi.scanDelete();
-
-    if (!best.valid) {
-        gLogger->println("[WiFiWrapper] No AP found for configured SSID.");
+WiFiWrapper::APChoice WiFiWrapper::bestCachedAP(uint32_t now, uint32_t maxAge) {
+    APChoice best;
+    APCandidate c;
+    if (!scanner.best(c, now, maxAge)) {
         return best;
     }
+    best.valid = true;
+    best.rssi = c.rssi;
+    best.channel = c.channel;
+    memcpy(best.bssid, c.bssid, 6);
 
-    char bssidStr[18];
-    snprintf(
-        bssidStr,
-        sizeof(bssidStr),
-        "%02X:%02X:%02X:%02X:%02X:%02X",
-        best.bssid[0], best.bssid[1], best.bssid[2],
-        best.bssid[3], best.bssid[4], best.bssid[5]
-    );
-
-    gLogger->print("[WiFiWrapper] Best AP: ");
-    gLogger->print(bssidStr);
-    gLogger->print(" ch=");
-    gLogger->print(best.channel);
-    gLogger->print(" RSSI=");
-    gLogger->println(best.rssi);
+    deferredLog().log("[WiFiWrapper] Best AP: %02X:%02X:%02X:%02X:%02X:%02X ch=%d RSSI=%d seen %u ms ago",
+                      best.bssid[0], best.bssid[1], best.bssid[2], best.bssid[3], best.bssid[4], best.bssid[5],
+                      best.channel, best.rssi, now - c.lastSeen);
 
     return best;
 }
@@ -120,73 +114,55 @@ bool WiFiWrapper::connectToSpecificAP(const APChoice& ap, bool locked) {
         return false;
     }
 
-    gLogger->println("[WiFiWrapper] Connecting to selected BSSID...");
-
-    WiFi.disconnect(false, false);
-    vTaskDelay(pdMS_TO_TICKS(200));
-
-    WiFi.begin(ssid, password, ap.channel, ap.bssid);
-
-    gLogger->print("[WiFiWrapper] Connecting");
-    int attempt = 0;
-    while (WiFi.status() != WL_CONNECTED && attempt < 30) {
-        gLogger->print(".");
-        esp_task_wdt_reset();
-        vTaskDelay(pdMS_TO_TICKS(200));
-        attempt++;
-    }
-
-    if (WiFi.status() != WL_CONNECTED) {
-        gLogger->println("\n[WiFiWrapper] BSSID-pinned connection failed.");
-        return false;
-    }
-
-    gLogger->print("\n[WiFiWrapper] Connected to selected AP. IP: ");
-    gLogger->println(WiFi.localIP().toString());
-
-    gLogger->print("[WiFiWrapper] Connected BSSID: ");
-    gLogger->println(WiFi.BSSIDstr());
-
-    gLogger->print("[WiFiWrapper] RSSI: ");
-    gLogger->println(WiFi.RSSI());
-
+    deferredLog().log("[WiFiWrapper] Connecting to selected BSSID...");
+    connPath = ConnectPath::Roam;
+    connAttemptStartedAt = millis();
+    startAssociation(ap, connAttemptStartedAt);
     return true;
 }
 
 
-bool WiFiWrapper::connectToBestAvailableAP(bool locked) {
+// only starts a background scan of the known channels, finishRoamCheck() decides
+bool WiFiWrapper::maybeRoamToBetterAP(bool locked) {
     LockGuard lg(locked ? stateMutex : nullptr);
 
-    APChoice best = findBestAPForSSID(false);
-
-    if (!best.valid) {
+    if (WiFi.status() != WL_CONNECTED || isConnecting()) {
         return false;
     }
 
-    return connectToSpecificAP(best, false);
-}
-
-
-bool WiFiWrapper::maybeRoamToBetterAP(bool locked) {
-    LockGuard lg(locked ? stateMutex : nullptr);
+    int32_t currentRSSI = WiFi.RSSI();
 
-    if (WiFi.status() != WL_CONNECTED) {
+    if (currentRSSI > roamScanThreshold) {
         return false;
     }
 
-    int32_t currentRSSI = WiFi.RSSI();
+    deferredLog().log("[WiFiWrapper] Current RSSI is weak: %d", currentRSSI);
 
-    if (currentRSSI > roamScanThreshold) {
+    // known channels only, unless the last full scan is long ago (APs may have moved)
+    bool restrict = millis() - scanner.lastFullScanFinishedAt() < fullRescanInterval;
+    if (!scanner.start(restrict)) {
         return false;
     }
+    roamScanPending = true;
+    return true;
+}
 
-    gLogger->print("[WiFiWrapper] Current RSSI is weak: ");
-    gLogger->println(currentRSSI);
+void WiFiWrapper::finishRoamCheck(uint32_t now) {
+    if (!scanner.poll(now) && scanner.isScanning()) {
+        return;
+    }
+    roamScanPending = false;
 
-    APChoice best = findBestAPForSSID(false);
+    if (WiFi.status() != WL_CONNECTED) {
+        return;
+    }
+    int32_t currentRSSI = WiFi.RSSI();
+    rssiMetric.set(currentRSSI);
+
+    APChoice best = bestCachedAP(now, roamCheckInterval);
 
     if (!best.valid) {
-        return false;
+        return;
     }
 
     bool candidateClearlyBetter =
@@ -196,110 +172,448 @@ bool WiFiWrapper::maybeRoamToBetterAP(bool locked) {
         currentRSSI < -75 && best.rssi > -68;
 
     if (!candidateClearlyBetter && !currentVeryBadAndCandidateGood) {
-        gLogger->println("[WiFiWrapper] No sufficiently better AP found. Staying connected.");
-        return false;
+        deferredLog().log("[WiFiWrapper] No sufficiently better AP found. Staying connected.");
+        return;
     }
 
-    gLogger->print("[WiFiWrapper] Roaming from RSSI ");
-    gLogger->print(currentRSSI);
-    gLogger->print(" to candidate RSSI ");
-    gLogger->println(best.rssi);
+    roamsMetric.add();
+    metrics().event(MetricEvent::WifiRoam, best.rssi);
+    deferredLog().log("[WiFiWrapper] Roaming from RSSI %d to candidate RSSI %d", currentRSSI, best.rssi);
 
-    return connectToSpecificAP(best, false);
+    connectToSpecificAP(best, false);
 }
 
-void WiFiWrapper::begin(bool connectToNetwork, bool lowPowerMode, bool locked) {
-    LockGuard lg(locked ? stateMutex : nullptr);
-    gLogger->println("Initializing WiFi...");
-    WiFi.mode(WIFI_STA);
-    WiFi.persistent(false);
+// ===========================
+// Connection state machine
+// ===========================
+
+const char* WiFiWrapper::connectionStateName(ConnectionState state) {
+    switch (state) {
+        case ConnectionState::Idle:        return "Idle";
+        case ConnectionState::Scanning:    return "Scanning";
+        case ConnectionState::Associating: return "Associating";
+        case ConnectionState::DHCP:        return "DHCP";
+        case ConnectionState::Connected:   return "Connected";
+        case ConnectionState::Failed:      return "Failed";
+    }
+    return "?";
+}
 
-    if (connectToNetwork)
-        connect(false);
+void WiFiWrapper::setConnectionState(ConnectionState state, uint32_t now) {
+    connState.store(state, std::memory_order_release);
+    connStateEnteredAt = now;
+}
 
-    if (lowPowerMode)
-        configureLowPowerMode(false); 
-    else
-        configureFullPowerMode(false);
+bool WiFiWrapper::isConnecting() const {
+    ConnectionState state = getConnectionState();
+    return state == ConnectionState::Scanning ||
+           state == ConnectionState::Associating ||
+           state == ConnectionState::DHCP;
+}
 
-    sleepTimerStartedAt  = millis();
-    lastReconnectAttempt = millis();
-    lastRoamCheck        = millis();
+void WiFiWrapper::onConnectionStateChange(ConnectionStateCallback callback, void* arg) {
+    LockGuard lg(stateMutex);
+    connStateCallback = callback;
+    connStateCallbackArg = arg;
 }
 
-void WiFiWrapper::resume(bool locked) {
-    if (stateReady.load(std::memory_order_acquire)) {
-        gLogger->println("WiFiWrapper::resume() called, but state not ready. Ignoring resume.");
-        return;
+// leaving a live association needs disconnectSettleTime before WiFi.begin(), that is
+// issued by advanceConnection(); with no link up it goes out right away
+void WiFiWrapper::startAssociation(const APChoice& ap, uint32_t now) {
+    connTarget = ap;
+    connBeginIssued = false;
+    bool associated = WiFi.status() == WL_CONNECTED;
+    WiFi.disconnect(false, false);
+    setConnectionState(ConnectionState::Associating, now);
+    if (!associated) {
+        issueBegin(now);
     }
-    begin(locked);
 }
 
-bool WiFiWrapper::connect(bool locked) {
+void WiFiWrapper::issueBegin(uint32_t now) {
+    if (connTarget.valid) {
+        WiFi.begin(ssid, password, connTarget.channel, connTarget.bssid);
+    } else {
+        WiFi.begin(ssid, password);
+    }
+    connBeginIssued = true;
+    connBeginFailed = false;
+    connStateEnteredAt = now; // connectTimeout counts from here
+}
+
+void WiFiWrapper::startConnect(bool locked) {
     LockGuard lg(locked ? stateMutex : nullptr);
 
     wifiShouldBeConnected = true;
+    if (isConnecting()) {
+        return; // already on its way
+    }
 
-    bool connected = connectToBestAvailableAP(false);
+    uint32_t now = millis();
+    connAttemptStartedAt = now;
+    roamScanPending = false;
+
+    // recent scan results are good enough to go straight to association
+    APChoice cached = bestCachedAP(now, candidateMaxAge);
+    if (cached.valid) {
+        dropStaticLease(); // a cached lease is only tried on the fast path
+        deferredLog().log("[WiFiWrapper] Connecting to cached BSSID...");
+        connPath = ConnectPath::MemoryCache;
+        startAssociation(cached, now);
+        return;
+    }
 
-    if (connected) {
-        return true;
+    // fast path after deep sleep / reboot: the AP we were last connected to
+    PersistedAP persisted = {};
+    if (usePersistedAP && APCache::load(ssid, persisted)) {
+        APChoice ap;
+        ap.valid = true;
+        ap.rssi = persisted.rssi;
+        ap.channel = persisted.channel;
+        memcpy(ap.bssid, persisted.bssid, 6);
+        deferredLog().log("[WiFiWrapper] Fast path: connecting to persisted BSSID on ch=%d", ap.channel);
+        if (reuseCachedLease && persisted.ip && persisted.leaseUses < maxLeaseReuses) {
+            WiFi.config(IPAddress(persisted.ip), IPAddress(persisted.gateway),
+                        IPAddress(persisted.subnet), IPAddress(persisted.dns));
+            staticLeaseApplied = true;
+        } else {
+            dropStaticLease(); // too old or unknown age: let DHCP confirm or replace it
+        }
+        connPath = ConnectPath::Persisted;
+        startAssociation(ap, now);
+        return;
     }
 
-    gLogger->println("[WiFiWrapper] Best-AP connection failed. Falling back to normal WiFi.begin().");
+    dropStaticLease();
+    deferredLog().log("[WiFiWrapper] Scanning for APs with configured SSID...");
+    // asynchronous scan, results are picked up in advanceConnection()
+    if (!scanner.start(false)) {
+        deferredLog().log("[WiFiWrapper] Scan could not be started. Falling back to normal WiFi.begin().");
+        connPath = ConnectPath::Fallback;
+        startAssociation(APChoice(), now);
+        return;
+    }
+    connPath = ConnectPath::Scan;
+    setConnectionState(ConnectionState::Scanning, now);
+}
 
-    WiFi.begin(ssid, password);
+// one non-blocking step, stateMutex must be held
+void WiFiWrapper::advanceConnection(uint32_t now) {
+    switch (getConnectionState()) {
+        case ConnectionState::Scanning: {
+            bool done = scanner.poll(now);
+            if (!done && now - connStateEnteredAt < scanTimeout) {
+                return;
+            }
+            if (!done) {
+                scanner.abort();
+            }
+            APChoice best = bestCachedAP(now, candidateMaxAge);
+            if (!best.valid) {
+                connPath = ConnectPath::Fallback;
+                deferredLog().log("[WiFiWrapper] Best-AP connection failed. Falling back to normal WiFi.begin().");
+            } else {
+                deferredLog().log("[WiFiWrapper] Connecting to selected BSSID...");
+            }
+            startAssociation(best, now);
+            return;
+        }
 
-    gLogger->print("Connecting to WiFi");
-    int attempt = 0;
-    while (WiFi.status() != WL_CONNECTED && attempt < 30) {
-        gLogger->print(".");
-        esp_task_wdt_reset();
-        vTaskDelay(pdMS_TO_TICKS(200));
-        attempt++;
+        case ConnectionState::Associating:
+        case ConnectionState::DHCP: {
+            if (!connBeginIssued) {
+                if (now - connStateEnteredAt < disconnectSettleTime) {
+                    return;
+                }
+                issueBegin(now);
+                return;
+            }
+
+            if (WiFi.status() == WL_CONNECTED) {
+                setConnectionState(ConnectionState::Connected, now);
+                recordConnectResult(true, now);
+                persistCurrentAP();
+                IPAddress ip = WiFi.localIP();
+                deferredLog().log("[WiFiWrapper] Connected after %u ms. IP: %u.%u.%u.%u",
+                                  now - connAttemptStartedAt, ip[0], ip[1], ip[2], ip[3]);
+                const uint8_t* bssid = WiFi.BSSID();
+                if (bssid) {
+                    deferredLog().log("[WiFiWrapper] Connected BSSID: %02X:%02X:%02X:%02X:%02X:%02X",
+                                      bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5]);
+                }
+                deferredLog().log("[WiFiWrapper] RSSI: %d", WiFi.RSSI());
+                return;
+            }
+
+            if (getConnectionState() == ConnectionState::Associating) {
+                wifi_ap_record_t apInfo;
+                if (esp_wifi_sta_get_ap_info(&apInfo) == ESP_OK) {
+                    // associated, waiting for an address; keeps the same deadline
+                    connState.store(ConnectionState::DHCP, std::memory_order_release);
+                }
+            }
+
+            if (!connBeginFailed && now - connStateEnteredAt < connectTimeout) {
+                return;
+            }
+
+            if (connTarget.valid) {
+                scanner.forget(connTarget.bssid); // do not pick it from the cache again
+                if (connPath == ConnectPath::Persisted) {
+                    // the saved AP is gone or moved: forget it and do the regular scan
+                    deferredLog().log("[WiFiWrapper] Fast path failed. Scanning.");
+                    connStats.persistedMisses++;
+                    APCache::clear();
+                    dropStaticLease();
+                    WiFi.disconnect(false, false);
+                    if (scanner.start(false)) {
+                        connPath = ConnectPath::Scan;
+                        setConnectionState(ConnectionState::Scanning, now);
+                        return;
+                    }
+                }
+                deferredLog().log("[WiFiWrapper] BSSID-pinned connection failed. Falling back to normal WiFi.begin().");
+                connPath = ConnectPath::Fallback;
+                startAssociation(APChoice(), now);
+                return;
+            }
+            deferredLog().log("[WiFiWrapper] WiFi Connection Failed!");
+            recordConnectResult(false, now);
+            setConnectionState(ConnectionState::Failed, now);
+            scheduleReconnect(now);
+            return;
+        }
+
+        case ConnectionState::Connected:
+            if (WiFi.status() != WL_CONNECTED) {
+                linkDown(now); // the event was missed or is late
+            }
+            return;
+
+        default:
+            return;
+    }
+}
+
+// invokes the subscriber outside the mutex, if the state moved since the last call
+void WiFiWrapper::notifyConnectionState() {
+    ConnectionStateCallback callback;
+    void* arg;
+    ConnectionState state;
+    {
+        LockGuard lg(stateMutex);
+        state = getConnectionState();
+        if (state == notifiedConnState) {
+            return;
+        }
+        notifiedConnState = state;
+        callback = connStateCallback;
+        arg = connStateCallbackArg;
+    }
+    if (callback) {
+        callback(state, arg);
+    }
+}
+
+const char* WiFiWrapper::connectPathName(ConnectPath path) {
+    switch (path) {
+        case ConnectPath::None:        return "none";
+        case ConnectPath::MemoryCache: return "cache";
+        case ConnectPath::Persisted:   return "fast";
+        case ConnectPath::Scan:        return "scan";
+        case ConnectPath::Fallback:    return "fallback";
+        case ConnectPath::Roam:        return "roam";
+        default:                       return "?";
+    }
+}
+
+void WiFiWrapper::recordConnectResult(bool success, uint32_t now) {
+    if (!success) {
+        connStats.failures++;
+        connectFailuresMetric.add();
+        metrics().event(MetricEvent::WifiConnectFailed);
+        return;
+    }
+    uint32_t duration = now - connAttemptStartedAt;
+    reconnectAttempts = 0;
+    reconnectScheduled = false;
+    if (recovering) {
+        recoverMsMetric.record(now - linkLostAt);
+        recovering = false;
     }
+    connectsMetric.add();
+    connectMsMetric.record(duration);
+    rssiMetric.set(WiFi.RSSI());
+    metrics().event(MetricEvent::WifiConnected, static_cast<int32_t>(connPath));
+    size_t i = static_cast<size_t>(connPath);
+    connStats.lastPath = connPath;
+    connStats.lastDurationMs = duration;
+    connStats.successes[i]++;
+    connStats.totalMs[i] += duration;
+    if (duration > connStats.maxMs[i]) {
+        connStats.maxMs[i] = duration;
+    }
+
+    deferredLog().log("[WiFiWrapper] Connect path: %s, %u ms", connectPathName(connPath), duration);
+}
+
+void WiFiWrapper::persistCurrentAP() {
+    if (!usePersistedAP) {
+        return;
+    }
+    const uint8_t* bssid = WiFi.BSSID();
+    if (!bssid) {
+        return;
+    }
+    PersistedAP ap = {};
+    if (staticLeaseApplied) {
+        // the address is the one we set ourselves, not a lease: keep the stored
+        // one and count the reuse, so it expires
+        if (APCache::load(ssid, ap) && ap.leaseUses < APCache::leaseAgeUnknown - 1) {
+            ap.leaseUses++;
+        }
+    } else {
+        ap.ip = static_cast<uint32_t>(WiFi.localIP());
+        ap.gateway = static_cast<uint32_t>(WiFi.gatewayIP());
+        ap.subnet = static_cast<uint32_t>(WiFi.subnetMask());
+        ap.dns = static_cast<uint32_t>(WiFi.dnsIP());
+        ap.leaseUses = 0;
+    }
+    memcpy(ap.bssid, bssid, 6);
+    ap.channel = static_cast<uint8_t>(WiFi.channel());
+    ap.rssi = WiFi.RSSI();
+    APCache::store(ssid, ap);
+}
+
+void WiFiWrapper::dropStaticLease() {
+    if (staticLeaseApplied) {
+        WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE); // back to DHCP
+        staticLeaseApplied = false;
+    }
+}
 
-    if (WiFi.status() == WL_CONNECTED) {
-        gLogger->print("  WiFi Connected! ");
-        gLogger->print("IP Address: ");
-        gLogger->println(WiFi.localIP().toString());
+WiFiWrapper::ConnectStats WiFiWrapper::getConnectStats() const {
+    LockGuard lg(stateMutex);
+    return connStats;
+}
+
+void WiFiWrapper::setUsePersistedAP(bool use) {
+    LockGuard lg(stateMutex);
+    usePersistedAP = use;
+}
 
-        gLogger->print("[WiFiWrapper] Connected BSSID: ");
-        gLogger->println(WiFi.BSSIDstr());
+void WiFiWrapper::setReuseCachedLease(bool reuse) {
+    LockGuard lg(stateMutex);
+    reuseCachedLease = reuse;
+}
 
-        gLogger->print("[WiFiWrapper] RSSI: ");
-        gLogger->println(WiFi.RSSI());
+void WiFiWrapper::forgetPersistedAP() {
+    LockGuard lg(stateMutex);
+    APCache::clear();
+}
 
-        return true;
+bool WiFiWrapper::waitForConnection(uint32_t timeoutMs) {
+    uint32_t start = millis();
+    for (;;) {
+        {
+            LockGuard lg(stateMutex);
+            advanceConnection(millis());
+            publishStatus();
+        }
+        notifyConnectionState();
+        if (!isConnecting() || millis() - start >= timeoutMs) {
+            break;
+        }
+        esp_task_wdt_reset();
+        vTaskDelay(pdMS_TO_TICKS(50));
     }
+    return getConnectionState() == ConnectionState::Connected;
+}
 
-    gLogger->println("\nWiFi Connection Failed!");
-    return false;
+void WiFiWrapper::begin(bool connectToNetwork, bool lowPowerMode, bool locked) {
+    if (!eventHandlerId) {
+        eventHandlerId = WiFi.onEvent(onWiFiEvent);
+    }
+    {
+        LockGuard lg(locked ? stateMutex : nullptr);
+        deferredLog().log("Initializing WiFi...");
+        WiFi.mode(WIFI_STA);
+        WiFi.persistent(false);
+
+        if (connectToNetwork)
+            startConnect(false);
+
+        if (lowPowerMode)
+            configureLowPowerMode(false); 
+        else
+            configureFullPowerMode(false);
+        //the radio was (re)started, keep TX power and thermal limits
+        applyTxPower();
+        applyPowerSave(currentPowerState == PowerState::Full ? WIFI_PS_NONE : WIFI_PS_MIN_MODEM);
+
+        sleepTimerStartedAt  = millis();
+        lastReconnectAttempt = millis();
+        lastRoamCheck        = millis();
+        publishStatus();
+    }
+    // we own the lock: wait here like before, but let everyone else in between steps
+    if (connectToNetwork && locked)
+        waitForConnection();
+}
+
+void WiFiWrapper::resume(bool locked) {
+    LockGuard lg(locked ? stateMutex : nullptr);
+    if (WiFi.getMode() != WIFI_OFF && wifiShouldBeConnected) {
+        deferredLog().log("WiFiWrapper::resume() called, but WiFi is not stopped. Ignoring resume.");
+        return;
+    }
+    // radio on in the power mode we had, the connect is driven by loop() and the driver events
+    begin(true, currentPowerState == PowerState::Low, false);
+}
+
+bool WiFiWrapper::connect(bool locked) {
+    if (!locked) {
+        // caller holds the mutex, we must not wait for the radio here
+        startConnect(false);
+        return WiFi.status() == WL_CONNECTED;
+    }
+    startConnect(true);
+    return waitForConnection();
 }
 
 void WiFiWrapper::disconnect(bool locked){
     LockGuard lg( locked ? stateMutex : nullptr );
     if(alwaysOn){
-        gLogger->println("WiFiWrapper::disconnect() called, but alwaysOn is set. Ignoring disconnect.");
+        deferredLog().log("WiFiWrapper::disconnect() called, but alwaysOn is set. Ignoring disconnect.");
          return;
     }
+    scanner.abort();
+    roamScanPending = false;
     WiFi.disconnect(); 
     wifiShouldBeConnected=false;
+    setConnectionState(ConnectionState::Idle, millis());
+    publishStatus();
 }
 void WiFiWrapper::stop(bool locked){ 
     LockGuard lg( locked ? stateMutex : nullptr );
     if(alwaysOn){
-        gLogger->println("WiFiWrapper::stop() called, but alwaysOn is set. Ignoring stop.");
+        deferredLog().log("WiFiWrapper::stop() called, but alwaysOn is set. Ignoring stop.");
          return;
     }
     disconnect(false);//not locked again
     WiFi.mode(WIFI_OFF);
+    publishStatus();
 }
 
 void WiFiWrapper::loop() { 
     xSemaphoreTake(stateMutex, portMAX_DELAY);
     //read the state
     uint32_t tmp_now = millis();
+    advanceConnection(tmp_now);
+    if (roamScanPending && !isConnecting())
+        finishRoamCheck(tmp_now);
+    publishStatus(); // RSSI and link state for the getters
+    auto tmp_connecting = isConnecting();
     auto tmp_wifiShouldBeConnected = wifiShouldBeConnected;
     auto tmp_lastReconnectAttempt = lastReconnectAttempt;
     auto tmp_lastRoamCheck = lastRoamCheck;
@@ -308,18 +622,21 @@ void WiFiWrapper::loop() {
     auto tmp_alwaysOn = alwaysOn;
     auto tmp_wakeDuration = wakeDuration;
     auto tmp_arduinoSleep = WiFi.getSleep();
+    auto tmp_reconnectDue = reconnectScheduled && (int32_t)(tmp_now - nextReconnectAt) >= 0;
     xSemaphoreGive(stateMutex);
 
+    notifyConnectionState();
+
     if (!tmp_wifiShouldBeConnected) return;
 
-    if (tmp_now - tmp_lastReconnectAttempt > reconnectInterval) {
+    if (!tmp_connecting && (tmp_reconnectDue || tmp_now - tmp_lastReconnectAttempt > reconnectInterval)) {
         xSemaphoreTake(stateMutex, portMAX_DELAY);
         lastReconnectAttempt = tmp_now;
         checkAndReconnect(false);
         xSemaphoreGive(stateMutex);
     }
 
-    if (tmp_now - tmp_lastRoamCheck > roamCheckInterval) {
+    if (!tmp_connecting && tmp_now - tmp_lastRoamCheck > roamCheckInterval) {
         xSemaphoreTake(stateMutex, portMAX_DELAY);
         lastRoamCheck = tmp_now;
         maybeRoamToBetterAP(false);
@@ -341,74 +658,190 @@ void WiFiWrapper::loop() {
 void WiFiWrapper::checkAndReconnect(bool locked) {
     LockGuard lg(locked ? stateMutex : nullptr);
 
+    if (isConnecting()) {
+        return;
+    }
     if (WiFi.status() != WL_CONNECTED) {
-        gLogger->println("WiFi lost! Attempting to reconnect...");
+        deferredLog().log("[WiFiWrapper] Reconnecting, %u failed attempts so far", reconnectAttempts);
+        reconnectScheduled = false;
         WiFi.disconnect();
-        vTaskDelay(pdMS_TO_TICKS(100));
-        connect(false);
+        startConnect(false); // progress is driven by events and loop()
+        publishStatus();
     }
 }
 
+// the link went away under an established connection: reconnect right away,
+// further attempts back off (scheduleReconnect())
+void WiFiWrapper::linkDown(uint32_t now) {
+    if (getConnectionState() != ConnectionState::Connected) {
+        return; // our own disconnects and failed attempts
+    }
+    setConnectionState(ConnectionState::Idle, now);
+    lostMetric.add();
+    uint32_t since = linkGoodAt;
+    uint32_t eventAt = linkLossEventAt.load(std::memory_order_relaxed);
+    if ((int32_t)(eventAt - since) > 0) {
+        since = eventAt;
+    }
+    detectMsMetric.record(now - since);
+    metrics().event(MetricEvent::WifiLost);
+    linkLostAt = now;
+    recovering = true;
+    reconnectAttempts = 0;
+    if (!wifiShouldBeConnected) {
+        return;
+    }
+    deferredLog().log("[WiFiWrapper] WiFi lost! Reconnecting...");
+    lastReconnectAttempt = now;
+    startConnect(false);
+}
+
+// next attempt after a failed one: doubles from reconnectBackoffMin up to
+// reconnectBackoffMax, +-25% jitter so devices behind one AP do not retry in lockstep
+void WiFiWrapper::scheduleReconnect(uint32_t now) {
+    if (!wifiShouldBeConnected) {
+        return;
+    }
+    uint32_t delay = reconnectBackoffMax;
+    if (reconnectAttempts < 16) {
+        delay = reconnectBackoffMin << reconnectAttempts;
+        if (delay > reconnectBackoffMax) delay = reconnectBackoffMax;
+    }
+    delay = delay - delay / 4 + esp_random() % (delay / 2 + 1);
+    reconnectAttempts++;
+    nextReconnectAt = now + delay;
+    reconnectScheduled = true;
+    deferredLog().log("[WiFiWrapper] Next reconnect in %u ms", delay);
+}
+
+// runs on the driver's event task, so the reaction does not wait for the next loop()
+void WiFiWrapper::onWiFiEvent(arduino_event_t* event) {
+    WiFiWrapper* self = instance;
+    if (!self) {
+        return;
+    }
+    uint32_t now = millis();
+    if (event->event_id == ARDUINO_EVENT_WIFI_STA_DISCONNECTED || event->event_id == ARDUINO_EVENT_WIFI_STA_LOST_IP) {
+        self->linkLossEventAt.store(now, std::memory_order_relaxed); // for wifi.detect_ms, even if loop() handles it
+    }
+    if (xSemaphoreTake(self->stateMutex, pdMS_TO_TICKS(eventLockTimeoutMs)) != pdTRUE) {
+        return; // loop() finds the same state change when it polls
+    }
+    now = millis();
+    switch (event->event_id) {
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+            // AP not found, auth failed, ...: give up on this attempt now; ASSOC_LEAVE is our own WiFi.disconnect()
+            if (self->connBeginIssued && self->isConnecting() &&
+                event->event_info.wifi_sta_disconnected.reason != WIFI_REASON_ASSOC_LEAVE) {
+                self->connBeginFailed = true;
+                self->advanceConnection(now);
+                break;
+            }
+            self->linkDown(now);
+            break;
+        case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+            self->linkDown(now);
+            break;
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+        case ARDUINO_EVENT_WIFI_SCAN_DONE:
+            self->advanceConnection(now);
+            if (self->roamScanPending && !self->isConnecting())
+                self->finishRoamCheck(now);
+            break;
+        default:
+            break;
+    }
+    self->publishStatus();
+    xSemaphoreGive(self->stateMutex);
+}
+
 
 void WiFiWrapper::configureFullPowerMode(bool locked) {
     LockGuard lg( locked ? stateMutex : nullptr );
     if(currentPowerState == PowerState::Full) return; // already in full power mode
     //the user should have checked this but as a safety
-    while(!stateReady.load(std::memory_order_acquire)){
-        vTaskDelay(pdMS_TO_TICKS(5));  
-    }
-    esp_wifi_set_ps(WIFI_PS_NONE);
-    stateReady = false;
+    waitSettled(portMAX_DELAY);
+    _setStateReady(false);
     // Arduino wrapper call (keeps the wrapper’s internal flag in sync)
     WiFi.setSleep(false);
+    applyPowerSave(WIFI_PS_NONE);
     currentPowerState = PowerState::Full;
+    powerModeMetric.add();
+    metrics().event(MetricEvent::WifiPowerMode, 0);
     sleepTimerStartedAt = millis();   // reset your idle timer here, too
     //if lastReconnectAttempt would reconnect immediately, reset it so it waits for 5 s at least
     if(millis() - lastReconnectAttempt > reconnectInterval){
         lastReconnectAttempt = millis() - reconnectInterval + 5000;
     }
-    BaseType_t res = xTaskCreatePinnedToCore(wifiStatusComplete, "WiFiReady", 1024, nullptr, 0, nullptr, tskNO_AFFINITY);
-    if (res != pdPASS) {
-        gLogger->println("[WiFiWrapper] Failed to create WiFiReady task");
-    }
+    startSettling();
 }
 
 void WiFiWrapper::configureLowPowerMode(bool locked) {
     LockGuard lg( locked ? stateMutex : nullptr );
     if(currentPowerState == PowerState::Low) return; // already in low power mode
     //the user should have checked this but as a safety
-    while(!stateReady.load(std::memory_order_acquire)){
-        vTaskDelay(pdMS_TO_TICKS(5));  
-    }
-    stateReady = false;
-    esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
+    waitSettled(portMAX_DELAY);
+    _setStateReady(false);
     WiFi.setSleep(true);
+    applyPowerSave(WIFI_PS_MIN_MODEM);
     currentPowerState = PowerState::Low;
-    BaseType_t res = xTaskCreatePinnedToCore(wifiStatusComplete, "WiFiReady", 1024, nullptr, 0, nullptr, tskNO_AFFINITY);
-    if (res != pdPASS) {
-        gLogger->println("[WiFiWrapper] Failed to create WiFiReady task");
+    powerModeMetric.add();
+    metrics().event(MetricEvent::WifiPowerMode, 1);
+    startSettling();
+}
+
+void WiFiWrapper::startSettling() {
+    if (esp_timer_start_once(settleTimer, powerSettleMs * 1000ULL) != ESP_OK) {
+        deferredLog().log("[WiFiWrapper] Failed to start power settle timer");
+        _setStateReady(true); // nobody must wait for it forever
     }
 }
 
+bool WiFiWrapper::waitSettled(TickType_t ticks) const {
+    EventBits_t bits = xEventGroupWaitBits(powerEvents, powerSettledBit, pdFALSE, pdTRUE, ticks);
+    return (bits & powerSettledBit) != 0;
+}
+
+bool WiFiWrapper::waitForPowerSettled(uint32_t timeoutMs) const {
+    return waitSettled(pdMS_TO_TICKS(timeoutMs));
+}
+
 void WiFiWrapper::setTXPower(uint8_t power, bool locked){
     LockGuard lg( locked ? stateMutex : nullptr );
     //check if power is in range
-    if (power < 0 || power > 20) {
-        gLogger->println("Invalid TX power level. Must be between 0 and 20 dBm.");
+    if (power > 20) {
+        deferredLog().log("Invalid TX power level. Must be between 0 and 20 dBm.");
         return;
     }
-    //cast to wifi_power_t
-    wifi_power_t wifiPower = static_cast<wifi_power_t>(power);
-    WiFi.setTxPower(wifiPower);
+    txPowerDbm = power;
+    applyTxPower();
+}
+
+void WiFiWrapper::setThermalLimits(uint8_t maxTxPowerDbm, wifi_ps_type_t minPowerSave, bool locked){
+    LockGuard lg( locked ? stateMutex : nullptr );
+    thermalMaxTxPowerDbm = maxTxPowerDbm > 20 ? 20 : maxTxPowerDbm;
+    thermalMinPowerSave = minPowerSave;
+    applyTxPower();
+    applyPowerSave(currentPowerState == PowerState::Full ? WIFI_PS_NONE : WIFI_PS_MIN_MODEM);
+}
+
+//with stateMutex held
+void WiFiWrapper::applyTxPower(){
+    uint8_t dbm = txPowerDbm < thermalMaxTxPowerDbm ? txPowerDbm : thermalMaxTxPowerDbm;
+    //wifi_power_t is in 0.25 dBm steps, 19.5 dBm max; the radio does not go below 2 dBm
+    int quarters = dbm * 4;
+    if (quarters > WIFI_POWER_19_5dBm) quarters = WIFI_POWER_19_5dBm;
+    if (quarters < WIFI_POWER_2dBm) quarters = WIFI_POWER_2dBm;
+    WiFi.setTxPower(static_cast<wifi_power_t>(quarters));
+}
+
+//with stateMutex held
+void WiFiWrapper::applyPowerSave(wifi_ps_type_t wanted){
+    esp_wifi_set_ps(wanted > thermalMinPowerSave ? wanted : thermalMinPowerSave);
 }
 
 int32_t WiFiWrapper::getSignalStrength() const {
-    LockGuard lg(stateMutex);
-    if (WiFi.status() == WL_CONNECTED) {
-        return WiFi.RSSI();
-    } else {
-        return -127; // convention: -1 dBm = not connected
-    }
+    return status_.load().rssi; // -127 if not connected
 }
 
 WiFiWrapper::SignalLevel WiFiWrapper::classifySignalLevel(int32_t rssi) const {
@@ -428,14 +861,11 @@ WiFiWrapper::SignalLevel WiFiWrapper::classifySignalLevel(int32_t rssi) const {
 }
 
 uint8_t WiFiWrapper::getChannel() const {
-    wifi_second_chan_t secondChannel;
-    uint8_t channel;
-    LockGuard lg(stateMutex);
-    esp_wifi_get_channel(&channel, &secondChannel);
-    return channel;
+    return status_.load().channel;
 }
 
 void WiFiWrapper::keepWiFiAwake() {
+   dvfsBoost(wakeBoostMs); // the caller is about to send something, don't make it wait on a slow clock
    LockGuard lg(stateMutex);
    configureFullPowerMode(false);
    sleepTimerStartedAt = millis();
@@ -455,109 +885,172 @@ void WiFiWrapper::setAlwaysOn(bool set) {
     LockGuard lg(stateMutex);
     alwaysOn = set;
     if(alwaysOn){
-        gLogger->println("WiFiWrapper::alwaysOn set; Ignoring disconnects etc from here on an staying in connected full power mode");
-        connect(false);
+        deferredLog().log("WiFiWrapper::alwaysOn set; Ignoring disconnects etc from here on an staying in connected full power mode");
+        startConnect(false);
         autoSleep = false;
         configureFullPowerMode(false);
     }
     else{
-        gLogger->println("WiFiWrapper::setAlwaysOn() turned off. Re-init the state you want to be in manually.");
+        deferredLog().log("WiFiWrapper::setAlwaysOn() turned off. Re-init the state you want to be in manually.");
     }
 }
 
 bool WiFiWrapper::isConnected() const {
-    LockGuard lg(stateMutex);
-    return WiFi.status() == WL_CONNECTED;
+    return status_.load().status == WL_CONNECTED;
 }
 
 wl_status_t WiFiWrapper::getWiFiStatus() const {
-    LockGuard lg(stateMutex);
-    return WiFi.status();
+    return status_.load().status;
 }
 
-String WiFiWrapper::getBSSID() const {
-    LockGuard lg(stateMutex);
+// snprintf returns what it would have written; report what actually fits
+static size_t writtenLength(int n, size_t len) {
+    if (n < 0 || len == 0) return 0;
+    return (size_t)n < len ? (size_t)n : len - 1;
+}
 
-    if (WiFi.status() != WL_CONNECTED) {
-        return String("-");
+static size_t formatIP(char* buf, size_t len, const IPAddress& ip) {
+    return writtenLength(snprintf(buf, len, "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]), len);
+}
+
+static size_t formatBSSID(char* buf, size_t len, const uint8_t* b) {
+    return writtenLength(snprintf(buf, len, "%02X:%02X:%02X:%02X:%02X:%02X",
+                                  b[0], b[1], b[2], b[3], b[4], b[5]), len);
+}
+
+static size_t formatDash(char* buf, size_t len) {
+    return writtenLength(snprintf(buf, len, "-"), len);
+}
+
+// WiFi.SSID() and WiFi.BSSIDstr() return Strings, the AP record has both in place
+static bool currentAPInfo(wifi_ap_record_t& info) {
+    return WiFi.status() == WL_CONNECTED && esp_wifi_sta_get_ap_info(&info) == ESP_OK;
+}
+
+//with stateMutex held, which also keeps the SeqLock single writer
+void WiFiWrapper::publishStatus() {
+    Status s = {};
+    s.updatedAt = millis();
+    s.status = WiFi.status();
+    s.rssi = -127;
+    wifi_second_chan_t secondChannel;
+    esp_wifi_get_channel(&s.channel, &secondChannel);
+    if (s.status == WL_CONNECTED) {
+        linkGoodAt = s.updatedAt;
+        s.rssi = WiFi.RSSI();
+        s.ip = static_cast<uint32_t>(WiFi.localIP());
+        s.gateway = static_cast<uint32_t>(WiFi.gatewayIP());
     }
+    wifi_ap_record_t info;
+    if (currentAPInfo(info)) {
+        s.haveAP = true;
+        memcpy(s.bssid, info.bssid, 6);
+        snprintf(s.ssid, sizeof(s.ssid), "%.32s", (const char*)info.ssid);
+    }
+    const char* hostname = WiFi.getHostname();
+    snprintf(s.hostname, sizeof(s.hostname), "%s", hostname ? hostname : "-");
+    status_.store(s);
+}
 
-    return WiFi.BSSIDstr();
+String WiFiWrapper::getBSSID() const {
+    char buf[bssidBufferSize];
+    getBSSID(buf, sizeof(buf));
+    return String(buf);
+}
+
+size_t WiFiWrapper::getBSSID(char* buf, size_t len) const {
+    Status s = status_.load();
+    if (!s.haveAP) {
+        return formatDash(buf, len);
+    }
+    return formatBSSID(buf, len, s.bssid);
 }
 
 String WiFiWrapper::getSSID() const {
-    LockGuard lg(stateMutex);
+    char buf[33];
+    getSSID(buf, sizeof(buf));
+    return String(buf);
+}
 
-    if (WiFi.status() != WL_CONNECTED) {
-        return String("-");
+size_t WiFiWrapper::getSSID(char* buf, size_t len) const {
+    Status s = status_.load();
+    if (!s.haveAP) {
+        return formatDash(buf, len);
     }
-
-    return WiFi.SSID();
+    return writtenLength(snprintf(buf, len, "%s", s.ssid), len);
 }
 
 String WiFiWrapper::getLocalIP() const {
-    LockGuard lg(stateMutex);
+    char buf[ipBufferSize];
+    getLocalIP(buf, sizeof(buf));
+    return String(buf);
+}
 
-    if (WiFi.status() != WL_CONNECTED) {
-        return String("-");
+size_t WiFiWrapper::getLocalIP(char* buf, size_t len) const {
+    Status s = status_.load();
+    if (s.status != WL_CONNECTED) {
+        return formatDash(buf, len);
     }
-
-    return WiFi.localIP().toString();
+    return formatIP(buf, len, IPAddress(s.ip));
 }
 
 String WiFiWrapper::getGatewayIP() const {
-    LockGuard lg(stateMutex);
+    char buf[ipBufferSize];
+    getGatewayIP(buf, sizeof(buf));
+    return String(buf);
+}
 
-    if (WiFi.status() != WL_CONNECTED) {
-        return String("-");
+size_t WiFiWrapper::getGatewayIP(char* buf, size_t len) const {
+    Status s = status_.load();
+    if (s.status != WL_CONNECTED) {
+        return formatDash(buf, len);
     }
-
-    return WiFi.gatewayIP().toString();
+    return formatIP(buf, len, IPAddress(s.gateway));
 }
 
 String WiFiWrapper::getHostname() const {
-    LockGuard lg(stateMutex);
-
-    const char* hostname = WiFi.getHostname();
-    if (!hostname) {
-        return String("-");
-    }
+    char buf[sizeof(Status::hostname)];
+    getHostname(buf, sizeof(buf));
+    return String(buf);
+}
 
-    return String(hostname);
+size_t WiFiWrapper::getHostname(char* buf, size_t len) const {
+    Status s = status_.load();
+    return writtenLength(snprintf(buf, len, "%s", s.hostname), len);
 }
 
 String WiFiWrapper::getConnectionSummary() const {
-    LockGuard lg(stateMutex);
-
-    String s;
+    char buf[summaryBufferSize];
+    getConnectionSummary(buf, sizeof(buf));
+    return String(buf);
+}
 
-    if (WiFi.status() != WL_CONNECTED) {
-        s += "WiFi: disconnected";
-        s += " | status: ";
-        s += String(static_cast<int>(WiFi.status()));
-        return s;
+size_t WiFiWrapper::getConnectionSummary(char* buf, size_t len) const {
+    Status s = status_.load();
+    if (s.status != WL_CONNECTED || !s.haveAP) {
+        return writtenLength(snprintf(buf, len, "WiFi: disconnected | status: %d", static_cast<int>(s.status)), len);
     }
 
-    wifi_second_chan_t secondChannel;
-    uint8_t channel = 0;
-    esp_wifi_get_channel(&channel, &secondChannel);
+    char ip[ipBufferSize];
+    char bssid[bssidBufferSize];
+    formatIP(ip, sizeof(ip), IPAddress(s.ip));
+    formatBSSID(bssid, sizeof(bssid), s.bssid);
 
-    const char* hostname = WiFi.getHostname();
+    int n = snprintf(buf, len, "WiFi: connected | IP: %s | host: %s | SSID: %s | BSSID: %s | ch: %u | RSSI: %d dBm",
+                     ip, s.hostname, s.ssid, bssid, (unsigned)s.channel, static_cast<int>(s.rssi));
+    return writtenLength(n, len);
+}
 
-    s += "WiFi: connected";
-    s += " | IP: ";
-    s += WiFi.localIP().toString();
-    s += " | host: ";
-    s += hostname ? String(hostname) : String("-");
-    s += " | SSID: ";
-    s += WiFi.SSID();
-    s += " | BSSID: ";
-    s += WiFi.BSSIDstr();
-    s += " | ch: ";
-    s += String(channel);
-    s += " | RSSI: ";
-    s += String(WiFi.RSSI());
-    s += " dBm";
-
-    return s;
-}
\ No newline at end of file
+uint8_t WiFiWrapper::getCandidateCount() const {
+    LockGuard lg(stateMutex);
+    return scanner.candidateCount();
+}
+
+bool WiFiWrapper::getCandidate(uint8_t i, APCandidate& out) const {
+    LockGuard lg(stateMutex);
+    if (i >= scanner.candidateCount()) {
+        return false;
+    }
+    out = scanner.candidate(i);
+    return true;
+}
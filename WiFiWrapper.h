@@ -3,7 +3,12 @@
 
 #include <WiFi.h>
 #include "esp_wifi.h"
+#include "esp_timer.h"
+#include "freertos/event_groups.h"
 #include "LoggingBase.h"
+#include "APScanner.h"
+#include "APCache.h"
+#include "SeqLock.h"
 #include <atomic>
 
 class WiFiWrapper {
@@ -13,17 +18,41 @@ private:
     bool wifiShouldBeConnected = true;
     bool autoSleep = true;
     uint32_t wakeDuration = 30000;  // Keep WiFi awake for 30s after activity
-    static constexpr uint32_t reconnectInterval = 60000; // 1 minute
+    static constexpr uint32_t wakeBoostMs = 500; // full CPU clock after keepWiFiAwake()
+    static constexpr uint32_t reconnectInterval = 60000; // 1 minute, polled fallback if no event came
+    static constexpr uint32_t reconnectBackoffMin = 1000; // ms after the first failed reconnect, doubles per failure
+    static constexpr uint32_t reconnectBackoffMax = 30000;
+    static constexpr uint32_t eventLockTimeoutMs = 100;  // the driver's event task never waits longer for stateMutex
     
     uint32_t lastReconnectAttempt = 0;
+    uint32_t reconnectAttempts = 0;   // failed in a row, reset on connect
+    uint32_t nextReconnectAt = 0;
+    bool reconnectScheduled = false;
+    bool recovering = false;          // link was lost, counts until connected again
+    uint32_t linkLostAt = 0;
+    uint32_t linkGoodAt = 0;          // last publishStatus() that saw the link up
+    std::atomic<uint32_t> linkLossEventAt{0}; // last disconnect/lost-IP event, stamped before taking stateMutex
+    wifi_event_id_t eventHandlerId = 0;
     uint32_t sleepTimerStartedAt = 0;
 
     bool alwaysOn = false;
 
     enum class PowerState { Full, Low };
     PowerState currentPowerState = PowerState::Full;  // or Low if you start that way
+    uint8_t txPowerDbm = 20;                          // as set by setTXPower()
+    uint8_t thermalMaxTxPowerDbm = 20;                // see setThermalLimits()
+    wifi_ps_type_t thermalMinPowerSave = WIFI_PS_NONE;
     std::atomic<bool> stateReady{false}; // for thread safety
     SemaphoreHandle_t stateMutex{nullptr};
+    // a power mode change is settled powerSettleMs after it was applied; the one-shot
+    // timer sets powerSettledBit, which is what the next change (or anyone) waits on
+    static constexpr uint32_t powerSettleMs = 10;
+    static constexpr EventBits_t powerSettledBit = 1 << 0;
+    EventGroupHandle_t powerEvents{nullptr};
+    esp_timer_handle_t settleTimer{nullptr};
+    bool waitSettled(TickType_t ticks) const;
+    void startSettling();
+    static void powerSettled(void* arg);
 
 //multi BSSID handling
     struct APChoice {
@@ -37,13 +66,108 @@ private:
     static constexpr int32_t roamScanThreshold = -70;   // dBm: scan only if current RSSI is this bad or worse
     static constexpr int32_t roamDeltaThreshold = 10;   // dB: candidate must be this much better
 
+    static constexpr uint32_t candidateMaxAge = 5UL * 60UL * 1000UL; // reuse scan results this long for connects
+    static constexpr uint32_t fullRescanInterval = 6UL * 3600UL * 1000UL; // roam scans look at all channels this often
+
     uint32_t lastRoamCheck = 0;
 
-    APChoice findBestAPForSSID(bool locked = true);
-    bool connectToBestAvailableAP(bool locked = true);
+    APScanner scanner;            // background scans + candidate cache, used with stateMutex held
+    bool roamScanPending = false; // roam decision waits for the running scan
+
+    APChoice bestCachedAP(uint32_t now, uint32_t maxAge);
     bool connectToSpecificAP(const APChoice& ap, bool locked = true);
     bool maybeRoamToBetterAP(bool locked = true);
+    void finishRoamCheck(uint32_t now);
+    void applyTxPower();
+    void applyPowerSave(wifi_ps_type_t wanted);
+
+public:
+    // connection progress, advanced by loop() / waitForConnection() without
+    // ever holding stateMutex across a radio wait
+    enum class ConnectionState {
+        Idle,
+        Scanning,
+        Associating,
+        DHCP,
+        Connected,
+        Failed
+    };
+    typedef void (*ConnectionStateCallback)(ConnectionState state, void* arg);
+
+    // how a connection attempt found its AP
+    enum class ConnectPath {
+        None,
+        MemoryCache,  // candidate from a recent scan
+        Persisted,    // fast path: AP saved in RTC memory / NVS by a previous boot
+        Scan,         // fresh scan
+        Fallback,     // plain WiFi.begin(ssid, password)
+        Roam,
+        Count
+    };
+    static constexpr size_t connectPathCount = static_cast<size_t>(ConnectPath::Count);
+
+    struct ConnectStats {
+        ConnectPath lastPath = ConnectPath::None;
+        uint32_t lastDurationMs = 0;                // start of attempt until connected
+        uint32_t successes[connectPathCount] = {};  // indexed by ConnectPath
+        uint32_t totalMs[connectPathCount] = {};
+        uint32_t maxMs[connectPathCount] = {};
+        uint32_t failures = 0;
+        uint32_t persistedMisses = 0;               // fast path tried, had to scan
+    };
 
+    // what the status getters report. Published with stateMutex held by loop(),
+    // waitForConnection() and the calls that connect or disconnect; reading it never
+    // blocks, so it is as fresh as the last loop() call.
+    struct Status {
+        wl_status_t status;
+        bool haveAP;        // bssid and ssid are valid
+        int8_t rssi;        // -127 if not connected
+        uint8_t channel;
+        uint8_t bssid[6];
+        uint32_t ip;        // 0 if not connected
+        uint32_t gateway;
+        char ssid[33];
+        char hostname[33];
+        uint32_t updatedAt; // millis()
+    };
+
+private:
+    static constexpr uint32_t scanTimeout = 10000;       // ms, async scan of all channels
+    static constexpr uint32_t connectTimeout = 6000;     // ms, association + DHCP per attempt
+    static constexpr uint32_t disconnectSettleTime = 200; // ms between WiFi.disconnect() and WiFi.begin()
+    static constexpr uint8_t maxLeaseReuses = 8;         // fast-path connects on a cached lease before DHCP is asked again
+
+    std::atomic<ConnectionState> connState{ConnectionState::Idle};
+    ConnectionState notifiedConnState = ConnectionState::Idle;
+    uint32_t connStateEnteredAt = 0;
+    uint32_t connAttemptStartedAt = 0;
+    APChoice connTarget;          // invalid = plain WiFi.begin(ssid, password)
+    bool connBeginIssued = false;
+    bool connBeginFailed = false; // the driver reported the attempt failed, no need to wait for connectTimeout
+    ConnectionStateCallback connStateCallback = nullptr;
+    void* connStateCallbackArg = nullptr;
+
+    ConnectPath connPath = ConnectPath::None;
+    ConnectStats connStats;
+    SeqLock<Status> status_; // written with stateMutex held, read lock-free
+    bool usePersistedAP = true;
+    bool reuseCachedLease = false;
+    bool staticLeaseApplied = false;
+
+    void recordConnectResult(bool success, uint32_t now);
+    void persistCurrentAP();
+    void dropStaticLease();
+
+    void setConnectionState(ConnectionState state, uint32_t now);
+    void startAssociation(const APChoice& ap, uint32_t now);
+    void issueBegin(uint32_t now);
+    void advanceConnection(uint32_t now);
+    void notifyConnectionState();
+    void publishStatus();
+    void linkDown(uint32_t now);
+    void scheduleReconnect(uint32_t now);
+    static void onWiFiEvent(arduino_event_t* event);
     
 public:
     enum class SignalLevel {
@@ -57,20 +181,46 @@ public:
 
     WiFiWrapper(const char* ssid, const char* password);
 
-    ~WiFiWrapper(){
-        if (stateMutex) {
-            vSemaphoreDelete(stateMutex);
-        }
-    }
+    ~WiFiWrapper();
     //called outside of threads
+    //with locked=true this waits for the connection, but without holding the mutex
     void begin(bool connectToNetwork=true, bool lowPowerMode=false, bool locked=true);
 
+    //blocks until connected or failed (mutex only held per step); with locked=false
+    //(caller holds the mutex) it only starts the attempt and returns isConnected state
     bool connect(bool locked=true);
+    //non-blocking: starts scan -> associate -> DHCP, progress is driven by loop()
+    void startConnect(bool locked=true);
+    //drives the connection state machine until Connected/Failed or timeout, returns true if connected
+    bool waitForConnection(uint32_t timeoutMs = scanTimeout + 2 * connectTimeout + 2 * disconnectSettleTime);
+    ConnectionState getConnectionState() const {
+        return connState.load(std::memory_order_acquire);
+    }
+    bool isConnecting() const;
+    //called from loop()/waitForConnection() outside the mutex; fast consecutive transitions may be coalesced
+    void onConnectionStateChange(ConnectionStateCallback callback, void* arg = nullptr);
+    static const char* connectionStateName(ConnectionState state);
+
+    ConnectStats getConnectStats() const;
+    static const char* connectPathName(ConnectPath path);
+    //try the AP of the last successful connect (RTC memory / NVS) before scanning, default on
+    void setUsePersistedAP(bool use);
+    //on the fast path also reuse the last DHCP lease as static IP; only if the router keeps leases stable.
+    //Every maxLeaseReuses connects, and after a reboot, the fast path goes through DHCP again.
+    void setReuseCachedLease(bool reuse);
+    void forgetPersistedAP();
+    //after stop() or disconnect(): radio back on and start connecting, without waiting for it
     void resume(bool locked=true);
     void disconnect(bool locked=true);
     //after stop begin() must be called again to recover
     void stop(bool locked=true);
-    //call at least every few seconds, no need for fast polling
+    //call at least every few seconds; while a connect is in flight (isConnecting())
+    //calling it more often makes the connection come up faster. Link loss, scan
+    //results and the IP are handled by driver events as they happen, loop() drives
+    //the timed steps (timeouts, backoff, roaming, power) and catches missed events.
+    //wifi.detect_ms covers the driver's disconnect/lost-IP event (or, if there was none,
+    //the last poll that saw the link up) until the loss is handled, not the driver's
+    //beacon timeout before the event; wifi.recover_ms from there until connected again.
     void loop();
     void checkAndReconnect(bool locked=true);
     void configureLowPowerMode(bool locked=true);
@@ -80,8 +230,15 @@ public:
     inline bool isStateReady()const{
         return stateReady.load(std::memory_order_acquire);
     }
+    //blocks (without polling) until the last power mode change has settled; false on timeout
+    bool waitForPowerSettled(uint32_t timeoutMs) const;
     
+    //0-20 dBm, rounded down to what the radio supports (2 dBm minimum)
     void setTXPower(uint8_t power, bool locked=true);
+    //thermal limits, set by TemperatureSafetyManager: TX power is capped at maxTxPowerDbm
+    //and the power save mode never goes below minPowerSave, whatever the power mode.
+    //Applied right away, the connection stays up. (20, WIFI_PS_NONE) lifts them.
+    void setThermalLimits(uint8_t maxTxPowerDbm, wifi_ps_type_t minPowerSave, bool locked=true);
 
 
     // Returns current RSSI in dBm (negative value; e.g., -40 is strong, -90 is weak)
@@ -106,6 +263,8 @@ public:
     // this is mostly for debugging, reject any state changes from on and connected, even if disconnect etc is called
     void setAlwaysOn(bool set);
 
+    // wait-free, from the last published Status
+    Status getStatus() const { return status_.load(); }
     bool isConnected() const;
     String getBSSID() const;
     String getSSID() const;
@@ -116,9 +275,31 @@ public:
 
     String getConnectionSummary() const;
 
+    // Heap-free variants for periodic status logging: write into buf (always zero
+    // terminated if len > 0) and return the number of characters written, truncated to fit.
+    // "-" if not connected, like the String versions.
+    static constexpr size_t bssidBufferSize = 18;    // AA:BB:CC:DD:EE:FF
+    static constexpr size_t ipBufferSize = 16;       // 255.255.255.255
+    static constexpr size_t summaryBufferSize = 160; // fits a 32 char SSID and hostname
+    size_t getBSSID(char* buf, size_t len) const;
+    size_t getSSID(char* buf, size_t len) const;
+    size_t getLocalIP(char* buf, size_t len) const;
+    size_t getGatewayIP(char* buf, size_t len) const;
+    size_t getHostname(char* buf, size_t len) const;
+    size_t getConnectionSummary(char* buf, size_t len) const;
+
+    // cached scan results for the configured SSID, i < getCandidateCount()
+    uint8_t getCandidateCount() const;
+    bool getCandidate(uint8_t i, APCandidate& out) const;
+
     // internal for tasks, do not call directly
     inline void _setStateReady(bool ready) {
         stateReady.store(ready, std::memory_order_release);
+        if (ready) {
+            xEventGroupSetBits(powerEvents, powerSettledBit);
+        } else {
+            xEventGroupClearBits(powerEvents, powerSettledBit);
+        }
     }
 
     
@@ -0,0 +1,285 @@
+// Cost of the calls we make from the main loop at high rates: ns/call,
+// heap allocations/call and semaphore acquisitions/call, measured against the
+// host simulator. Absolute ns are host numbers; compare runs, not devices.
+//
+//   bench_hotpaths                      print the table
+//   bench_hotpaths baseline.txt         also compare against a saved run
+//   bench_hotpaths --write baseline.txt save this run as the new baseline
+//
+// Against a baseline, exits with 1 if a row got more than 25% slower, allocates
+// or takes more, or has no baseline row at all.
+
+#include <WiFiWrapper.h>
+#include <TimeManager.h>
+#include <TemperatureSafetyManager.h>
+#include <TouchSensor.h>
+#include <TouchSensorBank.h>
+#include <TouchSampler.h>
+#include <throttle.h>
+#include <ThermalGovernor.h>
+#include <DvfsGovernor.h>
+#include <Metrics.h>
+#include <DeferredLog.h>
+#include "Sim.h"
+
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// allocation counting, per thread so background tasks do not pollute it
+
+static thread_local uint64_t tAllocations = 0;
+
+void* operator new(size_t size) {
+    tAllocations++;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) {
+    tAllocations++;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+// ---------------------------------------------------------------------------
+
+struct Result {
+    std::string name;
+    double nsPerCall;
+    double allocsPerCall;
+    double takesPerCall;
+};
+
+static volatile uint32_t gSink = 0;
+
+static Result measure(const std::string& name, const std::function<void()>& fn) {
+    // warm up, then run for ~100 ms
+    for (int i = 0; i < 100; ++i) fn();
+
+    uint64_t iterations = 0;
+    uint64_t allocs0 = tAllocations;
+    uint64_t takes0 = sim::semaphoreTakesThisThread();
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::milliseconds(100);
+    auto now = start;
+    while (now < deadline) {
+        for (int i = 0; i < 64; ++i) fn();
+        iterations += 64;
+        now = std::chrono::steady_clock::now();
+    }
+    double ns = std::chrono::duration<double, std::nano>(now - start).count();
+    return Result{name, ns / iterations,
+                  double(tAllocations - allocs0) / iterations,
+                  double(sim::semaphoreTakesThisThread() - takes0) / iterations};
+}
+
+static std::map<std::string, Result> readBaseline(const char* path) {
+    std::map<std::string, Result> out;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        // names may contain spaces, the three numbers are the last columns
+        size_t end = line.find_last_not_of(" \t\r");
+        size_t cut = end;
+        for (int col = 0; col < 3 && cut != std::string::npos; ++col) {
+            cut = line.find_last_of(" \t", cut);
+            if (cut != std::string::npos) cut = line.find_last_not_of(" \t", cut);
+        }
+        if (cut == std::string::npos) continue;
+        std::istringstream ls(line.substr(cut + 1));
+        Result r;
+        r.name = line.substr(0, cut + 1);
+        if (ls >> r.nsPerCall >> r.allocsPerCall >> r.takesPerCall) out[r.name] = r;
+    }
+    return out;
+}
+
+int main(int argc, char** argv) {
+    const char* baselinePath = nullptr;
+    const char* writePath = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--write" && i + 1 < argc) writePath = argv[++i];
+        else baselinePath = argv[i];
+    }
+
+    sim::setLogOutput(false);
+    sim::AccessPoint ap;
+    ap.ssid = "benchnet";
+    ap.bssid[5] = 0x01;
+    ap.channel = 6;
+    ap.rssi = -55;
+    sim::addAccessPoint(ap);
+    sim::setNtpEpoch(1720000000u);
+    sim::setTouchValue(4, 900);
+    sim::setTouchValue(5, 400);
+    sim::setTemperature(55.0f);
+
+    WiFiWrapper wifi("benchnet", "secret");
+    wifi.begin(true, false);
+    wifi.setAlwaysOn(true); // keep power-mode switching out of loop(); reconnects
+    wifi.waitForConnection();
+    TimeManager time;
+    time.begin();
+    TemperatureSafetyManager thermal(&wifi);
+    TouchSensor touch(4, 1200, 100, 3, 4);
+    TouchSensor touchRef(4, 1200, 100, 3, 4, 5);
+
+    // 8 pads sharing one reference pad, standalone vs. bank views
+    std::vector<TouchSensor> pads;
+    TouchSensorBank bank;
+    std::vector<TouchSensor> bankPads;
+    for (uint8_t p = 10; p < 18; ++p) {
+        sim::setTouchValue(p, 900);
+        pads.emplace_back(p, 1200, 100, 3, 4, 5);
+        bankPads.emplace_back(bank, p, 1200, 100, 3, 4, 5);
+    }
+
+    uint32_t epoch = time.getEpochTime();
+    uint32_t tick = 0;
+
+    std::vector<Result> results;
+    // touch pads: alternate the raw value so the filter does real work
+    results.push_back(measure("TouchSensor::update", [&] {
+        sim::setTouchValue(4, (++tick & 1) ? 900 : 1500);
+        touch.update();
+    }));
+    results.push_back(measure("TouchSensor::update+ref", [&] {
+        sim::setTouchValue(4, (++tick & 1) ? 900 : 1500);
+        touchRef.update();
+    }));
+    // filter stages alone, fed a noisy signal
+    EmaFilter ema(4);
+    BoxcarFilter<8> boxcar;
+    MedianFilter<5> median;
+    results.push_back(measure("EmaFilter::update", [&] { gSink += ema.update(1000 + ((++tick * 37) & 63)); }));
+    results.push_back(measure("BoxcarFilter<8>::update", [&] { gSink += boxcar.update(1000 + ((++tick * 37) & 63)); }));
+    results.push_back(measure("MedianFilter<5>::update", [&] { gSink += median.update(1000 + ((++tick * 37) & 63)); }));
+    results.push_back(measure("TouchSensor::update x8+ref", [&] {
+        ++tick;
+        sim::setTouchValue(10 + (tick & 7), (tick & 8) ? 900 : 1500);
+        for (TouchSensor& t : pads) t.update();
+    }));
+    results.push_back(measure("TouchSensorBank::update x8+ref", [&] {
+        ++tick;
+        sim::setTouchValue(10 + (tick & 7), (tick & 8) ? 900 : 1500);
+        bank.update();
+    }));
+    // same bank fed by the sampler task: update() only drains frames
+    TouchSampler sampler(bank);
+    sampler.start(5);
+    results.push_back(measure("TouchSensorBank::update sampled", [&] { bank.update(); }));
+    sampler.stop();
+    results.push_back(measure("WiFiWrapper::loop", [&] { wifi.loop(); }));
+    results.push_back(measure("WiFiWrapper::isConnected", [&] { gSink += wifi.isConnected(); }));
+    results.push_back(measure("WiFiWrapper::getWiFiStatus", [&] { gSink += wifi.getWiFiStatus(); }));
+    results.push_back(measure("WiFiWrapper::getSignalStrength", [&] { gSink += wifi.getSignalStrength(); }));
+    results.push_back(measure("WiFiWrapper::getChannel", [&] { gSink += wifi.getChannel(); }));
+    results.push_back(measure("WiFiWrapper::getBSSID", [&] { gSink += wifi.getBSSID().length(); }));
+    results.push_back(measure("WiFiWrapper::getSSID", [&] { gSink += wifi.getSSID().length(); }));
+    results.push_back(measure("WiFiWrapper::getLocalIP", [&] { gSink += wifi.getLocalIP().length(); }));
+    results.push_back(measure("WiFiWrapper::getConnectionSummary", [&] { gSink += wifi.getConnectionSummary().length(); }));
+    // heap-free variants, must stay at 0 allocs: a status line every few seconds
+    // for weeks must not fragment the heap
+    char buf[WiFiWrapper::summaryBufferSize];
+    results.push_back(measure("WiFiWrapper::getBSSID(buf)", [&] { gSink += wifi.getBSSID(buf, sizeof(buf)); }));
+    results.push_back(measure("WiFiWrapper::getSSID(buf)", [&] { gSink += wifi.getSSID(buf, sizeof(buf)); }));
+    results.push_back(measure("WiFiWrapper::getLocalIP(buf)", [&] { gSink += wifi.getLocalIP(buf, sizeof(buf)); }));
+    results.push_back(measure("WiFiWrapper::getConnectionSummary(buf)", [&] {
+        gSink += wifi.getConnectionSummary(buf, sizeof(buf));
+    }));
+    results.push_back(measure("TemperatureSafetyManager::loop", [&] { thermal.loop(); }));
+    results.push_back(measure("throttleCPU", [&] { gSink += throttleCPU(55.0f); }));
+    ThermalGovernor governor;
+    results.push_back(measure("ThermalGovernor::update", [&] { gSink += governor.update(55.0f, millis()); }));
+    OnDemandPolicy ondemand;
+    DvfsGovernor dvfs;
+    dvfs.setPolicy(&ondemand);
+    results.push_back(measure("DvfsGovernor::update", [&] { gSink += dvfs.update(millis()); }));
+    results.push_back(measure("dvfsBoost", [&] { dvfsBoost(200); }));
+    setCpuFrequencyMhz(240);
+    results.push_back(measure("TimeManager::isSynced", [&] { gSink += time.isSynced(); }));
+    results.push_back(measure("TimeManager::getHours", [&] { gSink += time.getHours(); }));
+    results.push_back(measure("TimeManager::getMinutes", [&] { gSink += time.getMinutes(); }));
+    results.push_back(measure("TimeManager::getSeconds", [&] { gSink += time.getSeconds(); }));
+    results.push_back(measure("TimeManager::getEpochTime", [&] { gSink += time.getEpochTime(); }));
+    results.push_back(measure("TimeManager::getSecondsOfDay", [&] { gSink += time.getSecondsOfDay(); }));
+    results.push_back(measure("TimeManager::getErrorBoundMs", [&] { gSink += time.getErrorBoundMs(); }));
+    results.push_back(measure("TimeManager::getFormattedTime", [&] { gSink += time.getFormattedTime().length(); }));
+    results.push_back(measure("TimeManager::formattedDateAndTime", [&] {
+        gSink += TimeManager::formattedDateAndTime(epoch + (++tick)).length();
+    }));
+    results.push_back(measure("TimeManager::getFormattedTime(buf)", [&] { gSink += time.getFormattedTime(buf, sizeof(buf)); }));
+    results.push_back(measure("TimeManager::formattedDateAndTime(buf)", [&] {
+        gSink += TimeManager::formattedDateAndTime(epoch + (++tick), buf, sizeof(buf));
+    }));
+
+    // telemetry
+    Counter& counter = metrics().counter("bench.counter");
+    Histogram& histogram = metrics().histogram("bench.histogram");
+    results.push_back(measure("Counter::add", [&] { counter.add(); }));
+    results.push_back(measure("Histogram::record", [&] { histogram.record(++tick & 0xFFF); }));
+    results.push_back(measure("Metrics::event", [&] { metrics().event(MetricEvent::None, (int32_t)++tick); }));
+    std::vector<uint8_t> snapshot(metrics().exportSize());
+    results.push_back(measure("Metrics::exportBinary", [&] {
+        gSink += metrics().exportBinary(snapshot.data(), snapshot.size());
+    }));
+
+    // deferred logging: the caller's cost is one queue push, formatting happens on the flush task
+    static MpscRing<DeferredLog::Record, DeferredLog::capacity> logQueue;
+    DeferredLog::Record record;
+    record.format = "[WiFiWrapper] Best AP: %02X:%02X:%02X:%02X:%02X:%02X ch=%d RSSI=%d seen %u ms ago";
+    record.argc = 9;
+    for (uint8_t i = 0; i < record.argc; ++i) record.args[i].u = i;
+    results.push_back(measure("DeferredLog push+pop", [&] {
+        logQueue.push(record);
+        logQueue.pop(record);
+    }));
+    results.push_back(measure("DeferredLog::format", [&] { gSink += DeferredLog::format(record, buf, sizeof(buf)); }));
+
+    std::map<std::string, Result> baseline;
+    if (baselinePath) baseline = readBaseline(baselinePath);
+
+    printf("%-40s %10s %10s %10s", "call", "ns/call", "allocs", "takes");
+    if (!baseline.empty()) printf(" %10s", "ns vs base");
+    printf("\n");
+    int regressions = 0;
+    for (const Result& r : results) {
+        printf("%-40s %10.1f %10.2f %10.2f", r.name.c_str(), r.nsPerCall, r.allocsPerCall, r.takesPerCall);
+        auto it = baseline.find(r.name);
+        if (it != baseline.end()) {
+            double delta = (r.nsPerCall / it->second.nsPerCall - 1.0) * 100.0;
+            bool worse = delta > 25.0 || r.allocsPerCall > it->second.allocsPerCall + 0.01 ||
+                         r.takesPerCall > it->second.takesPerCall + 0.01;
+            printf(" %+9.0f%%%s", delta, worse ? "  <-- regression" : "");
+            regressions += worse;
+        } else if (!baseline.empty()) {
+            // a renamed or new row would otherwise skip the gate without a word
+            printf(" %10s  <-- no baseline", "-");
+            regressions++;
+        }
+        printf("\n");
+    }
+
+    if (writePath) {
+        std::ofstream out(writePath);
+        out << "# bench_hotpaths baseline: name ns/call allocs/call semaphore-takes/call\n";
+        out << "# host numbers, regenerate with: bench_hotpaths --write host/bench/baseline.txt\n";
+        for (const Result& r : results) {
+            char line[160];
+            snprintf(line, sizeof(line), "%s %.1f %.2f %.2f\n", r.name.c_str(), r.nsPerCall, r.allocsPerCall, r.takesPerCall);
+            out << line;
+        }
+    }
+    return regressions ? 1 : 0;
+}
@@ -0,0 +1,179 @@
+// CivilTime against gmtime_r + snprintf, the path TimeManager's formatters used.
+//
+// 1. Equivalence: formatDateTime() and formatIso8601() must produce exactly the
+//    text gmtime_r + snprintf produce. By default: every day of the uint32 range
+//    at its first, middle and last second, every second of a few days (epoch,
+//    leap days, the last one) and 20 million random instants with random
+//    offsets. With --exhaustive every one of the 2^32 seconds, spread over all
+//    cores; that takes minutes.
+// 2. Speed of both paths, with time moving forward (date cache hits) and at
+//    random instants.
+//
+//   civil_time [--exhaustive]
+
+#include <CivilTime.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+static volatile size_t gSink;
+
+static size_t referenceDateTime(uint32_t t, char* buf, size_t len) {
+    struct tm tm;
+    time_t tt = t;
+    gmtime_r(&tt, &tm);
+    return (size_t)snprintf(buf, len, "%02d-%02d-%04d %02d:%02d:%02d", tm.tm_mday, tm.tm_mon + 1, tm.tm_year + 1900,
+                            tm.tm_hour, tm.tm_min, tm.tm_sec);
+}
+
+static size_t referenceIso(uint32_t t, int32_t offset, char* buf, size_t len) {
+    struct tm tm;
+    time_t tt = (time_t)t + offset;
+    gmtime_r(&tt, &tm);
+    int n = snprintf(buf, len, "%04d-%02d-%02dT%02d:%02d:%02d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+                     tm.tm_hour, tm.tm_min, tm.tm_sec);
+    if (offset == 0) {
+        return n + snprintf(buf + n, len - n, "Z");
+    }
+    uint32_t off = (uint32_t)(offset < 0 ? -offset : offset) / 60;
+    return n + snprintf(buf + n, len - n, "%c%02u:%02u", offset < 0 ? '-' : '+', off / 60, off % 60);
+}
+
+struct Checker {
+    uint64_t checks = 0;
+    uint64_t errors = 0;
+
+    void dateTime(uint32_t t) {
+        char mine[CivilTime::dateTimeSize], ref[CivilTime::dateTimeSize];
+        size_t a = CivilTime::formatDateTime(t, mine, sizeof(mine));
+        size_t b = referenceDateTime(t, ref, sizeof(ref));
+        checks++;
+        if (a != b || memcmp(mine, ref, a) != 0) report(t, 0, mine, ref);
+    }
+    void iso(uint32_t t, int32_t offset) {
+        char mine[CivilTime::isoSize], ref[CivilTime::isoSize];
+        size_t a = CivilTime::formatIso8601(t, offset, mine, sizeof(mine));
+        size_t b = referenceIso(t, offset, ref, sizeof(ref));
+        checks++;
+        if (a != b || memcmp(mine, ref, a) != 0) report(t, offset, mine, ref);
+    }
+    void report(uint32_t t, int32_t offset, const char* mine, const char* ref) {
+        if (errors++ < 5) printf("  %u%+d: \"%s\", expected \"%s\"\n", t, offset, mine, ref);
+    }
+};
+
+static void exhaustive() {
+    unsigned threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    std::atomic<uint64_t> checks{0}, errors{0};
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned w = 0; w < threads; ++w) {
+        workers.emplace_back([&, w] {
+            Checker c;
+            uint64_t from = (1ULL << 32) * w / threads;
+            uint64_t to = (1ULL << 32) * (w + 1) / threads;
+            for (uint64_t t = from; t < to; ++t) {
+                c.dateTime((uint32_t)t);
+                if (w == 0 && (t & 0x0FFFFFFF) == 0) {
+                    printf("  %3u%%\n", (unsigned)(t * 100 / to));
+                    fflush(stdout);
+                }
+            }
+            checks += c.checks;
+            errors += c.errors;
+        });
+    }
+    for (auto& t : workers) t.join();
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("formatDateTime, all 2^32 seconds on %u threads: %llu checks, %llu errors, %.0f s\n", threads,
+           (unsigned long long)checks.load(), (unsigned long long)errors.load(), s);
+}
+
+static uint64_t sampled() {
+    Checker c;
+    static const uint32_t lastDay = UINT32_MAX / 86400;
+    for (uint32_t day = 0; day <= lastDay; ++day) {
+        uint32_t t = day * 86400;
+        c.dateTime(t);
+        if (day < lastDay || UINT32_MAX - t >= 86399) {
+            c.dateTime(t + 43200);
+            c.dateTime(t + 86399);
+        }
+    }
+    // whole days: the epoch, Feb 29 2000 and 2104, the last one
+    const uint32_t days[] = {0, (uint32_t)CivilTime::daysFromCivil(2000, 2, 29),
+                             (uint32_t)CivilTime::daysFromCivil(2104, 2, 29), lastDay};
+    for (uint32_t day : days) {
+        for (uint32_t s = 0; s < 86400 && (uint64_t)day * 86400 + s <= UINT32_MAX; ++s) c.dateTime(day * 86400 + s);
+    }
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<uint32_t> any;
+    std::uniform_int_distribution<int32_t> offsets(-14 * 4, 14 * 4); // quarter hours
+    for (int i = 0; i < 10000000; ++i) c.dateTime(any(rng));
+    for (int i = 0; i < 10000000; ++i) {
+        int32_t offset = offsets(rng) * 900;
+        uint32_t t = any(rng);
+        if ((int64_t)t + offset < 0) continue;
+        c.iso(t, offset);
+    }
+    printf("sampled equivalence: %llu checks, %llu errors\n\n", (unsigned long long)c.checks,
+           (unsigned long long)c.errors);
+    return c.errors;
+}
+
+template<typename F>
+static double nsPerCall(F f) {
+    using clock = std::chrono::steady_clock;
+    uint64_t calls = 0;
+    auto start = clock::now();
+    auto end = start + std::chrono::milliseconds(300);
+    while (clock::now() < end) {
+        for (int i = 0; i < 1000; ++i) f(calls++);
+    }
+    return std::chrono::duration<double, std::nano>(clock::now() - start).count() / calls;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--exhaustive") == 0) {
+        exhaustive();
+        return 0;
+    }
+    uint64_t errors = sampled();
+
+    std::mt19937 rng(4);
+    std::uniform_int_distribution<uint32_t> any;
+    uint32_t randoms[4096];
+    for (uint32_t& r : randoms) r = any(rng);
+    const uint32_t now = 1720000000u;
+    char buf[CivilTime::isoSize];
+
+    printf("%-40s %10s\n", "", "ns/call");
+    printf("%-40s %10.1f\n", "gmtime_r + snprintf, forward",
+           nsPerCall([&](uint64_t i) { gSink += referenceDateTime(now + (uint32_t)i, buf, sizeof(buf)); }));
+    printf("%-40s %10.1f\n", "CivilTime::formatDateTime, forward",
+           nsPerCall([&](uint64_t i) { gSink += CivilTime::formatDateTime(now + (uint32_t)i, buf, sizeof(buf)); }));
+    printf("%-40s %10.1f\n", "gmtime_r + snprintf, random",
+           nsPerCall([&](uint64_t i) { gSink += referenceDateTime(randoms[i & 4095], buf, sizeof(buf)); }));
+    printf("%-40s %10.1f\n", "CivilTime::formatDateTime, random",
+           nsPerCall([&](uint64_t i) { gSink += CivilTime::formatDateTime(randoms[i & 4095], buf, sizeof(buf)); }));
+    printf("%-40s %10.1f\n", "gmtime_r + snprintf ISO 8601, forward",
+           nsPerCall([&](uint64_t i) { gSink += referenceIso(now + (uint32_t)i, 3600, buf, sizeof(buf)); }));
+    printf("%-40s %10.1f\n", "CivilTime::formatIso8601, forward",
+           nsPerCall([&](uint64_t i) { gSink += CivilTime::formatIso8601(now + (uint32_t)i, 3600, buf, sizeof(buf)); }));
+    printf("%-40s %10.1f\n", "gmtime_r alone, random", nsPerCall([&](uint64_t i) {
+               struct tm tm;
+               time_t t = randoms[i & 4095];
+               gmtime_r(&t, &tm);
+               gSink += tm.tm_mday;
+           }));
+    printf("%-40s %10.1f\n", "CivilTime::civilFromDays, random",
+           nsPerCall([&](uint64_t i) { gSink += CivilTime::civilFromDays(randoms[i & 4095] / 86400).day; }));
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,137 @@
+// A week on an oscillator that runs 20 ppm fast (21 ppm from day 4, as if it got
+// warmer), synced against a server with 10 ms of jitter each way. Compares:
+//
+//   hourly step   the old TimeManager: sync every hour, set the clock to the
+//                 result, extrapolate with the raw local clock in between
+//   discipline    ClockDiscipline: drift corrected, slewed, adaptive poll
+//
+// The error against true time and the discipline's error bound are sampled
+// every simulated minute. Simulated time is advanced with sim::advanceMillis(),
+// so a run takes a few seconds.
+//
+//   clock_discipline [days]     default 7
+
+#include <WiFiWrapper.h>
+#include <SntpClient.h>
+#include <ClockDiscipline.h>
+#include "Sim.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+static constexpr uint32_t sampleMs = 60 * 1000;
+
+struct Row {
+    const char* name;
+    uint32_t syncs = 0;
+    uint32_t steps = 0;
+    double maxErrMs = 0;
+    double sumErrMs = 0;
+    uint32_t samples = 0;
+    uint32_t outsideBound = 0;
+    uint32_t maxPollS = 0;
+    bool bounded = false; // has an error bound to check
+};
+
+static bool syncOnce(SntpClient& sntp, SntpResult& out) {
+    if (!sntp.start()) return false;
+    while (!sntp.poll()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    out = sntp.result();
+    return out.valid;
+}
+
+static Row run(const char* name, bool disciplined, uint32_t days) {
+    sim::setNtpEpoch(1720000000u);
+    sim::setClockDriftPpm(20);
+    SntpClient sntp;
+    sntp.addServer("jittery.sim");
+    ClockDiscipline discipline;
+    ClockModel stepped; // old behaviour: offset from the last sync, no frequency
+    Row row;
+    row.name = name;
+    row.bounded = disciplined;
+
+    uint64_t endMs = (uint64_t)days * 86400000ULL;
+    uint64_t elapsedMs = 0;
+    uint64_t nextSyncMs = 0;
+    bool warmed = false;
+    while (elapsedMs < endMs) {
+        if (!warmed && elapsedMs >= 3 * 86400000ULL) {
+            sim::setClockDriftPpm(21);
+            warmed = true;
+        }
+        if (elapsedMs >= nextSyncMs) {
+            SntpResult r;
+            if (syncOnce(sntp, r)) {
+                row.syncs++;
+                if (disciplined) {
+                    if (discipline.update(r.localUs, r.offsetUs, r.distanceUs) == ClockDiscipline::Action::Step) {
+                        row.steps++;
+                    }
+                } else {
+                    stepped.baseLocalUs = r.localUs;
+                    stepped.baseOffsetUs = r.offsetUs;
+                    row.steps++;
+                }
+            } else if (disciplined) {
+                discipline.missed();
+            }
+            uint32_t pollS = disciplined ? discipline.nextPollS() : 3600;
+            if (pollS > row.maxPollS) row.maxPollS = pollS;
+            nextSyncMs = elapsedMs + (uint64_t)pollS * 1000;
+        }
+
+        uint64_t stepMs = sampleMs;
+        if (nextSyncMs > elapsedMs && nextSyncMs - elapsedMs < stepMs) stepMs = nextSyncMs - elapsedMs;
+        sim::advanceMillis((uint32_t)stepMs);
+        elapsedMs += stepMs;
+
+        int64_t local = esp_timer_get_time();
+        const ClockModel& m = disciplined ? discipline.model() : stepped;
+        double errMs = std::fabs((double)(m.utcUs(local) - sim::trueUtcUs())) / 1000.0;
+        row.samples++;
+        row.sumErrMs += errMs;
+        if (errMs > row.maxErrMs) row.maxErrMs = errMs;
+        if (disciplined && errMs * 1000 > m.errorUs(local)) row.outsideBound++;
+    }
+    return row;
+}
+
+int main(int argc, char** argv) {
+    uint32_t days = argc > 1 ? (uint32_t)atoi(argv[1]) : 7;
+    sim::setLogOutput(false);
+    sim::AccessPoint ap;
+    ap.ssid = "simnet";
+    ap.bssid[5] = 0x01;
+    ap.channel = 6;
+    sim::addAccessPoint(ap);
+    sim::NtpServer server;
+    server.name = "jittery.sim";
+    server.roundTripMs = 30;
+    server.jitterMs = 10;
+    sim::addNtpServer(server);
+
+    WiFiWrapper wifi("simnet", "secret");
+    wifi.begin();
+
+    Row rows[] = {run("hourly step", false, days), run("discipline", true, days)};
+
+    printf("%u days, 20 ppm fast, 21 ppm from day 4, 10 ms jitter each way\n\n", days);
+    printf("%-12s %7s %7s %10s %12s %12s %14s\n", "", "syncs", "steps", "max poll s", "mean err ms", "max err ms",
+           "outside bound");
+    for (const Row& r : rows) {
+        printf("%-12s %7u %7u %10u %12.2f %12.2f", r.name, r.syncs, r.steps, r.maxPollS, r.sumErrMs / r.samples,
+               r.maxErrMs);
+        if (r.bounded) {
+            printf(" %8u of %u\n", r.outsideBound, r.samples);
+        } else {
+            printf(" %14s\n", "-");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,73 @@
+// stateMutex hold times with synchronous and deferred logging. WiFiWrapper
+// connects a few times through a scan of several APs while gLogger behaves like
+// a 115200 baud UART; first with DeferredLog not started (every log call prints
+// right away, under the mutex), then with its flush task running.
+//
+//   deferred_logging [baud]     default 115200
+
+#include <WiFiWrapper.h>
+#include <DeferredLog.h>
+#include "Sim.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+static constexpr int connects = 5;
+
+struct Row {
+    const char* name;
+    sim::HoldStats hold;
+    uint32_t connectMs;
+};
+
+static Row run(const char* name, bool deferred) {
+    sim::eraseNvs(); // no fast path, every connect scans
+    if (deferred) deferredLog().start();
+
+    Row row{name, {}, 0};
+    WiFiWrapper wifi("simnet", "secret");
+    wifi.setUsePersistedAP(false);
+    sim::resetSemaphoreHoldStats();
+    uint32_t start = millis();
+    for (int i = 0; i < connects; ++i) {
+        wifi.begin();
+        wifi.disconnect();
+    }
+    row.connectMs = (millis() - start) / connects;
+    row.hold = sim::semaphoreHoldStatsThisThread(); // not the flush task's own lock
+
+    if (deferred) deferredLog().stop();
+    return row;
+}
+
+int main(int argc, char** argv) {
+    uint32_t baud = argc > 1 ? (uint32_t)atoi(argv[1]) : 115200;
+    sim::setLogOutput(false);
+    sim::setLogBaudRate(baud);
+
+    sim::RadioTiming timing;
+    timing.scanMsPerChannel = 5;
+    timing.associateMs = 20;
+    timing.dhcpMs = 20;
+    sim::setRadioTiming(timing);
+    for (uint8_t i = 0; i < 6; ++i) {
+        sim::AccessPoint ap;
+        ap.ssid = "simnet";
+        ap.bssid[5] = i + 1;
+        ap.channel = 1 + 2 * i;
+        ap.rssi = -50 - 5 * i;
+        sim::addAccessPoint(ap);
+    }
+
+    Row rows[] = {run("synchronous", false), run("deferred", true)};
+
+    printf("%d connects through a scan of 6 APs, logger at %u baud\n\n", connects, baud);
+    printf("%-12s %8s %12s %12s %12s %12s\n", "logging", "holds", "total ms", "mean us", "max us", "connect ms");
+    for (const Row& r : rows) {
+        printf("%-12s %8llu %12.1f %12.1f %12llu %12u\n", r.name, (unsigned long long)r.hold.holds,
+               r.hold.totalUs / 1000.0, r.hold.holds ? (double)r.hold.totalUs / r.hold.holds : 0.0,
+               (unsigned long long)r.hold.maxUs, r.connectMs);
+    }
+    printf("\ndeferred records: %u logged, %u dropped\n", deferredLog().logged(), deferredLog().dropped());
+    return 0;
+}
@@ -0,0 +1,86 @@
+// DvfsGovernor policies on the same simulated workload: mostly idle, a 2 s
+// burst of 150 MHz worth of work every 10 s, and a boost request (as from a
+// touch or keepWiFiAwake()) every 7 s. The thermal model and a ThermalGovernor
+// provide the cap. Prints estimated energy, average clock, time the CPU was
+// saturated while a faster clock was allowed, and boost latency per policy.
+//
+//   dvfs_policies [ambient C]     default 35; try 60 to see the thermal cap bite
+
+#include <DvfsGovernor.h>
+#include <ThermalGovernor.h>
+#include "Sim.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+static constexpr uint32_t stepMs = 50;               // DvfsGovernor::update() period
+static constexpr uint32_t thermalEveryMs = 1000;     // ThermalGovernor::update() period
+static constexpr uint32_t durationMs = 10u * 60 * 1000;
+
+static float demandMhz(uint32_t t) {
+    return (t % 10000) < 2000 ? 150.0f : 8.0f;
+}
+
+struct Row {
+    const char* name;
+    DvfsStats stats;
+    float meanMhz;
+    float peakTemp;
+};
+
+static Row run(DvfsPolicy& policy, float ambient) {
+    setCpuFrequencyMhz(240);
+    uint32_t t0 = millis();
+    sim::setCpuDemand([t0](uint32_t now) { return demandMhz(now - t0); });
+    sim::ThermalModel model;
+    model.ambient = ambient;
+    model.initial = ambient + 10.0f;
+    sim::setThermalModel(model, [t0](uint32_t now) {
+        return demandMhz(now - t0) / (float)sim::cpuFrequencyMhz();
+    });
+
+    ThermalGovernor thermal;
+    DvfsGovernor dvfs(&thermal);
+    dvfs.setPolicy(&policy);
+    policy.resetStats();
+
+    double mhz = 0;
+    uint32_t n = 0;
+    float peak = 0;
+    for (uint32_t t = 0; t < durationMs; t += stepMs) {
+        if (t % 7000 == 3500) {
+            dvfsBoost(200); // lands between two updates, like a real request would
+        }
+        sim::advanceMillis(stepMs);
+        if (t % thermalEveryMs == 0) {
+            float temp = temperatureRead();
+            thermal.update(temp, millis());
+            if (temp > peak) peak = temp;
+        }
+        mhz += dvfs.update(millis());
+        n++;
+    }
+    sim::setCpuDemand(nullptr);
+    return Row{policy.name(), policy.stats(), (float)(mhz / n), peak};
+}
+
+int main(int argc, char** argv) {
+    sim::setLogOutput(false);
+    float ambient = argc > 1 ? atof(argv[1]) : 35.0f;
+
+    PerformancePolicy performance;
+    OnDemandPolicy ondemand;
+    PowersavePolicy powersave;
+    Row rows[] = {run(performance, ambient), run(ondemand, ambient), run(powersave, ambient)};
+
+    printf("ambient %.0f C, %u s, update every %u ms\n\n", ambient, durationMs / 1000, stepMs);
+    printf("%-12s %10s %9s %9s %12s %8s %14s %14s\n", "policy", "energy J", "mean MHz", "peak C",
+           "saturated s", "changes", "boost avg ms", "boost max ms");
+    for (const Row& r : rows) {
+        const DvfsStats& s = r.stats;
+        printf("%-12s %10.1f %9.1f %9.1f %12.1f %8u %14.1f %14u\n", r.name, s.energyMj / 1000.0f, r.meanMhz,
+               r.peakTemp, s.saturatedMs / 1000.0f, s.changes,
+               s.boosts ? (float)s.boostLatencyTotalMs / s.boosts : 0.0f, s.boostLatencyMaxMs);
+    }
+    return 0;
+}
@@ -0,0 +1,97 @@
+// Worst-case latency of WiFiWrapper status getters while another task keeps the
+// state machine busy. The connecting task reconnects through a scan of several
+// APs with gLogger at UART speed and DeferredLog not started, so stateMutex is
+// held for tens to hundreds of milliseconds at a time. A UI-like reader polls
+// every millisecond; getConnectStats() still takes the mutex the way every
+// getter used to, the status getters read the published snapshot.
+//
+//   getter_contention [seconds] [baud]     default 3 s, 9600 baud
+
+#include <WiFiWrapper.h>
+#include "Sim.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+
+struct Row {
+    const char* name;
+    const char* access;
+    std::function<void()> call;
+    uint64_t calls = 0;
+    uint64_t totalNs = 0;
+    uint64_t maxNs = 0;
+};
+
+static volatile uint32_t gSink;
+
+int main(int argc, char** argv) {
+    int seconds = argc > 1 ? atoi(argv[1]) : 3;
+    uint32_t baud = argc > 2 ? (uint32_t)atoi(argv[2]) : 9600;
+    sim::setLogOutput(false);
+    sim::setLogBaudRate(baud);
+
+    sim::RadioTiming timing;
+    timing.scanMsPerChannel = 5;
+    timing.associateMs = 20;
+    timing.dhcpMs = 20;
+    sim::setRadioTiming(timing);
+    for (uint8_t i = 0; i < 6; ++i) {
+        sim::AccessPoint ap;
+        ap.ssid = "simnet";
+        ap.bssid[5] = i + 1;
+        ap.channel = 1 + 2 * i;
+        ap.rssi = -50 - 5 * i;
+        sim::addAccessPoint(ap);
+    }
+
+    WiFiWrapper wifi("simnet", "secret");
+    wifi.setUsePersistedAP(false); // every connect scans
+    wifi.begin();
+
+    std::atomic<bool> running{true};
+    std::atomic<uint32_t> connects{0};
+    std::thread connecter([&] {
+        while (running.load()) {
+            wifi.disconnect();
+            wifi.begin();
+            wifi.loop();
+            connects++;
+        }
+    });
+
+    char buf[WiFiWrapper::summaryBufferSize];
+    Row rows[] = {
+        {"isConnected", "snapshot", [&] { gSink = wifi.isConnected(); }},
+        {"getSignalStrength", "snapshot", [&] { gSink = wifi.getSignalStrength(); }},
+        {"getConnectionSummary(buf)", "snapshot", [&] { gSink = wifi.getConnectionSummary(buf, sizeof(buf)); }},
+        {"getConnectStats", "mutex", [&] { gSink = wifi.getConnectStats().failures; }},
+    };
+
+    using clock = std::chrono::steady_clock;
+    auto end = clock::now() + std::chrono::seconds(seconds);
+    while (clock::now() < end) {
+        for (Row& r : rows) {
+            auto t0 = clock::now();
+            r.call();
+            uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t0).count();
+            r.calls++;
+            r.totalNs += ns;
+            if (ns > r.maxNs) r.maxNs = ns;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    running = false;
+    connecter.join();
+
+    printf("%u reconnects in %d s, logger at %u baud\n\n", connects.load(), seconds, baud);
+    printf("%-28s %-9s %8s %12s %12s\n", "getter", "access", "calls", "mean us", "max us");
+    for (const Row& r : rows) {
+        printf("%-28s %-9s %8llu %12.2f %12.1f\n", r.name, r.access, (unsigned long long)r.calls,
+               r.calls ? r.totalNs / 1000.0 / r.calls : 0.0, r.maxNs / 1000.0);
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+// Time to detect and to recover from scripted AP drops, with the driver events
+// delivered and with WiFi.status() polling only (sim::setWiFiEventsEnabled).
+// The sketch calls wifi.loop() once a second. Simulated time runs about 10x
+// faster than real time, so a run takes about half a minute.
+//
+//   detect   AP dropped until WiFiWrapper noticed (MetricEvent::WifiLost)
+//   recover  AP back until connected again (MetricEvent::WifiConnected)
+
+#include <WiFiWrapper.h>
+#include <Metrics.h>
+#include "Sim.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+static constexpr uint32_t loopPeriodMs = 1000;
+static constexpr uint32_t stepMs = 50;
+
+struct Drop {
+    uint32_t downMs;
+};
+
+static const Drop drops[] = {{2000}, {10000}, {45000}};
+
+// advances simulated time in small steps so the driver thread sees every change
+static void runFor(WiFiWrapper& wifi, uint32_t ms, uint32_t& sinceLoop) {
+    for (uint32_t t = 0; t < ms; t += stepMs) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        sim::advanceMillis(stepMs - 5);
+        sinceLoop += stepMs;
+        if (sinceLoop >= loopPeriodMs) {
+            sinceLoop = 0;
+            wifi.loop();
+        }
+    }
+}
+
+static bool findEvent(uint32_t since, MetricEvent type, uint32_t& at) {
+    MetricEventRecord records[Metrics::eventCapacity];
+    uint32_t n = metrics().events(since, records, Metrics::eventCapacity);
+    for (uint32_t i = 0; i < n; ++i) {
+        if (records[i].type == type) {
+            at = records[i].timeMs;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void run(const char* name, bool events, int ap) {
+    sim::setWiFiEventsEnabled(events);
+    sim::setAccessPointUp(ap, true);
+    WiFiWrapper wifi("simnet", "secret");
+    wifi.setUsePersistedAP(false);
+    wifi.begin();
+    uint32_t sinceLoop = 0;
+    runFor(wifi, 3000, sinceLoop);
+
+    printf("%s\n", name);
+    printf("  %-10s %10s %12s %10s\n", "drop ms", "detect ms", "recover ms", "attempts");
+    for (const Drop& d : drops) {
+        uint32_t since = metrics().eventCount();
+        uint32_t attempts = sim::radioStats().connectAttempts;
+        uint32_t downAt = millis();
+        sim::setAccessPointUp(ap, false);
+        runFor(wifi, d.downMs, sinceLoop);
+        uint32_t upAt = millis();
+        sim::setAccessPointUp(ap, true);
+        uint32_t lostAt = 0;
+        uint32_t connectedAt = 0;
+        uint32_t deadline = millis() + 180000;
+        while (!findEvent(since, MetricEvent::WifiConnected, connectedAt) && millis() < deadline) {
+            runFor(wifi, 100, sinceLoop);
+        }
+        bool lost = findEvent(since, MetricEvent::WifiLost, lostAt);
+        printf("  %-10u %10s %12d %10u\n", d.downMs, lost ? std::to_string(lostAt - downAt).c_str() : "missed",
+               connectedAt ? (int)(connectedAt - upAt) : -1, sim::radioStats().connectAttempts - attempts);
+        runFor(wifi, 3000, sinceLoop);
+    }
+}
+
+int main() {
+    sim::setLogOutput(false);
+    sim::RadioTiming timing;
+    timing.scanMsPerChannel = 20;
+    timing.associateMs = 100;
+    timing.dhcpMs = 100;
+    sim::setRadioTiming(timing);
+    sim::AccessPoint ap;
+    ap.ssid = "simnet";
+    ap.bssid[5] = 0x01;
+    ap.channel = 6;
+    int index = sim::addAccessPoint(ap);
+
+    run("driver events", true, index);
+    run("polling only", false, index);
+
+    Metrics& m = metrics();
+    for (uint8_t i = 0; i < m.histogramCount(); ++i) {
+        const Histogram& h = m.histogramAt(i);
+        if (h.count()) {
+            printf("%-18s n=%u avg=%u max=%u ms\n", m.histogramName(i), h.count(), h.sum() / h.count(), h.max());
+        }
+    }
+    return 0;
+}
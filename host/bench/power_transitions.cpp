@@ -0,0 +1,55 @@
+// Cost of WiFiWrapper power-mode transitions: keepWiFiAwake() on every request
+// followed by the idle drop to low power, as a busy sketch does all day. Counts
+// heap allocations made by the calling task, tasks created and the wall time
+// of a transition including the wait for the previous one to settle.
+//
+//   power_transitions [transitions]     default 200
+
+#include <WiFiWrapper.h>
+#include "Sim.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+static thread_local uint64_t tAllocations = 0;
+
+void* operator new(size_t size) {
+    tAllocations++;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+int main(int argc, char** argv) {
+    int transitions = argc > 1 ? atoi(argv[1]) : 200;
+    sim::setLogOutput(false);
+
+    WiFiWrapper wifi("simnet", "secret");
+    wifi.begin(false);
+
+    uint64_t allocs0 = tAllocations;
+    uint32_t tasks0 = sim::tasksCreated();
+    auto start = std::chrono::steady_clock::now();
+    double maxUs = 0;
+    for (int i = 0; i < transitions; ++i) {
+        auto t0 = std::chrono::steady_clock::now();
+        if (i & 1) {
+            wifi.configureLowPowerMode();
+        } else {
+            wifi.configureFullPowerMode();
+        }
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+        if (us > maxUs) maxUs = us;
+    }
+    double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%d transitions\n", transitions);
+    printf("  heap allocations per transition  %.2f\n", double(tAllocations - allocs0) / transitions);
+    printf("  tasks created per transition     %.2f\n", double(sim::tasksCreated() - tasks0) / transitions);
+    printf("  mean transition                  %.2f ms\n", totalMs / transitions);
+    printf("  max transition                   %.2f ms\n", maxUs / 1000.0);
+    return 0;
+}
@@ -0,0 +1,262 @@
+// Scheduler on a synced TimeManager.
+//
+// 1. A simulated year (2024, leap): Berlin until November, then New York.
+//    runDue() is called the way the dispatcher task calls it, with simulated
+//    time jumped forward to each deadline (sim::advanceMillis), and one second
+//    after each DST change the snapshot is moved on like _syncTask would.
+//    Checked: daily 03:00 and 02:30 (gap in March, twice in October), weekly
+//    Mon/Wed/Fri 07:15, a 22:00-07:00 window and a 10 minute interval run at
+//    the right local time, once per day, none skipped, across both DST changes
+//    and the timezone change.
+// 2. Cost per application loop iteration: polling getSecondsUntilWeHit() and
+//    isInBetween() for every job against one idle runDue() (with the task, the
+//    loop does nothing at all).
+// 3. The dispatcher task in real time: how late interval and one-shot jobs run.
+
+#include <WiFiWrapper.h>
+#include <TimeManager.h>
+#include <Scheduler.h>
+#include "Sim.h"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+static TimeManager* gTime;
+static volatile uint32_t gSink;
+
+struct WallCheck {
+    const char* name;
+    uint8_t days;
+    uint32_t secondOfDay; // local
+    uint32_t runs = 0;
+    uint32_t shifted = 0; // ran an hour late because DST skipped the time
+    uint32_t errors = 0;
+    int64_t lastDay = -1;
+};
+
+static void wallJob(void* arg) {
+    auto c = static_cast<WallCheck*>(arg);
+    uint32_t local = gTime->getEpochTime();
+    int64_t day = local / 86400;
+    c->runs++;
+    if (local % 86400 == c->secondOfDay + 3600) {
+        c->shifted++;
+    } else if (local % 86400 != c->secondOfDay) {
+        if (c->errors++ < 3) printf("  %s ran at %s\n", c->name, gTime->getFormattedDateAndTime(local).c_str());
+    }
+    if (c->lastDay >= 0) {
+        int64_t expected = c->lastDay + 1;
+        while (!(c->days & (1 << CivilTime::weekday(expected)))) ++expected;
+        if (day != expected && c->errors++ < 3) {
+            printf("  %s ran on %s, expected day %lld\n", c->name, gTime->getFormattedDateAndTime(local).c_str(),
+                   (long long)expected);
+        }
+    }
+    c->lastDay = day;
+}
+
+struct WindowCheck {
+    uint32_t opens = 0;
+    uint32_t closes = 0;
+    uint32_t errors = 0;
+    bool open = false;
+};
+
+static void nightWindow(bool open, void* arg) {
+    auto c = static_cast<WindowCheck*>(arg);
+    uint32_t second = gTime->getEpochTime() % 86400;
+    // the first call comes right away, the window was added while open
+    bool first = c->opens + c->closes == 0;
+    bool ok = open != c->open && (first || second == (open ? 22u * 3600 : 7u * 3600));
+    if (!ok && c->errors++ < 3) {
+        printf("  window %s at %s\n", open ? "opened" : "closed",
+               gTime->getFormattedDateAndTime(gTime->getEpochTime()).c_str());
+    }
+    c->open = open;
+    (open ? c->opens : c->closes)++;
+}
+
+struct IntervalCheck {
+    uint32_t runs = 0;
+    int64_t last = 0;
+    int64_t maxDeviationUs = 0;
+};
+
+static void interval(void* arg) {
+    auto c = static_cast<IntervalCheck*>(arg);
+    int64_t now = esp_timer_get_time();
+    if (c->runs++ > 0) {
+        int64_t dev = now - c->last - 600 * 1000000LL;
+        if (dev < 0) dev = -dev;
+        if (dev > c->maxDeviationUs) c->maxDeviationUs = dev;
+    }
+    c->last = now;
+}
+
+static uint32_t simulatedYear() {
+    const char* newYork = "EST5EDT,M3.2.0,M11.1.0";
+    Scheduler scheduler(*gTime);
+    WallCheck at3{"daily 03:00", Scheduler::everyDay, 3 * 3600};
+    WallCheck at230{"daily 02:30", Scheduler::everyDay, 2 * 3600 + 1800};
+    WallCheck mwf{"Mon/Wed/Fri 07:15", Scheduler::monday | Scheduler::wednesday | Scheduler::friday,
+                  7 * 3600 + 15 * 60};
+    WindowCheck night;
+    IntervalCheck tenMinutes;
+    scheduler.daily(3, 0, &wallJob, &at3);
+    scheduler.daily(2, 30, &wallJob, &at230);
+    scheduler.weekly(mwf.days, 7, 15, &wallJob, &mwf);
+    Scheduler::JobId window = scheduler.window(Scheduler::everyDay, 22, 0, 7, 0, &nightWindow, &night);
+    scheduler.every(10 * MINUTE, &interval, &tenMinutes);
+
+    Timezone tz(Timezone::berlin);
+    uint32_t utc = gTime->getUnixUTCTime();
+    const uint32_t switchAt = utc + 305 * 86400 + 12 * 3600; // Nov 1, 12:00 UTC
+    const uint32_t end = utc + 366 * 86400;
+    uint32_t pendingChange = tz.nextTransition(utc);
+    uint32_t calls = 0, wakeups = 0;
+    bool switched = false;
+    while (utc < end) {
+        int64_t waitUs = scheduler.runDue();
+        calls++;
+        if (waitUs == 0) {
+            continue;
+        }
+        utc = gTime->getUnixUTCTime();
+        // what _syncTask does one second after a DST change
+        if (utc > pendingChange) {
+            gTime->setTimezone(switched ? newYork : Timezone::berlin);
+            pendingChange = tz.nextTransition(utc);
+            continue;
+        }
+        if (!switched && utc >= switchAt) {
+            gTime->setTimezone(newYork);
+            tz.set(newYork);
+            pendingChange = tz.nextTransition(utc);
+            switched = true;
+            continue;
+        }
+        int64_t capUs = ((int64_t)(switched ? pendingChange : (pendingChange < switchAt ? pendingChange : switchAt)) +
+                         1 - utc) * 1000000;
+        if (waitUs > capUs) waitUs = capUs;
+        if (waitUs < 1000) waitUs = 1000;
+        sim::advanceMillis((uint32_t)((waitUs + 999) / 1000));
+        wakeups++;
+    }
+
+    printf("a simulated year, Berlin then New York (from Nov 1): %u runDue() calls, %u wake-ups, %.1f per day\n",
+           calls, wakeups, wakeups / 366.0);
+    uint32_t errors = 0;
+    for (WallCheck* c : {&at3, &at230, &mwf}) {
+        printf("  %-20s %4u runs %2u after a DST gap %3u errors\n", c->name, c->runs, c->shifted, c->errors);
+        errors += c->errors;
+    }
+    printf("  %-20s %4u opens %4u closes %3u errors, open now: %d\n", "window 22:00-07:00", night.opens,
+           night.closes, night.errors, scheduler.isOpen(window));
+    printf("  %-20s %5u runs, interval off by at most %lld us\n", "every 10 min", tenMinutes.runs,
+           (long long)tenMinutes.maxDeviationUs);
+    errors += night.errors;
+    // 366 days; the 02:30 run is an hour late on the day Berlin skips it
+    if (at3.runs < 365 || at230.runs < 365 || at230.shifted != 1 || night.opens < 365 || mwf.runs < 156) {
+        printf("  MISSING RUNS\n");
+        errors++;
+    }
+    printf("  %s\n\n", errors ? "MISMATCH" : "all on time");
+    return errors;
+}
+
+template<typename F>
+static double nsPerCall(F f) {
+    using clock = std::chrono::steady_clock;
+    uint64_t calls = 0;
+    auto start = clock::now();
+    auto end = start + std::chrono::milliseconds(300);
+    while (clock::now() < end) {
+        for (int i = 0; i < 100; ++i) f(calls++);
+    }
+    return std::chrono::duration<double, std::nano>(clock::now() - start).count() / calls;
+}
+
+static void nothing(void*) {}
+static void nothingWindow(bool, void*) {}
+
+static void loopCost() {
+    printf("%-44s %10s\n", "per loop iteration, 16 jobs", "ns");
+    printf("%-44s %10.1f\n", "polling getSecondsUntilWeHit / isInBetween", nsPerCall([](uint64_t) {
+               for (int j = 0; j < 12; ++j) gSink += gTime->getSecondsUntilWeHit(j, 30) == 0;
+               for (int j = 0; j < 4; ++j) gSink += gTime->isInBetween(20 + j, 6);
+           }));
+    Scheduler scheduler(*gTime);
+    for (int j = 0; j < 12; ++j) scheduler.daily(j, 30, &nothing);
+    for (int j = 0; j < 4; ++j) scheduler.window(Scheduler::everyDay, 20 + j, 0, 6, 0, &nothingWindow);
+    while (scheduler.runDue() == 0) {
+    }
+    printf("%-44s %10.1f\n", "Scheduler::runDue, nothing due", nsPerCall([&](uint64_t) { gSink += scheduler.runDue() > 0; }));
+    printf("\n");
+}
+
+struct Lateness {
+    int64_t expected = 0;
+    int64_t period = 0;
+    uint32_t runs = 0;
+    int64_t maxLateUs = 0;
+    int64_t sumLateUs = 0;
+};
+
+static void late(void* arg) {
+    auto l = static_cast<Lateness*>(arg);
+    int64_t lateUs = esp_timer_get_time() - l->expected;
+    if (lateUs > l->maxLateUs) l->maxLateUs = lateUs;
+    l->sumLateUs += lateUs;
+    l->runs++;
+    l->expected += l->period;
+}
+
+static void realTime() {
+    Scheduler scheduler(*gTime);
+    Lateness every{}, once{};
+    every.period = 20000;
+    every.expected = esp_timer_get_time() + every.period;
+    scheduler.every(20, &late, &every);
+    scheduler.start();
+    for (int i = 0; i < 20; ++i) {
+        once.expected = esp_timer_get_time() + 30000;
+        scheduler.after(30, &late, &once);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    scheduler.stop();
+    printf("dispatcher task, real time\n");
+    printf("  every 20 ms: %u runs, late %.2f ms on average, %.2f ms at most\n", every.runs,
+           every.sumLateUs / 1000.0 / every.runs, every.maxLateUs / 1000.0);
+    printf("  after 30 ms: %u runs, late %.2f ms on average, %.2f ms at most\n", once.runs,
+           once.sumLateUs / 1000.0 / once.runs, once.maxLateUs / 1000.0);
+}
+
+int main() {
+    sim::setLogOutput(false);
+    sim::AccessPoint ap;
+    ap.ssid = "simnet";
+    ap.bssid[5] = 0x01;
+    ap.channel = 6;
+    sim::addAccessPoint(ap);
+    sim::setNtpEpoch(1704067200u); // 2024-01-01 00:00 UTC
+
+    WiFiWrapper wifi("simnet", "secret");
+    wifi.begin();
+    TimeManager time;
+    gTime = &time;
+    time.begin();
+    if (!time.isSynced()) {
+        printf("TimeManager did not sync\n");
+        return 1;
+    }
+    // let _syncTask go to sleep (64 s, real time) before simulated time races
+    // ahead, or its next round trip would appear to take weeks
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    uint32_t errors = simulatedYear();
+    time.setTimezone(Timezone::berlin);
+    loopCost();
+    realTime();
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,153 @@
+// SNTP against the simulator's stand-in servers (sim::addNtpServer).
+//
+// 1. One SntpClient round over a good stratum 1, a fast stratum 2, a
+//    falseticker 5 s off, an asymmetric slow link and a server that is down:
+//    per server offset, delay and root distance, which one won, and how far the
+//    chosen offset is from true time.
+// 2. Replies RFC 4330 section 5 says to discard: a zero transmit timestamp
+//    (server not synchronized) and a transmit timestamp before the receive
+//    timestamp. Neither may become a sample; exits with 1 if one does.
+// 3. TimeManager syncing over a slow (800 ms) link while another thread reads
+//    getEpochTime() every millisecond: worst case getter latency during the sync.
+
+#include <WiFiWrapper.h>
+#include <TimeManager.h>
+#include <SntpClient.h>
+#include "Sim.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+static volatile uint32_t gSink;
+
+static void selection() {
+    struct Script {
+        const char* note;
+        sim::NtpServer server;
+    };
+    Script scripts[] = {
+        {"stratum 1", {"gps.sim", 1, 0, 60, 0.5f}},
+        {"stratum 2, close", {"near.sim", 2, 0, 8, 0.5f}},
+        {"falseticker +5 s", {"bad.sim", 1, 5000, 10, 0.5f}},
+        {"asymmetric 300 ms", {"far.sim", 2, 0, 300, 0.9f}},
+        {"down", {"dead.sim", 2, 0, 40, 0.5f, 0, false}},
+    };
+
+    SntpClient sntp;
+    for (Script& s : scripts) {
+        sim::addNtpServer(s.server);
+    }
+    // the client takes four; show the falseticker and the asymmetric link, leave one down
+    const int used[] = {0, 2, 3, 4};
+    for (int i : used) {
+        sntp.addServer(scripts[i].server.name.c_str());
+    }
+
+    uint32_t requests = sim::ntpRequests();
+    auto start = std::chrono::steady_clock::now();
+    sntp.start();
+    uint32_t polls = 1;
+    while (!sntp.poll()) {
+        vTaskDelay(TimeManager::syncPollTicks); // as _syncTask does
+        polls++;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    const SntpResult& r = sntp.result();
+    int64_t trueOffsetUs = sim::trueUtcUs() - esp_timer_get_time();
+
+    printf("one round, %u requests, %u polls, %.0f ms\n", sim::ntpRequests() - requests, polls, ms);
+    printf("  %-10s %-20s %8s %12s %10s %12s  %s\n", "server", "script", "stratum", "offset err ms", "delay ms",
+           "distance ms", "");
+    for (uint8_t i = 0; i < sntp.serverCount(); ++i) {
+        const SntpSample& s = sntp.sample(i);
+        const char* verdict = !s.valid ? "no reply" : s.outlier ? "outlier" : i == r.server && r.valid ? "chosen" : "";
+        if (!s.valid) {
+            printf("  %-10s %-20s %8s %12s %10s %12s  %s\n", sntp.serverName(i), scripts[used[i]].note, "-", "-", "-",
+                   "-", verdict);
+            continue;
+        }
+        double errMs = (s.offsetUs - trueOffsetUs) / 1000.0;
+        printf("  %-10s %-20s %8u %12.2f %10.1f %12.1f  %s\n", sntp.serverName(i), scripts[used[i]].note, s.stratum,
+               errMs, s.delayUs / 1000.0, s.distanceUs / 1000.0, verdict);
+    }
+    if (r.valid) {
+        printf("  result: %s, %u replies, %u outliers, error %.2f ms\n\n", sntp.serverName(r.server), r.replies,
+               r.outliers, (r.offsetUs - trueOffsetUs) / 1000.0);
+    } else {
+        printf("  result: none\n\n");
+    }
+}
+
+static bool unusableReplies() {
+    sim::NtpServer zero{"unsynced.sim", 2, 0, 20, 0.5f};
+    zero.zeroTransmit = true;
+    sim::NtpServer backwards{"backwards.sim", 2, 0, 20, 0.5f};
+    backwards.processingUs = -20000;
+    sim::addNtpServer(zero);
+    sim::addNtpServer(backwards);
+
+    SntpClient sntp;
+    sntp.addServer("unsynced.sim");
+    sntp.addServer("backwards.sim");
+    sntp.addServer("good.sim");
+    sntp.start();
+    while (!sntp.poll()) {
+        vTaskDelay(TimeManager::syncPollTicks);
+    }
+    const SntpResult& r = sntp.result();
+    bool ok = !sntp.sample(0).valid && !sntp.sample(1).valid && sntp.sample(2).valid && r.valid && r.server == 2;
+    printf("unusable replies\n");
+    printf("  zero transmit timestamp   %s\n", sntp.sample(0).valid ? "accepted" : "discarded");
+    printf("  transmit before receive   %s\n", sntp.sample(1).valid ? "accepted" : "discarded");
+    printf("  result: %s, %u replies: %s\n\n", r.valid ? sntp.serverName(r.server) : "none", r.replies,
+           ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+static void getterLatency() {
+    sim::setNtpRoundTripMs(800);
+    TimeManager time;
+    time.addNtpServer("slow.sim");
+
+    std::atomic<bool> running{true};
+    uint64_t calls = 0;
+    uint64_t maxNs = 0;
+    std::thread reader([&] {
+        using clock = std::chrono::steady_clock;
+        while (running.load()) {
+            auto t0 = clock::now();
+            gSink = time.getEpochTime();
+            uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t0).count();
+            if (ns > maxNs) maxNs = ns;
+            calls++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+    auto start = std::chrono::steady_clock::now();
+    time.begin(); // first sync, the round trip takes 800 ms
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    running = false;
+    reader.join();
+
+    printf("TimeManager sync over an 800 ms round trip took %.0f ms (synced=%d)\n", ms, time.isSynced());
+    printf("  getEpochTime() meanwhile: %llu calls, max %.1f us\n", (unsigned long long)calls, maxNs / 1000.0);
+}
+
+int main() {
+    sim::setLogOutput(false);
+    sim::AccessPoint ap;
+    ap.ssid = "simnet";
+    ap.bssid[5] = 0x01;
+    ap.channel = 6;
+    sim::addAccessPoint(ap);
+    sim::setNtpEpoch(1720000000u);
+
+    WiFiWrapper wifi("simnet", "secret");
+    wifi.begin();
+    selection();
+    bool ok = unusableReplies();
+    getterLatency();
+    return ok ? 0 : 1;
+}
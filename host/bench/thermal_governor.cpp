@@ -0,0 +1,110 @@
+// ThermalGovernor vs. the linear throttleCPU() mapping, both driving the
+// simulator's first-order thermal model through an hour of bursty load
+// (simulated time, runs in well under a second). Prints temperature spread,
+// clock changes and average clock for each controller.
+//
+//   thermal_governor [setpoint]
+//
+// The "@mean" row runs the governor with its setpoint at the mean temperature
+// the linear map ended up at.
+
+#include <ThermalGovernor.h>
+#include <throttle.h>
+#include "Sim.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+
+struct Run {
+    const char* name;
+    float meanTemp = 0;
+    float stdTemp = 0;
+    float peakTemp = 0;
+    float aboveMs = 0;    // time above setpoint + 5 °C
+    float meanMhz = 0;
+    uint32_t changes = 0;
+};
+
+static constexpr uint32_t stepMs = 250;             // sampling period of the controller
+static constexpr uint32_t durationMs = 3600u * 1000;
+
+// bursts: 20 s of full load every 45 s, light background load otherwise
+static float burstyLoad(uint32_t t) {
+    return (t % 45000) < 20000 ? 1.0f : 0.25f;
+}
+
+static Run simulate(const char* name, float setpoint, const std::function<void(float, uint32_t)>& control) {
+    setCpuFrequencyMhz(240);
+    sim::ThermalModel model;
+    model.ambient = 35.0f;
+    model.riseAt240 = 65.0f; // 100 °C at sustained full load and full clock
+    model.tauMs = 40000;
+    model.initial = 60.0f;
+    uint32_t t0 = millis();
+    sim::setThermalModel(model, [t0](uint32_t now) { return burstyLoad(now - t0); });
+
+    Run r;
+    r.name = name;
+    uint32_t changes0 = sim::cpuFrequencyChanges();
+    double sum = 0, sumSq = 0, mhz = 0;
+    uint32_t n = 0;
+    for (uint32_t t = 0; t < durationMs; t += stepMs) {
+        sim::advanceMillis(stepMs);
+        float temp = temperatureRead();
+        control(temp, millis());
+        if (t < 600000) {
+            continue; // skip the first 10 minutes while things settle
+        }
+        sum += temp;
+        sumSq += (double)temp * temp;
+        mhz += sim::cpuFrequencyMhz();
+        r.peakTemp = std::max(r.peakTemp, temp);
+        if (temp > setpoint + 5.0f) r.aboveMs += stepMs;
+        n++;
+    }
+    r.meanTemp = sum / n;
+    r.stdTemp = std::sqrt(std::max(0.0, sumSq / n - (sum / n) * (sum / n)));
+    r.meanMhz = mhz / n;
+    r.changes = sim::cpuFrequencyChanges() - changes0;
+    return r;
+}
+
+int main(int argc, char** argv) {
+    sim::setLogOutput(false);
+    float setpoint = argc > 1 ? atof(argv[1]) : 80.0f;
+
+    // the linear map is centred on the setpoint over its default 20 °C span
+    Run legacy = simulate("throttleCPU (linear)", setpoint, [&](float temp, uint32_t) {
+        throttleCPU(temp, setpoint - 10.0f, setpoint + 10.0f);
+    });
+
+    ThermalGovernor::Config config;
+    config.setpoint = setpoint;
+    ThermalGovernor governor(config);
+    Run pid = simulate("ThermalGovernor (PID)", setpoint, [&](float temp, uint32_t now) {
+        governor.update(temp, now);
+    });
+
+    // same average temperature as the linear map, to compare clock and flapping like for like
+    ThermalGovernor::Config matched = config;
+    matched.setpoint = legacy.meanTemp;
+    ThermalGovernor governorMatched(matched);
+    Run pidMatched = simulate("ThermalGovernor (PID) @mean", legacy.meanTemp, [&](float temp, uint32_t now) {
+        governorMatched.update(temp, now);
+    });
+
+    printf("setpoint %.1f C, %u s of bursty load, %u ms control period\n\n", setpoint, durationMs / 1000, stepMs);
+    printf("%-28s %9s %9s %9s %11s %9s %9s\n", "controller", "mean C", "std C", "peak C", "s >sp+5C", "mean MHz", "changes");
+    for (const Run& r : {legacy, pid, pidMatched}) {
+        printf("%-28s %9.2f %9.2f %9.2f %11.0f %9.1f %9u\n", r.name, r.meanTemp, r.stdTemp, r.peakTemp,
+               r.aboveMs / 1000.0f, r.meanMhz, r.changes);
+    }
+    printf("\ntime in P-state (governor): ");
+    for (uint8_t i = 0; i < ThermalGovernor::numPStates; ++i) {
+        printf("%u MHz %.0f s  ", ThermalGovernor::pStates[i], governor.timeInPState(i) / 1000.0f);
+    }
+    printf("\n");
+    return 0;
+}
@@ -0,0 +1,131 @@
+// TimeManager getters read by several tasks while another one keeps publishing.
+// N reader threads call the snapshot getters back to back; a writer republishes
+// the snapshot as fast as it can through setTimezone() (the same publish() the
+// sync task runs after every SNTP round). Prints mean and worst getter latency
+// with and without the writer, and how often a read overlapped a publish and
+// had to copy again (getSnapshotRetries()). With more threads than host cores
+// the worst case is mostly the host scheduler's time slice.
+//
+//   time_contention [readers] [ms per run]     default 4 readers, 500 ms
+
+#include <WiFiWrapper.h>
+#include <TimeManager.h>
+#include "Sim.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+#include <vector>
+
+static volatile uint32_t gSink;
+
+struct Getter {
+    const char* name;
+    std::function<void(TimeManager&)> call;
+};
+
+struct Result {
+    uint64_t calls = 0;
+    uint64_t totalNs = 0;
+    uint64_t maxNs = 0;
+};
+
+static Result run(TimeManager& time, const Getter& g, unsigned readers, bool writer, int ms, uint32_t& publishes,
+                  uint32_t& retries) {
+    using clock = std::chrono::steady_clock;
+    std::atomic<bool> running{true};
+    std::vector<Result> results(readers);
+    std::vector<std::thread> threads;
+    uint32_t retriesBefore = time.getSnapshotRetries();
+    publishes = 0;
+    for (unsigned r = 0; r < readers; ++r) {
+        threads.emplace_back([&, r] {
+            Result& res = results[r];
+            while (running.load(std::memory_order_relaxed)) {
+                auto t0 = clock::now();
+                g.call(time);
+                uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t0).count();
+                res.calls++;
+                res.totalNs += ns;
+                if (ns > res.maxNs) res.maxNs = ns;
+            }
+        });
+    }
+    std::thread publisher;
+    if (writer) {
+        publisher = std::thread([&] {
+            // same offsets, different rule text: every call republishes
+            const char* zones[] = {Timezone::berlin, "CET-1CEST,M3.5.0/2,M10.5.0/3"};
+            while (running.load(std::memory_order_relaxed)) {
+                time.setTimezone(zones[publishes & 1]);
+                publishes++;
+            }
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    running = false;
+    for (auto& t : threads) t.join();
+    if (publisher.joinable()) publisher.join();
+    retries = time.getSnapshotRetries() - retriesBefore;
+
+    Result total;
+    for (const Result& r : results) {
+        total.calls += r.calls;
+        total.totalNs += r.totalNs;
+        total.maxNs = std::max(total.maxNs, r.maxNs);
+    }
+    return total;
+}
+
+int main(int argc, char** argv) {
+    unsigned readers = argc > 1 ? (unsigned)atoi(argv[1]) : 4;
+    int ms = argc > 2 ? atoi(argv[2]) : 500;
+    if (readers == 0) readers = 1;
+    sim::setLogOutput(false);
+    sim::AccessPoint ap;
+    ap.ssid = "simnet";
+    ap.bssid[5] = 0x01;
+    ap.channel = 6;
+    sim::addAccessPoint(ap);
+
+    WiFiWrapper wifi("simnet", "secret");
+    wifi.begin();
+    TimeManager time;
+    time.begin();
+    if (!time.isSynced()) {
+        printf("TimeManager did not sync\n");
+        return 1;
+    }
+
+    const Getter getters[] = {
+        {"getUnixUTCMicros", [](TimeManager& t) { gSink += (uint32_t)t.getUnixUTCMicros(); }},
+        {"getEpochTime", [](TimeManager& t) { gSink += t.getEpochTime(); }},
+        {"getSecondsUntilWeHit", [](TimeManager& t) { gSink += t.getSecondsUntilWeHit(3, 0); }},
+        {"getFormattedTime(buf)", [](TimeManager& t) {
+             char local[TimeManager::formattedTimeSize];
+             gSink += t.getFormattedTime(local, sizeof(local));
+         }},
+        {"getIso8601(buf)", [](TimeManager& t) {
+             char local[TimeManager::iso8601Size];
+             gSink += t.getIso8601(local, sizeof(local));
+         }},
+    };
+
+    printf("%u readers, %d ms per run, %u host cores\n\n", readers, ms, std::thread::hardware_concurrency());
+    printf("%-22s %-7s %10s %9s %9s %10s %10s %12s\n", "getter", "writer", "calls", "mean ns", "max us",
+           "publishes", "retries", "retries/1k");
+    for (const Getter& g : getters) {
+        for (bool writer : {false, true}) {
+            uint32_t publishes = 0, retries = 0;
+            Result r = run(time, g, readers, writer, ms, publishes, retries);
+            printf("%-22s %-7s %10llu %9.1f %9.1f %10u %10u %12.3f\n", g.name, writer ? "yes" : "no",
+                   (unsigned long long)r.calls, r.calls ? (double)r.totalNs / r.calls : 0.0, r.maxNs / 1000.0,
+                   publishes, retries, r.calls ? retries * 1000.0 / r.calls : 0.0);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,139 @@
+// Timezone against the host C library.
+//
+// 1. Correctness: for several POSIX TZ strings, the offset from
+//    Timezone::offsetAt() is compared with localtime_r()'s tm_gmtoff every hour
+//    from 2000 to 2100, one second either side of every transition Timezone
+//    reports, and at random instants (which miss the cached segment).
+// 2. Speed: offsetAt() with time moving forward and at random instants, next to
+//    the Berlin-only isSummerTime() TimeManager used to have (gmtime_r + timegm)
+//    and localtime_r().
+//
+//   timezone [seconds per timing]     default 0.3
+
+#include <Timezone.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <time.h>
+
+static const char* zones[] = {
+    Timezone::berlin,
+    "EST5EDT,M3.2.0,M11.1.0",
+    "AEST-10AEDT,M10.1.0,M4.1.0/3", // southern hemisphere
+    "NZST-12NZDT,M9.5.0,M4.1.0/3",
+    "WGT3WGST,M3.5.0/-2,M10.5.0/-1", // negative transition times
+    "<-03>3<-02>,M3.5.0/-2,M10.5.0/-1",
+    "IST-5:30",                      // no DST, half hour
+    "<+0545>-5:45",
+    "XST3XDT,J60/1,300/25",          // Julian rules, time past midnight
+};
+// DST without rules ("EST5EDT") is left out: glibc then takes the rules from
+// its posixrules file, which has the US history, not the current rule.
+
+static const uint32_t from2000 = 946684800u;  // 2000-01-01
+static const uint32_t until2101 = 4133980800u; // 2101-01-01
+
+static volatile int64_t gSink;
+
+static int32_t libcOffset(uint32_t utc) {
+    time_t t = utc;
+    struct tm tm;
+    localtime_r(&t, &tm);
+    return (int32_t)tm.tm_gmtoff;
+}
+
+static uint32_t check(const char* zone) {
+    setenv("TZ", zone, 1);
+    tzset();
+    Timezone tz;
+    if (!tz.set(zone)) {
+        printf("  %-34s does not parse\n", zone);
+        return 1;
+    }
+    uint32_t checks = 0, errors = 0;
+    auto compare = [&](uint32_t utc) {
+        checks++;
+        int32_t mine = tz.offsetAt(utc);
+        int32_t libc = libcOffset(utc);
+        if (mine != libc && errors++ < 3) {
+            printf("  %-34s %u: %d, libc %d\n", zone, utc, mine, libc);
+        }
+    };
+    for (uint32_t t = from2000; t < until2101; t += 3600) compare(t);
+    uint32_t transitions = 0;
+    for (uint32_t t = tz.nextTransition(from2000); t < until2101; t = tz.nextTransition(t)) {
+        compare(t - 1);
+        compare(t);
+        transitions++;
+    }
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<uint32_t> any(from2000, until2101 - 1);
+    for (int i = 0; i < 200000; ++i) compare(any(rng));
+
+    printf("  %-34s %7u transitions %9u checks %6u errors\n", zone, transitions, checks, errors);
+    return errors;
+}
+
+// what TimeManager::isSummerTime() did, for the comparison
+static bool legacyIsSummerTime(uint32_t rawTime) {
+    struct tm timeInfo;
+    time_t t = rawTime;
+    gmtime_r(&t, &timeInfo);
+    int year = timeInfo.tm_year + 1900;
+    int month = timeInfo.tm_mon + 1;
+    int day = timeInfo.tm_mday;
+    if (month < 3 || month > 10) return false;
+    if (month > 3 && month < 10) return true;
+    struct tm t31 = {};
+    t31.tm_year = year - 1900;
+    t31.tm_mon = month - 1;
+    t31.tm_mday = 31;
+    t31.tm_hour = 12;
+    time_t ts31 = timegm(&t31);
+    int wday31 = ((ts31 / 86400UL) + 4) % 7;
+    int lastSunday = 31 - ((wday31 + 6) % 7);
+    return month == 3 ? day >= lastSunday : day < lastSunday;
+}
+
+template<typename F>
+static double nsPerCall(double seconds, F f) {
+    using clock = std::chrono::steady_clock;
+    uint64_t calls = 0;
+    auto start = clock::now();
+    auto end = start + std::chrono::duration<double>(seconds);
+    while (clock::now() < end) {
+        for (int i = 0; i < 1000; ++i) f(calls++);
+    }
+    return std::chrono::duration<double, std::nano>(clock::now() - start).count() / calls;
+}
+
+int main(int argc, char** argv) {
+    double seconds = argc > 1 ? atof(argv[1]) : 0.3;
+
+    printf("offsets 2000-2100 against localtime_r\n");
+    uint32_t errors = 0;
+    for (const char* zone : zones) errors += check(zone);
+    printf("  %s\n\n", errors ? "MISMATCH" : "all equal");
+
+    setenv("TZ", Timezone::berlin, 1);
+    tzset();
+    Timezone tz(Timezone::berlin);
+    std::mt19937 rng(2);
+    std::uniform_int_distribution<uint32_t> any(from2000, until2101 - 1);
+    uint32_t randoms[4096];
+    for (uint32_t& r : randoms) r = any(rng);
+    const uint32_t now = 1720000000u;
+
+    printf("%-36s %10s\n", "Berlin offset", "ns/call");
+    printf("%-36s %10.1f\n", "Timezone::offsetAt, forward",
+           nsPerCall(seconds, [&](uint64_t i) { gSink += tz.offsetAt(now + (uint32_t)i); }));
+    printf("%-36s %10.1f\n", "Timezone::offsetAt, random",
+           nsPerCall(seconds, [&](uint64_t i) { gSink += tz.offsetAt(randoms[i & 4095]); }));
+    printf("%-36s %10.1f\n", "legacy isSummerTime (gmtime+timegm)",
+           nsPerCall(seconds, [&](uint64_t i) { gSink += legacyIsSummerTime(now + (uint32_t)i); }));
+    printf("%-36s %10.1f\n", "localtime_r",
+           nsPerCall(seconds, [&](uint64_t i) { gSink += libcOffset(now + (uint32_t)i); }));
+    return errors ? 1 : 0;
+}
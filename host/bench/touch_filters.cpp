@@ -0,0 +1,176 @@
+// Step response of the TouchFilters.h stages, against the integer average
+// TouchSensor used before them, (n * last + x) / (n + 1) from 0.
+//
+// Each filter is primed on a base level, then fed a constant step up or down.
+// Checked, for several base levels and step sizes:
+//   EmaFilter(n)      reaches the new level exactly, up and down alike (no
+//                     downward bias), within the samples the exponential takes
+//                     to get within half a count, plus two
+//   BoxcarFilter<N>   after k samples reads base + step * k / N, rounded, and
+//                     the new level from sample N on
+//   MedianFilter<K>   holds the base for K/2 samples and jumps to the new level
+//                     at sample K/2 + 1; a burst of K/2 samples leaves it alone
+// Exits with 1 on any mismatch.
+
+#include <TouchFilters.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+static uint32_t gErrors;
+
+static void fail(const char* filter, uint16_t base, int step, const char* what, int sample, int got, int want) {
+    if (gErrors++ < 10) {
+        printf("  %s, %u %+d: %s at sample %d: %d, expected %d\n", filter, base, step, what, sample, got, want);
+    }
+}
+
+// what TouchSensor::update() did until the fixed-point stages
+static uint16_t legacyAverage(uint16_t last, uint16_t x, uint16_t n) {
+    return (n * last + x) / (n + 1);
+}
+
+static const uint16_t bases[] = {0, 40, 1000, 30000, 65000};
+static const int steps[] = {1, 2, 5, 15, 16, 100, 500};
+
+// samples until EmaFilter sits on the new level; 0 if it never gets there
+static int emaSettle(uint8_t n, uint16_t base, int step, int limit) {
+    EmaFilter f(n);
+    f.update(base);
+    uint16_t target = (uint16_t)(base + step);
+    for (int k = 1; k <= limit; ++k) {
+        uint16_t v = f.update(target);
+        if (v == target) {
+            // and it stays there
+            for (int i = 0; i < 4 * (n + 1); ++i) {
+                if (f.update(target) != target) return 0;
+            }
+            return k;
+        }
+        bool overshoot = step > 0 ? v > target : v < target;
+        if (overshoot) return 0;
+    }
+    return 0;
+}
+
+static void checkEma() {
+    const uint8_t ns[] = {0, 1, 3, 4, 7, 15, 31, 63, 255};
+    printf("%-18s %5s %9s %9s\n", "EmaFilter", "step", "up", "down");
+    for (uint8_t n : ns) {
+        double alpha = EmaFilter::alphaFor(n) / (double)EmaFilter::one;
+        for (int step : steps) {
+            // within half a count after k samples: step * (1 - alpha)^k < 0.5
+            int bound = (int)std::ceil(std::log(2.0 * step) / -std::log(1.0 - alpha)) + 2;
+            if (alpha >= 1.0) bound = 1;
+            int up = 0, down = 0;
+            for (uint16_t base : bases) {
+                if (base + step <= 0xFFFF) {
+                    up = emaSettle(n, base, step, 10 * bound);
+                    if (up == 0 || up > bound) fail("EmaFilter", base, step, "settled up", up, up, bound);
+                }
+                if (base >= step) {
+                    down = emaSettle(n, base, -step, 10 * bound);
+                    if (down == 0 || down > bound) fail("EmaFilter", base, -step, "settled down", down, down, bound);
+                }
+            }
+            if (step == 1 || step == 5 || step == 100) {
+                char name[24];
+                snprintf(name, sizeof(name), "  n = %u", n);
+                printf("%-18s %5d %9d %9d\n", name, step, up, down);
+            }
+        }
+    }
+}
+
+template<uint8_t N>
+static void checkBoxcar(const char* name) {
+    for (uint16_t base : bases) {
+        for (int s : steps) {
+            for (int step : {s, -s}) {
+                if (base + step < 0 || base + step > 0xFFFF) continue;
+                BoxcarFilter<N> f;
+                f.update(base);
+                uint16_t target = (uint16_t)(base + step);
+                for (int k = 1; k <= 2 * N; ++k) {
+                    int got = f.update(target);
+                    int kk = k < N ? k : N;
+                    // (sum + N / 2) / N, the sum being exact
+                    int want = (int)(((int64_t)base * (N - kk) + (int64_t)target * kk + N / 2) / N);
+                    if (got != want) {
+                        fail(name, base, step, "value", k, got, want);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    printf("%-18s settles after %u samples\n", name, N);
+}
+
+template<uint8_t K>
+static void checkMedian(const char* name) {
+    for (uint16_t base : bases) {
+        for (int s : steps) {
+            for (int step : {s, -s}) {
+                if (base + step < 0 || base + step > 0xFFFF) continue;
+                uint16_t target = (uint16_t)(base + step);
+                MedianFilter<K> f;
+                f.update(base);
+                for (int k = 1; k <= 2 * K; ++k) {
+                    int got = f.update(target);
+                    int want = k <= K / 2 ? base : target;
+                    if (got != want) {
+                        fail(name, base, step, "value", k, got, want);
+                        break;
+                    }
+                }
+                // a burst of K/2 samples is rejected
+                MedianFilter<K> g;
+                g.update(base);
+                for (int k = 1; k <= 2 * K; ++k) {
+                    int got = g.update(k <= K / 2 ? target : base);
+                    if (got != base) {
+                        fail(name, base, step, "burst", k, got, base);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    printf("%-18s settles after %u samples, rejects bursts of %u\n", name, K / 2 + 1, K / 2);
+}
+
+static void legacy() {
+    // from boot: the old average started at 0 and stopped n counts short
+    uint16_t last = 0;
+    for (int i = 0; i < 1000; ++i) last = legacyAverage(last, 1000, 15);
+    EmaFilter f(15);
+    for (int i = 0; i < 1000; ++i) f.update(1000);
+    printf("\nconstant 1000 from boot, n = 15: integer average %u, EmaFilter %u\n", last, f.value());
+    if (f.value() != 1000) fail("EmaFilter", 0, 1000, "from boot", 1000, f.value(), 1000);
+
+    // a 5-count step once settled: the old one never moved
+    last = 1000;
+    for (int i = 0; i < 1000; ++i) last = legacyAverage(last, 1005, 15);
+    int settle = emaSettle(15, 1000, 5, 1000);
+    printf("1000 -> 1005, n = 15: integer average %u after 1000 samples, EmaFilter %s %d samples\n", last,
+           settle ? "1005 after" : "not there after", settle ? settle : 1000);
+    if (settle == 0) fail("EmaFilter", 1000, 5, "settled up", 1000, 0, 1005);
+}
+
+int main() {
+    checkEma();
+    printf("\n");
+    checkBoxcar<1>("BoxcarFilter<1>");
+    checkBoxcar<4>("BoxcarFilter<4>");
+    checkBoxcar<8>("BoxcarFilter<8>");
+    checkBoxcar<10>("BoxcarFilter<10>");
+    checkMedian<1>("MedianFilter<1>");
+    checkMedian<3>("MedianFilter<3>");
+    checkMedian<5>("MedianFilter<5>");
+    checkMedian<9>("MedianFilter<9>");
+    legacy();
+    printf("\n%s, %u errors\n", gErrors ? "MISMATCH" : "all filters settle", gErrors);
+    return gErrors ? 1 : 0;
+}
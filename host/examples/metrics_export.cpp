@@ -0,0 +1,129 @@
+// Runs the managers through a short scenario, then exports the metrics registry
+// in its binary format and decodes it again the way a collector would, mapping
+// the name ids back through Metrics::nameId().
+
+#include <WiFiWrapper.h>
+#include <TimeManager.h>
+#include <TemperatureSafetyManager.h>
+#include <TouchSensor.h>
+#include <Metrics.h>
+#include "Sim.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+static uint32_t get32(const uint8_t*& p) {
+    uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    p += 4;
+    return v;
+}
+
+static uint16_t get16(const uint8_t*& p) {
+    uint16_t v = p[0] | (p[1] << 8);
+    p += 2;
+    return v;
+}
+
+static const char* eventName(uint16_t type) {
+    switch ((MetricEvent)type) {
+        case MetricEvent::None:              return "none";
+        case MetricEvent::WifiConnected:     return "wifi connected";
+        case MetricEvent::WifiConnectFailed: return "wifi connect failed";
+        case MetricEvent::WifiLost:          return "wifi lost";
+        case MetricEvent::WifiRoam:          return "wifi roam";
+        case MetricEvent::WifiPowerMode:     return "wifi power mode";
+        case MetricEvent::CpuFrequency:      return "cpu frequency";
+        case MetricEvent::ThermalLevel:      return "thermal level";
+        case MetricEvent::ThermalShutdown:   return "thermal shutdown";
+        case MetricEvent::TimeSync:          return "time sync";
+        case MetricEvent::TimeSyncFailed:    return "time sync failed";
+        case MetricEvent::TouchPress:        return "touch press";
+    }
+    return "?";
+}
+
+int main() {
+    sim::setLogOutput(false);
+    sim::AccessPoint ap;
+    ap.ssid = "simnet";
+    ap.bssid[5] = 0x01;
+    ap.channel = 6;
+    int mainAP = sim::addAccessPoint(ap);
+    sim::setNtpEpoch(1720000000u);
+
+    WiFiWrapper wifi("simnet", "secret");
+    TimeManager time;
+    TemperatureSafetyManager thermal(&wifi);
+    TouchSensor touch(4, 1200, 100, 3, 4);
+
+    wifi.begin();
+    time.begin();
+    sim::setTouchValue(4, 2000);
+    for (int i = 0; i < 20; ++i) touch.update();
+    for (float t : {70.0f, 88.0f, 92.0f, 92.0f, 80.0f, 70.0f}) {
+        sim::setTemperature(t);
+        for (int i = 0; i < 4; ++i) {
+            sim::advanceMillis(30000);
+            thermal.manageTemperatureSafety();
+        }
+    }
+    sim::setAccessPointUp(mainAP, false);
+    delay(20); // the driver's disconnect event arrives, wifi.detect_ms starts there
+    sim::advanceMillis(61 * 1000);
+    wifi.loop();
+
+    // a collector only knows the names it cares about
+    std::map<uint32_t, std::string> names;
+    Metrics& m = metrics();
+    for (uint8_t i = 0; i < m.counterCount(); ++i) names[Metrics::nameId(m.counterName(i))] = m.counterName(i);
+    for (uint8_t i = 0; i < m.gaugeCount(); ++i) names[Metrics::nameId(m.gaugeName(i))] = m.gaugeName(i);
+    for (uint8_t i = 0; i < m.histogramCount(); ++i) names[Metrics::nameId(m.histogramName(i))] = m.histogramName(i);
+
+    std::vector<uint8_t> buf(m.exportSize());
+    size_t len = m.exportBinary(buf.data(), buf.size());
+    printf("snapshot: %zu bytes\n", len);
+
+    const uint8_t* p = buf.data();
+    if (get32(p) != Metrics::exportMagic) {
+        printf("bad magic\n");
+        return 1;
+    }
+    uint32_t uptime = get32(p);
+    uint8_t nc = *p++, ng = *p++, nh = *p++, nb = *p++;
+    uint32_t ne = get32(p);
+    printf("uptime %u ms, %u counters, %u gauges, %u histograms, %u events\n", uptime, nc, ng, nh, ne);
+    for (uint8_t i = 0; i < nc; ++i) {
+        uint32_t id = get32(p);
+        uint32_t v = get32(p);
+        printf("  counter   %-24s %u\n", names[id].c_str(), v);
+    }
+    for (uint8_t i = 0; i < ng; ++i) {
+        uint32_t id = get32(p);
+        int32_t v = (int32_t)get32(p);
+        printf("  gauge     %-24s %d\n", names[id].c_str(), v);
+    }
+    for (uint8_t i = 0; i < nh; ++i) {
+        uint32_t id = get32(p);
+        uint32_t sum = get32(p);
+        uint32_t max = get32(p);
+        uint32_t count = 0;
+        std::string buckets;
+        for (uint8_t b = 0; b < nb; ++b) {
+            uint32_t c = get32(p);
+            count += c;
+            if (c) buckets += " <" + std::to_string(Histogram::bucketLow(b + 1)) + "ms:" + std::to_string(c);
+        }
+        printf("  histogram %-24s n=%u avg=%u max=%u%s\n", names[id].c_str(), count, count ? sum / count : 0, max,
+               buckets.c_str());
+    }
+    for (uint32_t i = 0; i < ne; ++i) {
+        uint32_t seq = get32(p);
+        uint32_t at = get32(p);
+        uint16_t type = get16(p);
+        get16(p);
+        int32_t value = (int32_t)get32(p);
+        printf("  event #%-3u %8u ms  %-20s %d\n", seq, at, eventName(type), value);
+    }
+    return 0;
+}
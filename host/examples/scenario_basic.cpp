@@ -0,0 +1,71 @@
+// Walks every manager through a scripted day-in-the-life on the host:
+// WiFi connect, NTP sync, a touch press, a thermal excursion and an AP drop.
+
+#include <WiFiWrapper.h>
+#include <TimeManager.h>
+#include <TemperatureSafetyManager.h>
+#include <TouchSensor.h>
+#include <throttle.h>
+#include "Sim.h"
+
+int main() {
+    sim::AccessPoint ap;
+    ap.ssid = "simnet";
+    ap.bssid[5] = 0x01;
+    ap.channel = 6;
+    ap.rssi = -58;
+    int mainAP = sim::addAccessPoint(ap);
+    ap.bssid[5] = 0x02;
+    ap.channel = 11;
+    ap.rssi = -71;
+    sim::addAccessPoint(ap);
+    sim::setNtpEpoch(1720000000u); // 2024-07-03 09:46:40 UTC
+
+    WiFiWrapper wifi("simnet", "secret");
+    TimeManager time;
+    TemperatureSafetyManager thermal(&wifi);
+    TouchSensor touch(4, 1200, 100, 3, 4);
+
+    wifi.begin();
+    time.begin();
+    thermal.begin();
+    printf("\n== connected: %s\n", wifi.getConnectionSummary().c_str());
+    printf("== time: %s (synced=%d)\n",
+           TimeManager::formattedDateAndTime(time.getEpochTime()).c_str(), time.isSynced());
+
+    // touch press
+    sim::setTouchValue(4, 800);
+    for (int i = 0; i < 20; ++i) touch.update();
+    sim::setTouchValue(4, 2000);
+    for (int i = 0; i < 20; ++i) touch.update();
+    printf("== touch active=%d value=%u\n", touch.isActive(), touch.lastValue());
+
+    // thermal excursion: climb to 96 C and back through the mitigation ladder
+    const float ramp[] = {60, 75, 85, 91, 96, 92, 84, 70};
+    for (float t : ramp) {
+        sim::setTemperature(t);
+        for (int i = 0; i < 4; ++i) { // 30 s apart: past the spike filter and the dwell times
+            sim::advanceMillis(30000);
+            thermal.manageTemperatureSafety();
+        }
+        printf("== %.0f C: level=%u cpu=%u MHz wifiDisabled=%d lowPower=%d\n", t,
+               thermal.getMitigationLevel(), sim::cpuFrequencyMhz(), thermal.isWifiDisabled(),
+               thermal.isLowPowerMode());
+    }
+
+    // AP drop, loop() notices at the next reconnect check
+    wifi.begin();
+    sim::setAccessPointUp(mainAP, false);
+    sim::advanceMillis(61 * 1000);
+    wifi.loop(); // notices the drop and starts reconnecting
+    for (int i = 0; i < 2000 && wifi.getConnectionState() != WiFiWrapper::ConnectionState::Connected; ++i) {
+        delay(10);
+        wifi.loop();
+    }
+    printf("== after AP drop: %s\n", wifi.getConnectionSummary().c_str());
+
+    sim::RadioStats rs = sim::radioStats();
+    printf("== radio: %u scans, %u ms scan airtime, %u connect attempts\n",
+           rs.scans, rs.scanAirtimeMs, rs.connectAttempts);
+    return 0;
+}
@@ -0,0 +1,127 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Host stand-in for the parts of the ESP32 Arduino core used by this library.
+// Everything here is backed by the simulator in host/sim, see host/README.md
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <sys/time.h>
+#include <time.h>
+#include <cstdlib>
+#include <string>
+#include <algorithm>
+
+#include "esp_err.h"
+#include "esp_sleep.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+using std::abs;
+
+#ifndef constrain
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#endif
+
+// never touch the host clock: settimeofday() and adjtime() are redirected into the simulator
+int sim_settimeofday(const struct timeval* tv, const void* tz);
+#define settimeofday sim_settimeofday
+int sim_adjtime(const struct timeval* delta, struct timeval* olddelta);
+#define adjtime sim_adjtime
+
+class String {
+public:
+    String() {}
+    String(const char* s) : s_(s ? s : "") {}
+    String(const std::string& s) : s_(s) {}
+    String(char c) : s_(1, c) {}
+    String(int v) : s_(std::to_string(v)) {}
+    String(unsigned int v) : s_(std::to_string(v)) {}
+    String(long v) : s_(std::to_string(v)) {}
+    String(unsigned long v) : s_(std::to_string(v)) {}
+    String(float v, unsigned int decimals = 2) { fromDouble(v, decimals); }
+    String(double v, unsigned int decimals = 2) { fromDouble(v, decimals); }
+
+    const char* c_str() const { return s_.c_str(); }
+    unsigned int length() const { return s_.length(); }
+    bool isEmpty() const { return s_.empty(); }
+    long toInt() const { return atol(s_.c_str()); }
+    float toFloat() const { return (float)atof(s_.c_str()); }
+    int indexOf(char c, unsigned int from = 0) const {
+        size_t p = s_.find(c, from);
+        return p == std::string::npos ? -1 : (int)p;
+    }
+    String substring(unsigned int from, unsigned int to = 0xFFFFFFFFu) const {
+        if (from > s_.size()) return String();
+        return String(s_.substr(from, to == 0xFFFFFFFFu ? std::string::npos : to - from));
+    }
+    void reserve(unsigned int n) { s_.reserve(n); }
+
+    String& operator+=(const String& o) { s_ += o.s_; return *this; }
+    String& operator+=(const char* o) { s_ += (o ? o : ""); return *this; }
+    String& operator+=(char c) { s_ += c; return *this; }
+    String& operator+=(int v) { s_ += std::to_string(v); return *this; }
+    String& operator+=(unsigned int v) { s_ += std::to_string(v); return *this; }
+    String& operator+=(long v) { s_ += std::to_string(v); return *this; }
+    String& operator+=(unsigned long v) { s_ += std::to_string(v); return *this; }
+    String& concat(const String& o) { return (*this += o); }
+
+    friend String operator+(String a, const String& b) { a += b; return a; }
+    friend String operator+(String a, const char* b) { a += b; return a; }
+
+    bool operator==(const String& o) const { return s_ == o.s_; }
+    bool operator!=(const String& o) const { return s_ != o.s_; }
+    bool operator==(const char* o) const { return s_ == (o ? o : ""); }
+    bool operator!=(const char* o) const { return !(*this == o); }
+    char operator[](unsigned int i) const { return i < s_.size() ? s_[i] : 0; }
+
+private:
+    void fromDouble(double v, unsigned int decimals) {
+        char buf[48];
+        snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+        s_ = buf;
+    }
+    std::string s_;
+};
+
+class IPAddress {
+public:
+    IPAddress() : addr_(0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+        : addr_((uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24)) {}
+    IPAddress(uint32_t addr) : addr_(addr) {}
+    operator uint32_t() const { return addr_; }
+    uint8_t operator[](int i) const { return (uint8_t)(addr_ >> (8 * i)); }
+    bool operator==(const IPAddress& o) const { return addr_ == o.addr_; }
+    bool operator!=(const IPAddress& o) const { return addr_ != o.addr_; }
+    String toString() const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+        return String(buf);
+    }
+private:
+    uint32_t addr_;
+};
+
+static const IPAddress INADDR_NONE(0, 0, 0, 0);
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+
+float temperatureRead();
+bool setCpuFrequencyMhz(uint32_t cpu_freq_mhz);
+uint32_t getCpuFrequencyMhz();
+
+uint32_t esp_random();
+
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define IRAM_ATTR
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,28 @@
+#ifndef HOST_LOGGING_BASE_H
+#define HOST_LOGGING_BASE_H
+
+#include <Arduino.h>
+
+// minimal stand-in for the LoggingBase interface of the logging library,
+// prints to stdout unless muted via sim::setLogOutput(false)
+class LoggingBase {
+public:
+    virtual ~LoggingBase() {}
+    virtual void print(const char* s);
+    void print(const String& s) { print(s.c_str()); }
+    void print(char c) { char b[2] = {c, 0}; print(b); }
+    void print(int v) { print(String(v)); }
+    void print(unsigned int v) { print(String(v)); }
+    void print(long v) { print(String(v)); }
+    void print(unsigned long v) { print(String(v)); }
+    void print(float v) { print(String(v)); }
+    void print(double v) { print(String(v)); }
+
+    void println() { print("\n"); }
+    template<typename T>
+    void println(const T& v) { print(v); print("\n"); }
+};
+
+extern LoggingBase* gLogger;
+
+#endif // HOST_LOGGING_BASE_H
@@ -0,0 +1,29 @@
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+#include <Arduino.h>
+
+// in-memory NVS stand-in; contents live for the process lifetime, which is
+// what a simulated "reboot" (re-creating the managers) needs
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false, const char* partition_label = nullptr);
+    void end();
+    bool clear();
+    bool remove(const char* key);
+    bool isKey(const char* key);
+    size_t putBytes(const char* key, const void* value, size_t len);
+    size_t getBytes(const char* key, void* buf, size_t maxLen);
+    size_t getBytesLength(const char* key);
+    size_t putUInt(const char* key, uint32_t value);
+    uint32_t getUInt(const char* key, uint32_t defaultValue = 0);
+    size_t putString(const char* key, const char* value);
+    String getString(const char* key, const String& defaultValue = String());
+
+private:
+    std::string ns_;
+    bool open_ = false;
+    bool readOnly_ = false;
+};
+
+#endif // HOST_PREFERENCES_H
@@ -0,0 +1,12 @@
+#ifndef HOST_TIME_PROVIDER_BASE_H
+#define HOST_TIME_PROVIDER_BASE_H
+
+#include <Arduino.h>
+
+// minimal stand-in for the TimeProviderBase interface of the logging library
+class TimeProviderBase {
+public:
+    virtual ~TimeProviderBase() {}
+};
+
+#endif // HOST_TIME_PROVIDER_BASE_H
@@ -0,0 +1,44 @@
+#ifndef HOST_WIFI_UDP_H
+#define HOST_WIFI_UDP_H
+
+#include <Arduino.h>
+#include <vector>
+
+// UDP socket on the simulated network (host/sim/Network.cpp): datagrams only go
+// out while the STA is connected, replies arrive after the scripted latency and
+// are picked up with parsePacket(), which never blocks.
+class WiFiUDP {
+public:
+    WiFiUDP() {}
+    ~WiFiUDP() { stop(); }
+
+    uint8_t begin(uint16_t port);
+    void stop();
+
+    int beginPacket(IPAddress ip, uint16_t port);
+    int beginPacket(const char* host, uint16_t port);
+    size_t write(uint8_t byte) { return write(&byte, 1); }
+    size_t write(const uint8_t* buffer, size_t size);
+    int endPacket();
+
+    // size of the next datagram that has arrived, 0 if none
+    int parsePacket();
+    int available() const { return (int)(rx_.size() - rxPos_); }
+    int read(uint8_t* buffer, size_t len);
+    int read() { uint8_t b; return read(&b, 1) == 1 ? b : -1; }
+    void flush() { rx_.clear(); rxPos_ = 0; }
+    IPAddress remoteIP() const { return remoteIP_; }
+    uint16_t remotePort() const { return remotePort_; }
+
+private:
+    int socket_ = -1;
+    IPAddress txIP_;
+    uint16_t txPort_ = 0;
+    std::vector<uint8_t> tx_;
+    std::vector<uint8_t> rx_;
+    size_t rxPos_ = 0;
+    IPAddress remoteIP_;
+    uint16_t remotePort_ = 0;
+};
+
+#endif // HOST_WIFI_UDP_H
@@ -0,0 +1,7 @@
+#ifndef HOST_DRIVER_TOUCH_PAD_H
+#define HOST_DRIVER_TOUCH_PAD_H
+
+#include "esp_err.h"
+#include <stdint.h>
+
+#endif // HOST_DRIVER_TOUCH_PAD_H
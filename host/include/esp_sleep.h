@@ -0,0 +1,12 @@
+#ifndef HOST_ESP_SLEEP_H
+#define HOST_ESP_SLEEP_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// the simulator records sleep requests instead of halting; esp_deep_sleep_start() returns
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us);
+void esp_deep_sleep_start();
+esp_err_t esp_light_sleep_start();
+
+#endif // HOST_ESP_SLEEP_H
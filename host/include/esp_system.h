@@ -0,0 +1,10 @@
+#ifndef HOST_ESP_SYSTEM_H
+#define HOST_ESP_SYSTEM_H
+
+#include "esp_err.h"
+#include <stdint.h>
+
+uint32_t esp_random();
+void esp_restart();
+
+#endif // HOST_ESP_SYSTEM_H
@@ -0,0 +1,30 @@
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+// Host stand-in for the FreeRTOS subset used by this library, backed by
+// std::thread / std::timed_mutex (host/sim/FreeRTOS.cpp). One tick is one ms.
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define portMAX_DELAY      ((TickType_t)0xFFFFFFFFu)
+#define portTICK_PERIOD_MS ((TickType_t)1)
+#define pdMS_TO_TICKS(ms)  ((TickType_t)(ms))
+#define pdTRUE             1
+#define pdFALSE            0
+#define pdPASS             1
+#define pdFAIL             0
+#define tskIDLE_PRIORITY   0
+#define tskNO_AFFINITY     0x7FFFFFFF
+#define portNUM_PROCESSORS 2
+
+// run time stats are on, counted in microseconds (esp_timer), like ESP-IDF's default
+#define configGENERATE_RUN_TIME_STATS 1
+
+#include "freertos/task.h"
+
+#endif // HOST_FREERTOS_H
@@ -0,0 +1,26 @@
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void*);
+struct HostTask;
+typedef HostTask* TaskHandle_t;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth,
+                                   void* arg, UBaseType_t priority, TaskHandle_t* handle,
+                                   BaseType_t core);
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stackDepth,
+                       void* arg, UBaseType_t priority, TaskHandle_t* handle);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t* previousWakeTime, TickType_t increment);
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+// time the idle task has run, in microseconds; the simulator derives it from sim::setCpuDemand()
+uint32_t ulTaskGetIdleRunTimeCounter();
+// per task and per core; in the simulator both idle tasks see the same load, other tasks 0
+TaskHandle_t xTaskGetIdleTaskHandleForCore(BaseType_t core);
+uint32_t ulTaskGetRunTimeCounter(TaskHandle_t task);
+
+#endif // HOST_FREERTOS_TASK_H
@@ -0,0 +1,10 @@
+#ifndef HOST_THREAD_SAFE_ARDUINO_H
+#define HOST_THREAD_SAFE_ARDUINO_H
+
+#include <Arduino.h>
+
+namespace threadSafe {
+    uint16_t touchRead(uint8_t pin);
+}
+
+#endif // HOST_THREAD_SAFE_ARDUINO_H
@@ -0,0 +1,230 @@
+// Clock, thermal sensor, CPU clock, touch pads, sleep and logging of the host simulator.
+
+#include <Arduino.h>
+#include <LoggingBase.h>
+#include <threadSafeArduino.h>
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "Sim.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+
+namespace {
+
+const auto gStart = std::chrono::steady_clock::now();
+std::atomic<uint64_t> gSkewMs{0}; // 64 bit like esp_timer, millis() and micros() wrap on their own
+
+std::mutex gThermalMutex;
+float gTemperature = 45.0f;
+std::function<float(uint32_t)> gTemperatureSource;
+
+std::atomic<uint32_t> gCpuMhz{240};
+std::atomic<uint32_t> gCpuChanges{0};
+
+std::mutex gIdleMutex;
+std::function<float(uint32_t)> gCpuDemand;
+uint64_t gIdleUs = 0;
+uint64_t gIdleLastUs = 0;
+
+std::atomic<uint16_t> gTouch[64];
+std::atomic<uint32_t> gTouchReads{0};
+
+std::atomic<uint32_t> gDeepSleeps{0};
+std::atomic<uint32_t> gLightSleeps{0};
+std::atomic<uint64_t> gWakeupUs{0};
+std::atomic<int64_t> gSetTimeOfDay{0};
+std::atomic<uint32_t> gSetTimeOfDayCount{0};
+std::atomic<int64_t> gAdjTimeUs{0};
+
+std::atomic<bool> gLogOutput{true};
+std::atomic<uint32_t> gLogBaud{0};
+
+class StdoutLogger : public LoggingBase {};
+StdoutLogger gStdoutLogger;
+
+} // namespace
+
+LoggingBase* gLogger = &gStdoutLogger;
+
+void LoggingBase::print(const char* s) {
+    if (gLogOutput.load(std::memory_order_relaxed)) {
+        fputs(s, stdout);
+    }
+    uint32_t baud = gLogBaud.load(std::memory_order_relaxed);
+    if (baud) {
+        std::this_thread::sleep_for(std::chrono::microseconds(strlen(s) * 10000000ull / baud));
+    }
+}
+
+uint32_t millis() {
+    auto elapsed = std::chrono::steady_clock::now() - gStart;
+    return (uint32_t)(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() + gSkewMs.load());
+}
+
+uint32_t micros() {
+    auto elapsed = std::chrono::steady_clock::now() - gStart;
+    return (uint32_t)(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() + gSkewMs.load() * 1000u);
+}
+
+int64_t esp_timer_get_time() {
+    auto elapsed = std::chrono::steady_clock::now() - gStart;
+    return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() + (int64_t)gSkewMs.load() * 1000;
+}
+
+uint32_t ulTaskGetIdleRunTimeCounter() {
+    std::lock_guard<std::mutex> lk(gIdleMutex);
+    uint64_t now = (uint64_t)esp_timer_get_time();
+    uint64_t dt = now - gIdleLastUs;
+    gIdleLastUs = now;
+    float busy = 0.0f;
+    if (gCpuDemand) {
+        busy = gCpuDemand((uint32_t)(now / 1000)) / (float)gCpuMhz.load();
+        busy = busy < 0.0f ? 0.0f : (busy > 1.0f ? 1.0f : busy);
+    }
+    gIdleUs += (uint64_t)(dt * (1.0f - busy));
+    return (uint32_t)gIdleUs;
+}
+
+void delay(uint32_t ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+float temperatureRead() {
+    std::lock_guard<std::mutex> lk(gThermalMutex);
+    if (gTemperatureSource) {
+        return gTemperatureSource(millis());
+    }
+    return gTemperature;
+}
+
+bool setCpuFrequencyMhz(uint32_t cpu_freq_mhz) {
+    // the ESP32 PLL only yields these; everything else is rejected like on target
+    if (cpu_freq_mhz != 240 && cpu_freq_mhz != 160 && cpu_freq_mhz != 80 &&
+        cpu_freq_mhz != 40 && cpu_freq_mhz != 20 && cpu_freq_mhz != 10) {
+        return false;
+    }
+    ulTaskGetIdleRunTimeCounter(); // idle time so far accrued at the old clock
+    if (gCpuMhz.exchange(cpu_freq_mhz) != cpu_freq_mhz) {
+        gCpuChanges++;
+    }
+    return true;
+}
+
+uint32_t getCpuFrequencyMhz() {
+    return gCpuMhz.load();
+}
+
+uint32_t esp_random() {
+    static std::mutex m;
+    static std::mt19937 rng(12345);
+    std::lock_guard<std::mutex> lk(m);
+    return rng();
+}
+
+void esp_restart() {
+    gLogger->println("[sim] esp_restart()");
+}
+
+uint16_t threadSafe::touchRead(uint8_t pin) {
+    gTouchReads++;
+    return gTouch[pin & 63].load(std::memory_order_relaxed);
+}
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us) {
+    gWakeupUs = time_in_us;
+    return ESP_OK;
+}
+
+void esp_deep_sleep_start() {
+    gDeepSleeps++;
+    gLogger->println("[sim] esp_deep_sleep_start()");
+}
+
+esp_err_t esp_light_sleep_start() {
+    gLightSleeps++;
+    return ESP_OK;
+}
+
+int sim_settimeofday(const struct timeval* tv, const void* tz) {
+    (void)tz;
+    if (tv) gSetTimeOfDay = tv->tv_sec;
+    gSetTimeOfDayCount++;
+    return 0;
+}
+
+int sim_adjtime(const struct timeval* delta, struct timeval* olddelta) {
+    if (olddelta) {
+        olddelta->tv_sec = 0;
+        olddelta->tv_usec = 0;
+    }
+    if (delta) gAdjTimeUs += (int64_t)delta->tv_sec * 1000000 + delta->tv_usec;
+    return 0;
+}
+
+namespace sim {
+
+void advanceMillis(uint32_t ms) { gSkewMs += ms; }
+
+void setTemperature(float celsius) {
+    std::lock_guard<std::mutex> lk(gThermalMutex);
+    gTemperature = celsius;
+    gTemperatureSource = nullptr;
+}
+
+void setTemperatureSource(std::function<float(uint32_t)> source) {
+    std::lock_guard<std::mutex> lk(gThermalMutex);
+    gTemperatureSource = std::move(source);
+}
+
+void setThermalModel(const ThermalModel& model, std::function<float(uint32_t)> load) {
+    struct State {
+        ThermalModel model;
+        std::function<float(uint32_t)> load;
+        float temperature;
+        uint32_t lastMs;
+    };
+    auto st = std::make_shared<State>(State{model, std::move(load), model.initial, millis()});
+    setTemperatureSource([st](uint32_t now) {
+        // integrate exactly over the time since the last read, with the clock and
+        // load seen now; reads are frequent compared to tauMs
+        float load = st->load ? st->load(now) : 1.0f;
+        load = load < 0.0f ? 0.0f : (load > 1.0f ? 1.0f : load);
+        float power = (gCpuMhz.load() / 240.0f) * (st->model.idle + (1.0f - st->model.idle) * load);
+        float target = st->model.ambient + st->model.riseAt240 * power;
+        float dt = (float)(uint32_t)(now - st->lastMs);
+        st->lastMs = now;
+        st->temperature = target + (st->temperature - target) * std::exp(-dt / (float)st->model.tauMs);
+        return st->temperature;
+    });
+}
+
+void setCpuDemand(std::function<float(uint32_t)> mhz) {
+    ulTaskGetIdleRunTimeCounter(); // settle the time so far under the old demand
+    std::lock_guard<std::mutex> lk(gIdleMutex);
+    gCpuDemand = std::move(mhz);
+}
+
+uint32_t cpuFrequencyMhz() { return gCpuMhz.load(); }
+uint32_t cpuFrequencyChanges() { return gCpuChanges.load(); }
+
+void setTouchValue(uint8_t pin, uint16_t value) { gTouch[pin & 63] = value; }
+uint32_t touchReads() { return gTouchReads.load(); }
+
+int64_t lastSetTimeOfDay() { return gSetTimeOfDay.load(); }
+int64_t pendingAdjTimeUs() { return gAdjTimeUs.load(); }
+uint32_t setTimeOfDayCount() { return gSetTimeOfDayCount.load(); }
+
+uint32_t deepSleepCount() { return gDeepSleeps.load(); }
+uint32_t lightSleepCount() { return gLightSleeps.load(); }
+uint64_t lastSleepWakeupUs() { return gWakeupUs.load(); }
+
+void setLogOutput(bool enabled) { gLogOutput = enabled; }
+void setLogBaudRate(uint32_t baud) { gLogBaud = baud; }
+
+} // namespace sim
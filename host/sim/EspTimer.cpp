@@ -0,0 +1,155 @@
+// esp_timer on one dispatcher thread, started by the first esp_timer_create().
+// Deadlines are in esp_timer_get_time(), so sim::advanceMillis() makes due
+// timers fire right away; the thread re-checks at least every few ms for that.
+
+#include "esp_timer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void* arg;
+    bool armed = false;
+    int64_t dueUs = 0;
+    uint64_t periodUs = 0; // 0: one-shot
+};
+
+namespace {
+
+class TimerThread {
+public:
+    ~TimerThread() {
+        if (thread_.joinable()) {
+            {
+                std::lock_guard<std::mutex> lk(mutex_);
+                stop_ = true;
+            }
+            cv_.notify_all();
+            thread_.join();
+        }
+    }
+
+    esp_timer* create(const esp_timer_create_args_t& args) {
+        std::lock_guard<std::mutex> lk(mutex_);
+        esp_timer* t = new esp_timer();
+        t->callback = args.callback;
+        t->arg = args.arg;
+        timers_.push_back(t);
+        if (!thread_.joinable()) {
+            thread_ = std::thread([this] { run(); });
+        }
+        return t;
+    }
+
+    esp_err_t start(esp_timer* t, uint64_t timeoutUs, uint64_t periodUs) {
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            if (t->armed) return ESP_ERR_INVALID_STATE;
+            t->armed = true;
+            t->dueUs = esp_timer_get_time() + (int64_t)timeoutUs;
+            t->periodUs = periodUs;
+        }
+        cv_.notify_all();
+        return ESP_OK;
+    }
+
+    esp_err_t stop(esp_timer* t) {
+        std::lock_guard<std::mutex> lk(mutex_);
+        if (!t->armed) return ESP_ERR_INVALID_STATE;
+        t->armed = false;
+        return ESP_OK;
+    }
+
+    esp_err_t remove(esp_timer* t) {
+        std::lock_guard<std::mutex> dispatch(dispatchMutex_); // not while its callback runs
+        std::lock_guard<std::mutex> lk(mutex_);
+        if (t->armed) return ESP_ERR_INVALID_STATE;
+        timers_.erase(std::remove(timers_.begin(), timers_.end(), t), timers_.end());
+        delete t;
+        return ESP_OK;
+    }
+
+    bool active(esp_timer* t) {
+        std::lock_guard<std::mutex> lk(mutex_);
+        return t->armed;
+    }
+
+private:
+    static constexpr int64_t maxSleepUs = 2000;
+
+    void run() {
+        std::unique_lock<std::mutex> lk(mutex_);
+        while (!stop_) {
+            int64_t now = esp_timer_get_time();
+            esp_timer* due = nullptr;
+            int64_t next = now + maxSleepUs;
+            for (esp_timer* t : timers_) {
+                if (!t->armed) continue;
+                if (t->dueUs <= now && (!due || t->dueUs < due->dueUs)) due = t;
+                if (t->dueUs < next) next = t->dueUs;
+            }
+            if (!due) {
+                cv_.wait_for(lk, std::chrono::microseconds(std::max<int64_t>(next - now, 100)));
+                continue;
+            }
+            if (due->periodUs) {
+                due->dueUs += (int64_t)due->periodUs;
+            } else {
+                due->armed = false;
+            }
+            esp_timer_cb_t cb = due->callback;
+            void* arg = due->arg;
+            lk.unlock();
+            {
+                std::lock_guard<std::mutex> dispatch(dispatchMutex_);
+                cb(arg);
+            }
+            lk.lock();
+        }
+    }
+
+    std::mutex mutex_;
+    std::mutex dispatchMutex_;
+    std::condition_variable cv_;
+    std::vector<esp_timer*> timers_;
+    std::thread thread_;
+    bool stop_ = false;
+};
+
+TimerThread& timerThread() {
+    static TimerThread t;
+    return t;
+}
+
+} // namespace
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* create_args, esp_timer_handle_t* out_handle) {
+    if (!create_args || !create_args->callback || !out_handle) return ESP_ERR_INVALID_ARG;
+    *out_handle = timerThread().create(*create_args);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    return timerThread().start(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+    return timerThread().start(timer, period, period);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    return timerThread().stop(timer);
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    return timerThread().remove(timer);
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) {
+    return timerThread().active(timer);
+}
@@ -0,0 +1,275 @@
+// FreeRTOS tasks, semaphores and event groups on top of std::thread / std::timed_mutex.
+// Tasks are detached threads; vTaskDelete() on a running task takes effect at
+// its next vTaskDelay(), which is where every task in this library blocks.
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "Sim.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct HostTask {
+    std::string name;
+    std::atomic<bool> deleteRequested{false};
+};
+
+struct HostSemaphore {
+    bool binary = false;
+    std::timed_mutex mutex;            // mutex semaphores
+    std::mutex m;                      // binary semaphores
+    std::condition_variable_any cv;
+    bool given = false;
+    std::chrono::steady_clock::time_point takenAt; // mutex semaphores, while held
+};
+
+struct HostEventGroup {
+    std::mutex m;
+    std::condition_variable cv;
+    EventBits_t bits = 0;
+};
+
+namespace {
+
+struct TaskExit {};
+
+thread_local HostTask* tCurrentTask = nullptr;
+thread_local uint64_t tSemaphoreTakes = 0;
+std::atomic<uint64_t> gSemaphoreTakes{0};
+std::atomic<uint32_t> gTasksCreated{0};
+std::atomic<uint64_t> gHolds{0};
+std::atomic<uint64_t> gHoldTotalUs{0};
+std::atomic<uint64_t> gHoldMaxUs{0};
+std::atomic<uint32_t> gHoldEpoch{0}; // bumped by resetSemaphoreHoldStats()
+thread_local sim::HoldStats tHold;
+thread_local uint32_t tHoldEpoch = 0;
+
+void checkDeleted() {
+    if (tCurrentTask && tCurrentTask->deleteRequested.load()) {
+        throw TaskExit();
+    }
+}
+
+} // namespace
+
+namespace sim {
+uint64_t semaphoreTakes() { return gSemaphoreTakes.load(); }
+uint64_t semaphoreTakesThisThread() { return tSemaphoreTakes; }
+uint32_t tasksCreated() { return gTasksCreated.load(); }
+HoldStats semaphoreHoldStats() {
+    HoldStats s;
+    s.holds = gHolds.load();
+    s.totalUs = gHoldTotalUs.load();
+    s.maxUs = gHoldMaxUs.load();
+    return s;
+}
+HoldStats semaphoreHoldStatsThisThread() {
+    if (tHoldEpoch != gHoldEpoch.load()) return HoldStats();
+    return tHold;
+}
+void resetSemaphoreHoldStats() {
+    gHoldEpoch++;
+    gHolds = 0;
+    gHoldTotalUs = 0;
+    gHoldMaxUs = 0;
+}
+} // namespace sim
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth,
+                                   void* arg, UBaseType_t priority, TaskHandle_t* handle,
+                                   BaseType_t core) {
+    (void)stackDepth; (void)priority; (void)core;
+    HostTask* task = new HostTask();
+    task->name = name ? name : "";
+    if (handle) *handle = task;
+    gTasksCreated++;
+    std::thread([fn, arg, task]() {
+        tCurrentTask = task;
+        try {
+            fn(arg);
+        } catch (const TaskExit&) {
+        }
+        // handles may still be held by the creator, they are never reused
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stackDepth,
+                       void* arg, UBaseType_t priority, TaskHandle_t* handle) {
+    return xTaskCreatePinnedToCore(fn, name, stackDepth, arg, priority, handle, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == nullptr || task == tCurrentTask) {
+        throw TaskExit();
+    }
+    task->deleteRequested = true;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    checkDeleted();
+    // sleep in slices so a pending vTaskDelete() is honoured reasonably fast
+    auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(ticks);
+    while (std::chrono::steady_clock::now() < until) {
+        auto slice = std::min<std::chrono::steady_clock::duration>(
+            until - std::chrono::steady_clock::now(), std::chrono::milliseconds(20));
+        std::this_thread::sleep_for(slice);
+        checkDeleted();
+    }
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)millis();
+}
+
+void vTaskDelayUntil(TickType_t* previousWakeTime, TickType_t increment) {
+    TickType_t wake = *previousWakeTime + increment;
+    TickType_t now = xTaskGetTickCount();
+    if ((int32_t)(wake - now) > 0) {
+        vTaskDelay(wake - now);
+    }
+    *previousWakeTime = wake;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return tCurrentTask;
+}
+
+namespace {
+HostTask gIdleTasks[portNUM_PROCESSORS];
+}
+
+TaskHandle_t xTaskGetIdleTaskHandleForCore(BaseType_t core) {
+    return core >= 0 && core < portNUM_PROCESSORS ? &gIdleTasks[core] : nullptr;
+}
+
+uint32_t ulTaskGetRunTimeCounter(TaskHandle_t task) {
+    for (HostTask& idle : gIdleTasks) {
+        if (task == &idle) {
+            return ulTaskGetIdleRunTimeCounter();
+        }
+    }
+    return 0;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return new HostSemaphore();
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    HostSemaphore* s = new HostSemaphore();
+    s->binary = true;
+    return s;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+    gSemaphoreTakes++;
+    tSemaphoreTakes++;
+    if (!sem->binary) {
+        if (ticks == portMAX_DELAY) {
+            sem->mutex.lock();
+        } else if (!sem->mutex.try_lock_for(std::chrono::milliseconds(ticks))) {
+            return pdFALSE;
+        }
+        sem->takenAt = std::chrono::steady_clock::now();
+        return pdTRUE;
+    }
+    std::unique_lock<std::mutex> lk(sem->m);
+    if (ticks == portMAX_DELAY) {
+        sem->cv.wait(lk, [sem] { return sem->given; });
+    } else if (!sem->cv.wait_for(lk, std::chrono::milliseconds(ticks), [sem] { return sem->given; })) {
+        return pdFALSE;
+    }
+    sem->given = false;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    if (!sem->binary) {
+        uint64_t held = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - sem->takenAt).count();
+        sem->mutex.unlock();
+        gHolds++;
+        gHoldTotalUs += held;
+        uint32_t epoch = gHoldEpoch.load();
+        if (tHoldEpoch != epoch) {
+            tHold = sim::HoldStats();
+            tHoldEpoch = epoch;
+        }
+        tHold.holds++;
+        tHold.totalUs += held;
+        if (held > tHold.maxUs) tHold.maxUs = held;
+        uint64_t max = gHoldMaxUs.load();
+        while (held > max && !gHoldMaxUs.compare_exchange_weak(max, held)) {
+        }
+        return pdTRUE;
+    }
+    {
+        std::lock_guard<std::mutex> lk(sem->m);
+        if (sem->given) return pdFALSE;
+        sem->given = true;
+    }
+    sem->cv.notify_one();
+    return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) {
+    delete sem;
+}
+
+EventGroupHandle_t xEventGroupCreate() {
+    return new HostEventGroup();
+}
+
+void vEventGroupDelete(EventGroupHandle_t group) {
+    delete group;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    EventBits_t now;
+    {
+        std::lock_guard<std::mutex> lk(group->m);
+        group->bits |= bits;
+        now = group->bits;
+    }
+    group->cv.notify_all();
+    return now;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> lk(group->m);
+    EventBits_t before = group->bits;
+    group->bits &= ~bits;
+    return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+    std::lock_guard<std::mutex> lk(group->m);
+    return group->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bitsToWaitFor, BaseType_t clearOnExit,
+                                BaseType_t waitForAllBits, TickType_t ticksToWait) {
+    std::unique_lock<std::mutex> lk(group->m);
+    auto met = [&] {
+        EventBits_t set = group->bits & bitsToWaitFor;
+        return waitForAllBits ? set == bitsToWaitFor : set != 0;
+    };
+    bool ok;
+    if (ticksToWait == portMAX_DELAY) {
+        group->cv.wait(lk, met);
+        ok = true;
+    } else {
+        ok = group->cv.wait_for(lk, std::chrono::milliseconds(ticksToWait), met);
+    }
+    EventBits_t bits = group->bits;
+    if (ok && clearOnExit) {
+        group->bits &= ~bitsToWaitFor;
+    }
+    return bits;
+}
@@ -0,0 +1,282 @@
+// Simulated UDP network behind WiFiUDP and WiFi.hostByName(), with SNTP stand-in
+// servers. Like the radio, it is evaluated lazily: a request is answered the
+// moment it is sent, with the server timestamps it would carry after the
+// scripted uplink delay, and the reply becomes readable after the round trip.
+
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include "esp_timer.h"
+#include "Sim.h"
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string.h>
+
+namespace {
+
+struct Datagram {
+    int64_t readyAtUs;
+    IPAddress from;
+    uint16_t fromPort;
+    std::vector<uint8_t> data;
+};
+
+struct Socket {
+    uint16_t port;
+    std::deque<Datagram> rx; // ordered by readyAtUs
+};
+
+struct Server {
+    sim::NtpServer config;
+    IPAddress ip;
+};
+
+constexpr uint16_t ntpPort = 123;
+constexpr uint32_t ntpToUnix = 2208988800u; // 1900-01-01 to 1970-01-01
+
+std::mutex gNetMutex;
+std::map<int, Socket> gSockets;
+int gNextSocket = 0;
+std::vector<Server> gServers;
+bool gNtpUp = true;
+// true time is anchored to the local clock, which runs fast by gDriftPpm
+int64_t gAnchorLocalUs = 0;
+int64_t gAnchorUtcUs = 1700000000LL * 1000000;
+double gDriftPpm = 0;
+uint32_t gRoundTripMs = 40;
+uint32_t gRequests = 0;
+std::mt19937 gJitter(123); // same run every time
+
+IPAddress serverIP(size_t index) {
+    return IPAddress(10, 0, 123, (uint8_t)(1 + index));
+}
+
+int64_t trueUtcUsAt(int64_t localUs) {
+    int64_t dt = localUs - gAnchorLocalUs;
+    return gAnchorUtcUs + dt - (int64_t)(dt * gDriftPpm / 1e6);
+}
+
+int64_t jitterUs(uint32_t jitterMs) {
+    if (!jitterMs) return 0;
+    return std::uniform_int_distribution<int64_t>(0, (int64_t)jitterMs * 1000)(gJitter);
+}
+
+void putTimestamp(uint8_t* p, int64_t unixUs) {
+    uint32_t sec = (uint32_t)(unixUs / 1000000) + ntpToUnix;
+    uint32_t frac = (uint32_t)(((uint64_t)(unixUs % 1000000) << 32) / 1000000);
+    for (int i = 0; i < 4; ++i) {
+        p[i] = (uint8_t)(sec >> (24 - 8 * i));
+        p[4 + i] = (uint8_t)(frac >> (24 - 8 * i));
+    }
+}
+
+void put32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = (uint8_t)(v >> (24 - 8 * i));
+}
+
+int serverByNameLocked(const char* name) {
+    for (size_t i = 0; i < gServers.size(); ++i) {
+        if (gServers[i].config.name == name) return (int)i;
+    }
+    return -1;
+}
+
+int addServerLocked(const sim::NtpServer& config) {
+    Server s;
+    s.config = config;
+    s.ip = serverIP(gServers.size());
+    gServers.push_back(s);
+    return (int)gServers.size() - 1;
+}
+
+// the reply a server would send, queued on the client's socket
+void answerLocked(const Server& server, int socket, const std::vector<uint8_t>& request, int64_t sentUs) {
+    if (request.size() < 48 || (request[0] & 0x07) != 3) return; // not a client request
+    const sim::NtpServer& c = server.config;
+    int64_t roundTripUs = (int64_t)(c.roundTripMs ? c.roundTripMs : gRoundTripMs) * 1000;
+    int64_t upUs = (int64_t)(roundTripUs * c.uplinkShare);
+    int64_t downUs = roundTripUs - upUs + jitterUs(c.jitterMs);
+    upUs += jitterUs(c.jitterMs);
+    roundTripUs = upUs + downUs;
+    int64_t arrivalUs = sentUs + upUs;
+    int64_t t2 = trueUtcUsAt(arrivalUs) + (int64_t)c.errorMs * 1000;
+    int64_t t3 = t2 + c.processingUs;
+
+    std::vector<uint8_t> reply(48, 0);
+    uint8_t version = (request[0] >> 3) & 0x07;
+    reply[0] = (uint8_t)((version << 3) | 4); // LI 0, mode 4 (server)
+    reply[1] = c.kissOfDeath ? 0 : c.stratum;
+    reply[2] = request[2];                    // poll
+    reply[3] = 0xEC;                          // precision 2^-20 s
+    // root delay and dispersion, 16.16 s: a few ms per stratum above 1
+    uint32_t hops = c.stratum > 1 ? c.stratum - 1 : 0;
+    put32(&reply[4], (uint32_t)(hops * 0.010 * 65536));
+    put32(&reply[8], (uint32_t)((0.001 + hops * 0.005) * 65536));
+    if (c.kissOfDeath) {
+        memcpy(&reply[12], "RATE", 4);
+    } else if (c.stratum == 1) {
+        memcpy(&reply[12], "GPS", 3);
+    } else {
+        put32(&reply[12], (uint32_t)server.ip);
+    }
+    putTimestamp(&reply[16], t2 - 64 * 1000000LL); // reference: last set a minute ago
+    memcpy(&reply[24], &request[40], 8);           // origin = the client's transmit field
+    putTimestamp(&reply[32], t2);
+    if (!c.zeroTransmit) {
+        putTimestamp(&reply[40], t3);
+    }
+
+    Datagram d;
+    d.readyAtUs = sentUs + roundTripUs + 50;
+    d.from = server.ip;
+    d.fromPort = ntpPort;
+    d.data = reply;
+    auto& rx = gSockets[socket].rx;
+    auto it = rx.begin();
+    while (it != rx.end() && it->readyAtUs <= d.readyAtUs) ++it;
+    rx.insert(it, d);
+}
+
+} // namespace
+
+namespace sim {
+
+int addNtpServer(const NtpServer& server) {
+    std::lock_guard<std::mutex> lk(gNetMutex);
+    return addServerLocked(server);
+}
+
+void setNtpServer(int index, const NtpServer& server) {
+    std::lock_guard<std::mutex> lk(gNetMutex);
+    gServers.at(index).config = server;
+}
+
+void setNtpServerUp(bool up) {
+    std::lock_guard<std::mutex> lk(gNetMutex);
+    gNtpUp = up;
+}
+
+void setNtpEpoch(uint32_t utcEpoch) {
+    std::lock_guard<std::mutex> lk(gNetMutex);
+    gAnchorLocalUs = esp_timer_get_time();
+    gAnchorUtcUs = (int64_t)utcEpoch * 1000000;
+}
+
+void setClockDriftPpm(double ppm) {
+    std::lock_guard<std::mutex> lk(gNetMutex);
+    int64_t now = esp_timer_get_time();
+    gAnchorUtcUs = trueUtcUsAt(now);
+    gAnchorLocalUs = now;
+    gDriftPpm = ppm;
+}
+
+void setNtpRoundTripMs(uint32_t ms) {
+    std::lock_guard<std::mutex> lk(gNetMutex);
+    gRoundTripMs = ms;
+}
+
+int64_t trueUtcUs() {
+    std::lock_guard<std::mutex> lk(gNetMutex);
+    return trueUtcUsAt(esp_timer_get_time());
+}
+
+uint32_t ntpRequests() {
+    std::lock_guard<std::mutex> lk(gNetMutex);
+    return gRequests;
+}
+
+} // namespace sim
+
+int WiFiClass::hostByName(const char* host, IPAddress& result) {
+    if (!host || !*host) return 0;
+    unsigned a, b, c, d;
+    char tail;
+    if (sscanf(host, "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) == 4 && a < 256 && b < 256 && c < 256 && d < 256) {
+        result = IPAddress(a, b, c, d);
+        return 1;
+    }
+    if (status() != WL_CONNECTED) return 0;
+    std::lock_guard<std::mutex> lk(gNetMutex);
+    int i = serverByNameLocked(host);
+    if (i < 0) {
+        sim::NtpServer s;
+        s.name = host;
+        i = addServerLocked(s);
+    }
+    result = gServers[i].ip;
+    return 1;
+}
+
+uint8_t WiFiUDP::begin(uint16_t port) {
+    stop();
+    std::lock_guard<std::mutex> lk(gNetMutex);
+    socket_ = gNextSocket++;
+    gSockets[socket_].port = port;
+    return 1;
+}
+
+void WiFiUDP::stop() {
+    if (socket_ < 0) return;
+    std::lock_guard<std::mutex> lk(gNetMutex);
+    gSockets.erase(socket_);
+    socket_ = -1;
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port) {
+    txIP_ = ip;
+    txPort_ = port;
+    tx_.clear();
+    return 1;
+}
+
+int WiFiUDP::beginPacket(const char* host, uint16_t port) {
+    IPAddress ip;
+    if (!WiFi.hostByName(host, ip)) return 0;
+    return beginPacket(ip, port);
+}
+
+size_t WiFiUDP::write(const uint8_t* buffer, size_t size) {
+    tx_.insert(tx_.end(), buffer, buffer + size);
+    return size;
+}
+
+int WiFiUDP::endPacket() {
+    if (socket_ < 0 || WiFi.status() != WL_CONNECTED) return 0;
+    int64_t now = esp_timer_get_time();
+    std::lock_guard<std::mutex> lk(gNetMutex);
+    if (txPort_ != ntpPort) return 1; // nobody listens, the datagram is lost
+    for (const Server& s : gServers) {
+        if (s.ip != txIP_) continue;
+        gRequests++;
+        if (gNtpUp && s.config.up) {
+            answerLocked(s, socket_, tx_, now);
+        }
+        break;
+    }
+    return 1;
+}
+
+int WiFiUDP::parsePacket() {
+    if (socket_ < 0) return 0;
+    int64_t now = esp_timer_get_time();
+    std::lock_guard<std::mutex> lk(gNetMutex);
+    auto& rx = gSockets[socket_].rx;
+    if (rx.empty() || rx.front().readyAtUs > now) return 0;
+    Datagram d = rx.front();
+    rx.pop_front();
+    rx_ = d.data;
+    rxPos_ = 0;
+    remoteIP_ = d.from;
+    remotePort_ = d.fromPort;
+    return (int)rx_.size();
+}
+
+int WiFiUDP::read(uint8_t* buffer, size_t len) {
+    size_t n = rx_.size() - rxPos_;
+    if (n > len) n = len;
+    memcpy(buffer, rx_.data() + rxPos_, n);
+    rxPos_ += n;
+    return (int)n;
+}
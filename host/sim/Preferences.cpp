@@ -0,0 +1,98 @@
+// Preferences (NVS) stand-in, one process-wide key/value store per namespace.
+
+#include <Preferences.h>
+#include "Sim.h"
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+std::mutex gNvsMutex;
+std::map<std::string, std::map<std::string, std::vector<uint8_t>>> gNvs;
+std::atomic<uint32_t> gNvsWrites{0};
+
+} // namespace
+
+namespace sim {
+uint32_t nvsWrites() { return gNvsWrites.load(); }
+void eraseNvs() {
+    std::lock_guard<std::mutex> lk(gNvsMutex);
+    gNvs.clear();
+}
+} // namespace sim
+
+bool Preferences::begin(const char* name, bool readOnly, const char*) {
+    ns_ = name ? name : "";
+    open_ = true;
+    readOnly_ = readOnly;
+    return true;
+}
+
+void Preferences::end() {
+    open_ = false;
+}
+
+bool Preferences::clear() {
+    if (!open_ || readOnly_) return false;
+    std::lock_guard<std::mutex> lk(gNvsMutex);
+    gNvs[ns_].clear();
+    gNvsWrites++;
+    return true;
+}
+
+bool Preferences::remove(const char* key) {
+    if (!open_ || readOnly_) return false;
+    std::lock_guard<std::mutex> lk(gNvsMutex);
+    gNvsWrites++;
+    return gNvs[ns_].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char* key) {
+    std::lock_guard<std::mutex> lk(gNvsMutex);
+    return open_ && gNvs[ns_].count(key) > 0;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+    if (!open_ || readOnly_) return 0;
+    std::lock_guard<std::mutex> lk(gNvsMutex);
+    const uint8_t* p = static_cast<const uint8_t*>(value);
+    gNvs[ns_][key] = std::vector<uint8_t>(p, p + len);
+    gNvsWrites++;
+    return len;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+    if (!open_) return 0;
+    std::lock_guard<std::mutex> lk(gNvsMutex);
+    auto it = gNvs[ns_].find(key);
+    if (it == gNvs[ns_].end() || it->second.size() > maxLen) return 0;
+    memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    if (!open_) return 0;
+    std::lock_guard<std::mutex> lk(gNvsMutex);
+    auto it = gNvs[ns_].find(key);
+    return it == gNvs[ns_].end() ? 0 : it->second.size();
+}
+
+size_t Preferences::putUInt(const char* key, uint32_t value) {
+    return putBytes(key, &value, sizeof(value));
+}
+
+uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue) {
+    uint32_t v;
+    return getBytes(key, &v, sizeof(v)) == sizeof(v) ? v : defaultValue;
+}
+
+size_t Preferences::putString(const char* key, const char* value) {
+    return putBytes(key, value, strlen(value) + 1);
+}
+
+String Preferences::getString(const char* key, const String& defaultValue) {
+    char buf[256];
+    return getBytes(key, buf, sizeof(buf)) ? String(buf) : defaultValue;
+}
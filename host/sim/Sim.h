@@ -0,0 +1,155 @@
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+// Scripting interface of the host simulator. The shim headers in host/include
+// (Arduino.h, WiFi.h, freertos/..., WiFiUdp.h, ...) are implemented on top of
+// this state, so the library sources compile unmodified; scenarios and
+// benchmarks use the functions below to drive the "hardware".
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace sim {
+
+// ---------------------------------------------------------------------------
+// clock
+// millis() is real elapsed time since start plus a scriptable skew, so
+// scenarios can jump ahead (e.g. past a roam check) without waiting.
+void advanceMillis(uint32_t ms);
+
+// ---------------------------------------------------------------------------
+// WiFi radio
+struct AccessPoint {
+    std::string ssid;
+    uint8_t bssid[6] = {0, 0, 0, 0, 0, 0};
+    int32_t channel = 1;
+    int32_t rssi = -60;
+    bool up = true;
+};
+
+struct RadioTiming {
+    uint32_t scanMsPerChannel = 120; // used when the caller does not pass max_ms_per_chan
+    uint32_t associateMs = 300;      // begin() until the STA is associated
+    uint32_t dhcpMs = 200;           // association until an IP is assigned
+    uint32_t numChannels = 13;
+};
+
+struct RadioStats {
+    uint32_t scans = 0;
+    uint32_t scannedChannels = 0;
+    uint32_t scanAirtimeMs = 0;
+    uint32_t connectAttempts = 0;
+    uint32_t powerSaveChanges = 0;
+    uint32_t txPowerChanges = 0;
+};
+
+void clearAccessPoints();
+int addAccessPoint(const AccessPoint& ap); // returns the index used below
+void setAccessPointUp(int index, bool up);
+void setAccessPointRSSI(int index, int32_t rssi);
+void setRadioTiming(const RadioTiming& timing);
+RadioStats radioStats();
+// WiFi.onEvent() callbacks (scan done, connected, got/lost IP, disconnected),
+// raised by a driver thread within a few ms of the radio state changing; on by
+// default, off simulates a sketch that only polls WiFi.status()
+void setWiFiEventsEnabled(bool enabled);
+
+// ---------------------------------------------------------------------------
+// thermal sensor and CPU clock
+void setTemperature(float celsius);
+// overrides setTemperature(); called with millis() on every temperatureRead()
+void setTemperatureSource(std::function<float(uint32_t nowMs)> source);
+// first-order thermal model driven by the simulated CPU clock: the die relaxes
+// towards ambient + riseAt240 * (f / 240) * (idle + (1 - idle) * load) with time
+// constant tauMs. Replaces setTemperature()/setTemperatureSource().
+struct ThermalModel {
+    float ambient = 40.0f;     // °C
+    float riseAt240 = 60.0f;   // steady-state rise at 240 MHz and full load
+    float idle = 0.3f;         // relative power at zero load
+    uint32_t tauMs = 30000;
+    float initial = 45.0f;     // °C at the time the model is installed
+};
+// load(nowMs) in 0..1, constant full load if empty
+void setThermalModel(const ThermalModel& model, std::function<float(uint32_t nowMs)> load = nullptr);
+// CPU work as MHz of cycles wanted; the idle task runs for the share the current
+// clock leaves over (ulTaskGetIdleRunTimeCounter()). Default: no demand, always idle.
+void setCpuDemand(std::function<float(uint32_t nowMs)> mhz);
+uint32_t cpuFrequencyMhz();
+uint32_t cpuFrequencyChanges();
+
+// ---------------------------------------------------------------------------
+// touch pads
+void setTouchValue(uint8_t pin, uint16_t value);
+uint32_t touchReads();
+
+// ---------------------------------------------------------------------------
+// NTP servers, answering SNTP on port 123 of the simulated UDP network
+// (WiFiUDP). A host name that was not added resolves to an accurate stratum 2
+// server of its own, so unscripted scenarios just work.
+struct NtpServer {
+    std::string name;
+    uint8_t stratum = 2;
+    int32_t errorMs = 0;       // server clock minus true time, for falsetickers
+    uint32_t roundTripMs = 0;  // 0: setNtpRoundTripMs()
+    float uplinkShare = 0.5f;  // part of the round trip spent on the request; != 0.5 is asymmetric
+    uint32_t jitterMs = 0;     // up to this much extra delay, each way
+    bool up = true;
+    bool kissOfDeath = false;  // answers with stratum 0 ("RATE")
+    bool zeroTransmit = false; // transmit timestamp 0, as from a server that is not synchronized
+    int32_t processingUs = 50; // T3 - T2; negative for a server that is broken
+};
+int addNtpServer(const NtpServer& server);  // returns the index used below
+void setNtpServer(int index, const NtpServer& server);
+void setNtpServerUp(bool up);         // all servers
+void setNtpEpoch(uint32_t utcEpoch);  // true time is this plus elapsed time
+// the local oscillator (millis(), esp_timer_get_time()) runs fast by this
+// much against true time, from now on; negative is slow
+void setClockDriftPpm(double ppm);
+void setNtpRoundTripMs(uint32_t ms);  // default round trip, 40 ms
+int64_t trueUtcUs();                  // what an exact clock would read now
+uint32_t ntpRequests();
+
+// settimeofday() and adjtime() from the library land here instead of the host clock
+int64_t lastSetTimeOfDay();
+int64_t pendingAdjTimeUs(); // sum of all adjtime() deltas
+uint32_t setTimeOfDayCount();
+
+// ---------------------------------------------------------------------------
+// NVS (Preferences)
+uint32_t nvsWrites();
+void eraseNvs();
+
+// ---------------------------------------------------------------------------
+// power
+uint32_t deepSleepCount();
+uint32_t lightSleepCount();
+uint64_t lastSleepWakeupUs();
+
+// ---------------------------------------------------------------------------
+// instrumentation
+// every xSemaphoreTake() on any semaphore, useful for per-call accounting
+uint64_t semaphoreTakes();
+uint64_t semaphoreTakesThisThread();
+uint32_t tasksCreated();
+// how long mutex semaphores were held, xSemaphoreTake() until xSemaphoreGive(), all mutexes
+struct HoldStats {
+    uint64_t holds = 0;
+    uint64_t totalUs = 0;
+    uint64_t maxUs = 0;
+};
+HoldStats semaphoreHoldStats();
+HoldStats semaphoreHoldStatsThisThread(); // only holds taken by the calling thread
+void resetSemaphoreHoldStats();            // all threads
+
+// logging through gLogger goes to stdout unless muted
+void setLogOutput(bool enabled);
+// every gLogger print blocks like a UART at this rate (10 bits per character,
+// muted or not), 0 = instant
+void setLogBaudRate(uint32_t baud);
+
+} // namespace sim
+
+#endif // HOST_SIM_H
@@ -0,0 +1,561 @@
+// Simulated STA radio behind WiFi.h / esp_wifi.h.
+// Connection progress is evaluated lazily against millis(): begin() records the
+// target AP, and status() reports associated/connected once the scripted
+// RadioTiming delays have elapsed. A driver thread, started by the first
+// WiFi.onEvent(), watches the same state and raises the Arduino events.
+
+#include <WiFi.h>
+#include "esp_wifi.h"
+#include "Sim.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+WiFiClass WiFi;
+
+namespace {
+
+struct ConnectAttempt {
+    uint32_t id = 0;
+    bool active = false;
+    int apIndex = -1;
+    uint32_t startedAt = 0;
+};
+
+struct ScanState {
+    bool running = false;
+    bool done = false;
+    uint32_t startedAt = 0;
+    uint32_t durationMs = 0;
+    uint8_t channel = 0;
+    std::string ssid;
+    std::vector<sim::AccessPoint> results;
+};
+
+std::mutex gRadioMutex;
+std::vector<sim::AccessPoint> gAPs;
+sim::RadioTiming gTiming;
+sim::RadioStats gStats;
+wifi_mode_t gMode = WIFI_OFF;
+bool gSleep = true;
+wifi_ps_type_t gPowerSave = WIFI_PS_MIN_MODEM;
+wifi_power_t gTxPower = WIFI_POWER_19_5dBm;
+std::string gHostname = "esp32-sim";
+ConnectAttempt gConn;
+ScanState gScan;
+bool gStaticIp = false;
+IPAddress gIp, gGateway, gMask, gDns;
+uint8_t gConnectedBssid[6];
+uint32_t gAttemptSeq = 0;
+uint32_t gScansFinished = 0;
+bool gLeave = false; // the STA itself dropped the association (disconnect(), begin(), mode(OFF))
+
+uint32_t connectDelayLocked() {
+    return gTiming.associateMs + (gStaticIp ? 0 : gTiming.dhcpMs);
+}
+
+bool associatedLocked(uint32_t now) {
+    if (gMode == WIFI_OFF || !gConn.active || gConn.apIndex < 0) return false;
+    if (!gAPs[gConn.apIndex].up) return false;
+    return now - gConn.startedAt >= gTiming.associateMs;
+}
+
+wl_status_t statusLocked(uint32_t now) {
+    if (gMode == WIFI_OFF) return WL_NO_SHIELD;
+    if (!gConn.active) return WL_DISCONNECTED;
+    uint32_t elapsed = now - gConn.startedAt;
+    if (gConn.apIndex < 0) {
+        return elapsed >= gTiming.associateMs ? WL_NO_SSID_AVAIL : WL_DISCONNECTED;
+    }
+    if (!gAPs[gConn.apIndex].up) {
+        return elapsed >= connectDelayLocked() ? WL_CONNECTION_LOST : WL_DISCONNECTED;
+    }
+    return elapsed >= connectDelayLocked() ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+const sim::AccessPoint* connectedAPLocked(uint32_t now) {
+    if (statusLocked(now) != WL_CONNECTED) return nullptr;
+    return &gAPs[gConn.apIndex];
+}
+
+void finishScanLocked() {
+    gScan.results.clear();
+    for (const auto& ap : gAPs) {
+        if (!ap.up) continue;
+        if (gScan.channel != 0 && ap.channel != gScan.channel) continue;
+        if (!gScan.ssid.empty() && ap.ssid != gScan.ssid) continue;
+        gScan.results.push_back(ap);
+    }
+    gScan.running = false;
+    gScan.done = true;
+    gScansFinished++;
+}
+
+String bssidToString(const uint8_t* b) {
+    char buf[18];
+    snprintf(buf, sizeof(buf), "%02X:%02X:%02X:%02X:%02X:%02X", b[0], b[1], b[2], b[3], b[4], b[5]);
+    return String(buf);
+}
+
+// ---------------------------------------------------------------------------
+// driver events
+
+struct EventHandler {
+    wifi_event_id_t id;
+    WiFiEventSysCb cb;
+    arduino_event_id_t event;
+};
+
+class EventDriver {
+public:
+    ~EventDriver() {
+        if (thread_.joinable()) {
+            stop_ = true;
+            thread_.join();
+        }
+    }
+
+    wifi_event_id_t add(WiFiEventSysCb cb, arduino_event_id_t event) {
+        std::lock_guard<std::mutex> lk(handlersMutex_);
+        handlers_.push_back({++lastId_, cb, event});
+        if (!thread_.joinable()) {
+            thread_ = std::thread([this] { run(); });
+        }
+        return lastId_;
+    }
+
+    void remove(wifi_event_id_t id) {
+        std::lock_guard<std::mutex> dispatch(dispatchMutex_); // not while a callback runs
+        std::lock_guard<std::mutex> lk(handlersMutex_);
+        for (size_t i = 0; i < handlers_.size(); ++i) {
+            if (handlers_[i].id == id) {
+                handlers_.erase(handlers_.begin() + i);
+                break;
+            }
+        }
+    }
+
+    std::atomic<bool> enabled{true};
+
+private:
+    static constexpr uint32_t pollMs = 5;
+
+    void run() {
+        bool associated = false;
+        bool gotIp = false;
+        uint32_t scansSeen = 0;
+        uint32_t failedAttempt = 0;
+        while (!stop_) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(pollMs));
+            std::vector<arduino_event_t> events;
+            {
+                std::lock_guard<std::mutex> lk(gRadioMutex);
+                uint32_t now = millis();
+                if (gScan.running && now - gScan.startedAt >= gScan.durationMs) {
+                    finishScanLocked();
+                }
+                bool nowAssociated = associatedLocked(now);
+                wl_status_t status = statusLocked(now);
+                bool nowGotIp = status == WL_CONNECTED;
+
+                arduino_event_t e = {};
+                if (gScansFinished != scansSeen) {
+                    scansSeen = gScansFinished;
+                    e.event_id = ARDUINO_EVENT_WIFI_SCAN_DONE;
+                    e.event_info.wifi_scan_done.number = (uint8_t)gScan.results.size();
+                    events.push_back(e);
+                }
+                if (associated && !nowAssociated) {
+                    failedAttempt = gConn.id; // the loss is the one report for this attempt
+                    e = {};
+                    e.event_id = ARDUINO_EVENT_WIFI_STA_DISCONNECTED;
+                    e.event_info.wifi_sta_disconnected.reason = gLeave ? WIFI_REASON_ASSOC_LEAVE : WIFI_REASON_BEACON_TIMEOUT;
+                    events.push_back(e);
+                } else if (gConn.active && gConn.id != failedAttempt &&
+                           (status == WL_NO_SSID_AVAIL || status == WL_CONNECTION_LOST) && !associated) {
+                    failedAttempt = gConn.id; // once per attempt
+                    e = {};
+                    e.event_id = ARDUINO_EVENT_WIFI_STA_DISCONNECTED;
+                    e.event_info.wifi_sta_disconnected.reason = WIFI_REASON_NO_AP_FOUND;
+                    events.push_back(e);
+                }
+                if (gotIp && !nowGotIp) {
+                    e = {};
+                    e.event_id = ARDUINO_EVENT_WIFI_STA_LOST_IP;
+                    events.push_back(e);
+                }
+                if (!associated && nowAssociated) {
+                    e = {};
+                    e.event_id = ARDUINO_EVENT_WIFI_STA_CONNECTED;
+                    events.push_back(e);
+                }
+                if (!gotIp && nowGotIp) {
+                    e = {};
+                    e.event_id = ARDUINO_EVENT_WIFI_STA_GOT_IP;
+                    events.push_back(e);
+                }
+                associated = nowAssociated;
+                gotIp = nowGotIp;
+                gLeave = false;
+            }
+            if (!enabled || events.empty()) {
+                continue;
+            }
+            std::lock_guard<std::mutex> dispatch(dispatchMutex_);
+            std::vector<EventHandler> handlers;
+            {
+                std::lock_guard<std::mutex> lk(handlersMutex_);
+                handlers = handlers_;
+            }
+            for (arduino_event_t& e : events) {
+                for (const EventHandler& h : handlers) {
+                    if (h.event == ARDUINO_EVENT_MAX || h.event == e.event_id) {
+                        h.cb(&e);
+                    }
+                }
+            }
+        }
+    }
+
+    std::mutex handlersMutex_;
+    std::mutex dispatchMutex_;
+    std::vector<EventHandler> handlers_;
+    wifi_event_id_t lastId_ = 0;
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+};
+
+// after the radio state above, so it is destroyed (and its thread joined) first
+EventDriver gEvents;
+
+} // namespace
+
+namespace sim {
+
+void setWiFiEventsEnabled(bool enabled) {
+    gEvents.enabled = enabled;
+}
+
+void clearAccessPoints() {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    gAPs.clear();
+    gConn = ConnectAttempt();
+}
+
+int addAccessPoint(const AccessPoint& ap) {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    gAPs.push_back(ap);
+    return (int)gAPs.size() - 1;
+}
+
+void setAccessPointUp(int index, bool up) {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    gAPs.at(index).up = up;
+}
+
+void setAccessPointRSSI(int index, int32_t rssi) {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    gAPs.at(index).rssi = rssi;
+}
+
+void setRadioTiming(const RadioTiming& timing) {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    gTiming = timing;
+}
+
+RadioStats radioStats() {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    return gStats;
+}
+
+} // namespace sim
+
+bool WiFiClass::mode(wifi_mode_t m) {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    gMode = m;
+    if (m == WIFI_OFF) {
+        gLeave = gConn.active;
+        gConn = ConnectAttempt();
+        gScan = ScanState();
+    }
+    return true;
+}
+
+wifi_mode_t WiFiClass::getMode() {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    return gMode;
+}
+
+void WiFiClass::persistent(bool) {}
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* passphrase, int32_t channel,
+                             const uint8_t* bssid, bool connect) {
+    (void)passphrase;
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    if (gMode == WIFI_OFF) gMode = WIFI_STA;
+    gLeave = gConn.active;
+    gConn = ConnectAttempt();
+    if (!connect) return WL_DISCONNECTED;
+    gStats.connectAttempts++;
+    gConn.id = ++gAttemptSeq;
+    gConn.active = true;
+    gConn.startedAt = millis();
+    // pinned: exact BSSID (and channel if given); otherwise the strongest AP of the SSID
+    for (size_t i = 0; i < gAPs.size(); ++i) {
+        const auto& ap = gAPs[i];
+        if (!ap.up || ap.ssid != (ssid ? ssid : "")) continue;
+        if (bssid && memcmp(ap.bssid, bssid, 6) != 0) continue;
+        if (bssid && channel != 0 && ap.channel != channel) continue;
+        if (gConn.apIndex < 0 || ap.rssi > gAPs[gConn.apIndex].rssi) {
+            gConn.apIndex = (int)i;
+        }
+    }
+    return WL_DISCONNECTED;
+}
+
+bool WiFiClass::config(IPAddress local_ip, IPAddress gateway, IPAddress subnet,
+                       IPAddress dns1, IPAddress dns2) {
+    (void)dns2;
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    gStaticIp = (uint32_t)local_ip != 0;
+    gIp = local_ip;
+    gGateway = gateway;
+    gMask = subnet;
+    gDns = dns1;
+    return true;
+}
+
+bool WiFiClass::disconnect(bool wifioff, bool eraseap) {
+    (void)eraseap;
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    gLeave = gConn.active;
+    gConn = ConnectAttempt();
+    if (wifioff) gMode = WIFI_OFF;
+    return true;
+}
+
+bool WiFiClass::reconnect() {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    if (gConn.apIndex < 0) return false;
+    gStats.connectAttempts++;
+    gConn.id = ++gAttemptSeq;
+    gConn.active = true;
+    gConn.startedAt = millis();
+    return true;
+}
+
+wl_status_t WiFiClass::status() {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    return statusLocked(millis());
+}
+
+int16_t WiFiClass::scanNetworks(bool async, bool show_hidden, bool passive, uint32_t max_ms_per_chan,
+                                uint8_t channel, const char* ssid, const uint8_t* bssid) {
+    (void)show_hidden; (void)passive; (void)bssid;
+    uint32_t duration;
+    {
+        std::lock_guard<std::mutex> lk(gRadioMutex);
+        if (gMode == WIFI_OFF || gScan.running) return WIFI_SCAN_FAILED;
+        uint32_t perChannel = max_ms_per_chan ? max_ms_per_chan : gTiming.scanMsPerChannel;
+        uint32_t channels = channel ? 1 : gTiming.numChannels;
+        gScan = ScanState();
+        gScan.running = true;
+        gScan.startedAt = millis();
+        gScan.durationMs = perChannel * channels;
+        gScan.channel = channel;
+        gScan.ssid = ssid ? ssid : "";
+        gStats.scans++;
+        gStats.scannedChannels += channels;
+        gStats.scanAirtimeMs += gScan.durationMs;
+        duration = gScan.durationMs;
+    }
+    if (async) return WIFI_SCAN_RUNNING;
+    std::this_thread::sleep_for(std::chrono::milliseconds(duration));
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    finishScanLocked();
+    return (int16_t)gScan.results.size();
+}
+
+int16_t WiFiClass::scanComplete() {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    if (gScan.running) {
+        if (millis() - gScan.startedAt < gScan.durationMs) return WIFI_SCAN_RUNNING;
+        finishScanLocked();
+    }
+    if (!gScan.done) return WIFI_SCAN_FAILED;
+    return (int16_t)gScan.results.size();
+}
+
+void WiFiClass::scanDelete() {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    if (!gScan.running) gScan = ScanState();
+}
+
+String WiFiClass::SSID(uint8_t i) {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    return i < gScan.results.size() ? String(gScan.results[i].ssid) : String();
+}
+
+int32_t WiFiClass::RSSI(uint8_t i) {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    return i < gScan.results.size() ? gScan.results[i].rssi : 0;
+}
+
+int32_t WiFiClass::channel(uint8_t i) {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    return i < gScan.results.size() ? gScan.results[i].channel : 0;
+}
+
+uint8_t* WiFiClass::BSSID(uint8_t i) {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    return i < gScan.results.size() ? gScan.results[i].bssid : nullptr;
+}
+
+String WiFiClass::BSSIDstr(uint8_t i) {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    return i < gScan.results.size() ? bssidToString(gScan.results[i].bssid) : String();
+}
+
+String WiFiClass::SSID() {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    const sim::AccessPoint* ap = connectedAPLocked(millis());
+    return ap ? String(ap->ssid) : String();
+}
+
+int8_t WiFiClass::RSSI() {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    const sim::AccessPoint* ap = connectedAPLocked(millis());
+    return ap ? (int8_t)ap->rssi : 0;
+}
+
+int32_t WiFiClass::channel() {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    const sim::AccessPoint* ap = connectedAPLocked(millis());
+    return ap ? ap->channel : 0;
+}
+
+uint8_t* WiFiClass::BSSID() {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    const sim::AccessPoint* ap = connectedAPLocked(millis());
+    if (!ap) return nullptr;
+    memcpy(gConnectedBssid, ap->bssid, 6);
+    return gConnectedBssid;
+}
+
+String WiFiClass::BSSIDstr() {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    const sim::AccessPoint* ap = connectedAPLocked(millis());
+    return ap ? bssidToString(ap->bssid) : String("00:00:00:00:00:00");
+}
+
+IPAddress WiFiClass::localIP() {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    if (!connectedAPLocked(millis())) return INADDR_NONE;
+    return gStaticIp ? gIp : IPAddress(192, 168, 1, 100 + gConn.apIndex);
+}
+
+IPAddress WiFiClass::gatewayIP() {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    if (!connectedAPLocked(millis())) return INADDR_NONE;
+    return gStaticIp ? gGateway : IPAddress(192, 168, 1, 1);
+}
+
+IPAddress WiFiClass::subnetMask() {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    if (!connectedAPLocked(millis())) return INADDR_NONE;
+    return gStaticIp ? gMask : IPAddress(255, 255, 255, 0);
+}
+
+IPAddress WiFiClass::dnsIP(uint8_t) {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    if (!connectedAPLocked(millis())) return INADDR_NONE;
+    return gStaticIp ? gDns : IPAddress(192, 168, 1, 1);
+}
+
+const char* WiFiClass::getHostname() {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    return gHostname.c_str();
+}
+
+bool WiFiClass::setHostname(const char* hostname) {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    gHostname = hostname ? hostname : "";
+    return true;
+}
+
+bool WiFiClass::setSleep(bool enabled) {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    gSleep = enabled;
+    return true;
+}
+
+bool WiFiClass::getSleep() {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    return gSleep;
+}
+
+bool WiFiClass::setTxPower(wifi_power_t power) {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    if (gTxPower != power) gStats.txPowerChanges++;
+    gTxPower = power;
+    return true;
+}
+
+wifi_power_t WiFiClass::getTxPower() {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    return gTxPower;
+}
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventSysCb cbEvent, arduino_event_id_t event) {
+    return gEvents.add(cbEvent, event);
+}
+
+void WiFiClass::removeEvent(wifi_event_id_t id) {
+    gEvents.remove(id);
+}
+
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type) {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    if (gPowerSave != type) gStats.powerSaveChanges++;
+    gPowerSave = type;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_ps(wifi_ps_type_t* type) {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    *type = gPowerSave;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_channel(uint8_t* primary, wifi_second_chan_t* second) {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    const sim::AccessPoint* ap = connectedAPLocked(millis());
+    *primary = ap ? (uint8_t)ap->channel : 1;
+    if (second) *second = WIFI_SECOND_CHAN_NONE;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t* ap_info) {
+    std::lock_guard<std::mutex> lk(gRadioMutex);
+    if (!associatedLocked(millis())) return ESP_FAIL;
+    const sim::AccessPoint& ap = gAPs[gConn.apIndex];
+    memset(ap_info, 0, sizeof(*ap_info));
+    memcpy(ap_info->bssid, ap.bssid, 6);
+    strncpy((char*)ap_info->ssid, ap.ssid.c_str(), 32);
+    ap_info->primary = (uint8_t)ap.channel;
+    ap_info->rssi = (int8_t)ap.rssi;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_max_tx_power(int8_t power) {
+    WiFi.setTxPower((wifi_power_t)power);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_max_tx_power(int8_t* power) {
+    *power = (int8_t)WiFi.getTxPower();
+    return ESP_OK;
+}
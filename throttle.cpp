@@ -3,13 +3,24 @@
 #include "esp_system.h"
 #include "esp32-hal.h"
 #include "Arduino.h"
+#include "Metrics.h"
 
+static Counter& freqChangesMetric = metrics().counter("cpu.freq_changes");
+static Gauge& freqMetric = metrics().gauge("cpu.mhz");
 
 
-int throttleCPU(float temperature, float cpu_temp_min, float cpu_temp_max) {
 
-    // CPU throttling based on temperature
-    static int currentCpuFrequency = CPU_MAX_FREQ;
+int quantizeCpuFrequency(int mhz) {
+    int best = CPU_FREQ_STEPS[0];
+    for (int f : CPU_FREQ_STEPS) {
+        if (abs(f - mhz) < abs(best - mhz)) {
+            best = f;
+        }
+    }
+    return best;
+}
+
+int throttleCPU(float temperature, float cpu_temp_min, float cpu_temp_max) {
 
     if(temperature < -99) {
         temperature = temperatureRead();
@@ -19,12 +30,19 @@ int throttleCPU(float temperature, float cpu_temp_min, float cpu_temp_max) {
     int newFreq = CPU_MIN_FREQ + (scale * (CPU_MAX_FREQ - CPU_MIN_FREQ));  
 
     newFreq = constrain(newFreq, CPU_MIN_FREQ, CPU_MAX_FREQ);
+    // only supported steps, anything else is rejected by setCpuFrequencyMhz
+    newFreq = quantizeCpuFrequency(newFreq);
 
-    //do this in steps, if change is not at least 10MHz, don't do it
-    if(abs(newFreq - currentCpuFrequency) < 10){
+    // compare against the real clock, not what we last asked for (also right on the first call)
+    int currentCpuFrequency = getCpuFrequencyMhz();
+    if(newFreq == currentCpuFrequency){
         return currentCpuFrequency;
     }
-    setCpuFrequencyMhz(newFreq);
-    currentCpuFrequency = newFreq;
+    if(setCpuFrequencyMhz(newFreq)){
+        currentCpuFrequency = newFreq;
+        freqChangesMetric.add();
+        freqMetric.set(newFreq);
+        metrics().event(MetricEvent::CpuFrequency, newFreq);
+    }
     return currentCpuFrequency;
-}
\ No newline at end of file
+}
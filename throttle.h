@@ -3,4 +3,12 @@
 static constexpr int CPU_MAX_FREQ = 240;   // Max performance
 static constexpr int CPU_MIN_FREQ = 80;    // Minimum power-saving mode
 
-int throttleCPU(float temperature = -100., float cpu_temp_min = 70., float cpu_temp_max = 90);
\ No newline at end of file
+// the PLL only yields these (lower clocks come from the crystal and stop WiFi)
+static constexpr int CPU_FREQ_STEPS[] = {80, 160, 240};
+
+// nearest supported frequency in CPU_MIN_FREQ..CPU_MAX_FREQ
+int quantizeCpuFrequency(int mhz);
+
+// Open-loop linear mapping of temperature onto the clock, kept for compatibility;
+// ThermalGovernor regulates to a setpoint instead and oscillates less.
+int throttleCPU(float temperature = -100., float cpu_temp_min = 70., float cpu_temp_max = 90);